@@ -0,0 +1,118 @@
+/**
+  ******************************************************************************
+  * File Name          : grain128aead_emu.h
+  * Description        : Host-side emulator of the IP Manager, of the banked
+                         data buffer and of the Grain controller+cipher cores
+  ******************************************************************************
+  *
+  * The emulator stands in for Fpgaipm.c on a Linux host: FPGA_IPM_open/read/
+  * write/close/... drive a software model of the FPGA instead of the FMC bus,
+  * so that grain128aead_fpga.c runs unchanged off-target.
+  *
+  * The model follows the packet layout and the word order of
+  * grain_controller.vhd, down to the indices of its AD register, and computes
+  * Grain-128AEAD as specified, while
+  * time is counted in FPGA clock cycles with the cost of every step of the
+  * controller FSM (see the GRAIN128AEAD_EMU_CYC_* constants) and a fixed cost
+  * for each access of the CPU to the data buffer.
+  *
+  ******************************************************************************
+  */
+
+#ifndef GRAIN128AEAD_EMU_H_
+#define GRAIN128AEAD_EMU_H_
+
+#include <stdint.h>
+#include "Fpgaipm.h"
+
+// FPGA clock cycles of an FMC access (8+8 HCLK of setup at 180 MHz against the 45 MHz MCO clock of the FPGA)
+#ifndef GRAIN128AEAD_EMU_BUS_CYCLES
+#define GRAIN128AEAD_EMU_BUS_CYCLES 4
+#endif
+
+// keystream bits computed by a NEXT_Z of the cipher core (GRAIN_PARALLEL of CONSTANTS.vhd): 1, 8, 16 or 32
+#ifndef GRAIN128AEAD_EMU_PARALLEL
+#define GRAIN128AEAD_EMU_PARALLEL 32
+#endif
+
+// cycles of the steps of the controller FSM
+#define GRAIN128AEAD_EMU_CYC_BUF_READ	3	// WAIT_x, ADDR_x, READ_x
+#define GRAIN128AEAD_EMU_CYC_BUF_WRITE	3	// WRITE_x, OP_WRITE_x, WAIT_WRITE_x
+#define GRAIN128AEAD_EMU_CYC_CORE_OP	5	// start, OP_x, WAIT_x, then the core goes through SELECT_OP, the operation and DONE
+#define GRAIN128AEAD_EMU_CYC_LATCH		1	// WAIT_LATCH_x after a NEXT_Z or READ_AUTH_ACC
+#define GRAIN128AEAD_EMU_CYC_STREAM		1	// word of the AD or of the message through the stream of the core
+#define GRAIN128AEAD_EMU_CYC_STEP		1	// any other state (decode, RAM latency, end of the stream...)
+
+// words of the prefetch and write-back FIFOs of the message pipeline (PIPE_DEPTH of the controller)
+#define GRAIN128AEAD_EMU_PIPE_DEPTH		4
+
+/** Counters of the emulated FPGA. */
+typedef struct {
+	uint64_t cycles;			/**< FPGA clock cycles elapsed since GRAIN128AEAD_EMU_reset */
+	uint64_t reads;				/**< words read by the CPU */
+	uint64_t writes;			/**< words written by the CPU, row 0 included */
+	uint64_t packets;			/**< packets processed by the cores */
+	uint64_t busy_cycles;		/**< cycles spent by the cores on the packets, summed over the cores */
+	uint64_t auth_failures;		/**< decryptions whose tag did not match */
+} GRAIN128AEAD_EMU_STATS;
+
+/**
+ * @brief Power-on reset of the emulated FPGA: clears the banks of every core, the controllers and the counters.
+ */
+void GRAIN128AEAD_EMU_reset(void);
+
+/**
+ * @brief Read the counters of the emulated FPGA.
+ * @param stats Filled with the current values.
+ */
+void GRAIN128AEAD_EMU_stats(GRAIN128AEAD_EMU_STATS *stats);
+
+/**
+ * @brief Let the FPGA run for some clock cycles without any access of the CPU.
+ * @param cycles Cycles to be elapsed.
+ */
+void GRAIN128AEAD_EMU_idle(uint64_t cycles);
+
+/**
+ * @brief Delay of the driver (see GRAIN128AEAD_FPGA_set_delay): the CPU waits without accessing the bus.
+ * @param cycles FPGA clock cycles to be elapsed.
+ */
+void GRAIN128AEAD_EMU_delay(uint32_t cycles);
+
+/**
+ * @brief Freeze a core as if it were stuck: it takes no packet and completes none until it is released. Closing
+ * its transaction still disables it.
+ * @param core Core (from 1 to FPGA_IPM_NUM_CORES).
+ * @param on 1 to stall the core, 0 to release it.
+ */
+void GRAIN128AEAD_EMU_stall(FPGA_IPM_CORE core, int on);
+
+/**
+ * @brief Print each CPU access to the data buffer on stdout.
+ * @param on 1 to trace the accesses, 0 to stop.
+ */
+void GRAIN128AEAD_EMU_trace(int on);
+
+/**
+ * @brief Host clock for the timings of the driver (see GRAIN128AEAD_FPGA_set_clock): CLOCK_MONOTONIC in ns.
+ */
+uint32_t GRAIN128AEAD_EMU_clock(void);
+
+// bus interface, used by Fpgaipm_emu.c in place of the FMC accesses of Fpgaipm.c
+
+/**
+ * @brief Read a word of the data buffer as the CPU does: row 0, the bank select word, or a word of the selected bank
+ * of the core addressed by row 0.
+ * @param address Word of the data buffer (from 0 to 63).
+ * @param data Filled with the word read.
+ */
+void GRAIN128AEAD_EMU_bus_read(FPGA_IPM_ADDRESS address, FPGA_IPM_DATA *data);
+
+/**
+ * @brief Write a word of the data buffer as the CPU does. Writing row 0 drives the IP Manager.
+ * @param address Word of the data buffer (from 0 to 63).
+ * @param data Word to be written.
+ */
+void GRAIN128AEAD_EMU_bus_write(FPGA_IPM_ADDRESS address, const FPGA_IPM_DATA *data);
+
+#endif /* GRAIN128AEAD_EMU_H_ */
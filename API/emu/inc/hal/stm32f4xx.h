@@ -0,0 +1,19 @@
+/**
+  ******************************************************************************
+  * File Name          : stm32f4xx.h
+  * Description        : Host stand-in for the STM32 HAL header of the same name
+  ******************************************************************************
+  *
+  * Only the types used by Fpgaipm.h are needed on the host: the accesses to the
+  * FMC bus are replaced by the emulator (see grain128aead_emu.h).
+  *
+  ******************************************************************************
+  */
+
+#ifndef STM32F4XX_H_
+#define STM32F4XX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#endif /* STM32F4XX_H_ */
@@ -0,0 +1,59 @@
+/**
+  ******************************************************************************
+  * File Name          : stm32f4xx_hal.h
+  * Description        : Host stand-in for the STM32 HAL header of the same name
+  ******************************************************************************
+  *
+  * Only the types used by Fpgaipm.h are needed on the host: the accesses to the
+  * FMC bus are replaced by the emulator (see grain128aead_emu.h). The GPIO
+  * and the tick used by FPGA.c are those of the JTAG simulator (see
+  * jtag_emu.h).
+  *
+  ******************************************************************************
+  */
+
+#ifndef STM32F4XX_HAL_H_
+#define STM32F4XX_HAL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct GPIO_TypeDef GPIO_TypeDef;
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0,
+  GPIO_PIN_SET
+} GPIO_PinState;
+
+// base addresses of the ports, as in the device header: only compared, never accessed
+#define GPIOA               ((GPIO_TypeDef *) 0x40020000UL)
+#define GPIOB               ((GPIO_TypeDef *) 0x40020400UL)
+#define GPIOC               ((GPIO_TypeDef *) 0x40020800UL)
+#define GPIOD               ((GPIO_TypeDef *) 0x40020C00UL)
+#define GPIOE               ((GPIO_TypeDef *) 0x40021000UL)
+#define GPIOF               ((GPIO_TypeDef *) 0x40021400UL)
+#define GPIOG               ((GPIO_TypeDef *) 0x40021800UL)
+
+#define GPIO_PIN_0          ((uint16_t)0x0001)
+#define GPIO_PIN_1          ((uint16_t)0x0002)
+#define GPIO_PIN_2          ((uint16_t)0x0004)
+#define GPIO_PIN_3          ((uint16_t)0x0008)
+#define GPIO_PIN_4          ((uint16_t)0x0010)
+#define GPIO_PIN_5          ((uint16_t)0x0020)
+#define GPIO_PIN_6          ((uint16_t)0x0040)
+#define GPIO_PIN_7          ((uint16_t)0x0080)
+#define GPIO_PIN_8          ((uint16_t)0x0100)
+#define GPIO_PIN_9          ((uint16_t)0x0200)
+#define GPIO_PIN_10         ((uint16_t)0x0400)
+#define GPIO_PIN_11         ((uint16_t)0x0800)
+#define GPIO_PIN_12         ((uint16_t)0x1000)
+#define GPIO_PIN_13         ((uint16_t)0x2000)
+#define GPIO_PIN_14         ((uint16_t)0x4000)
+#define GPIO_PIN_15         ((uint16_t)0x8000)
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+uint32_t HAL_GetTick(void);
+
+#endif /* STM32F4XX_HAL_H_ */
@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * File Name          : jtag_emu.h
+  * Description        : Host-side simulator of the JTAG port of the MachXO2,
+                         for the VME processor of FPGA.c
+  ******************************************************************************
+  *
+  * The simulator stands in for the TAP of the LCMXO2-7000HC on a Linux host:
+  * the GPIO of FPGA.c (TDO on PE2, TDI on PE3, TCK on PE4, TMS on PE5) and
+  * JTAG_EMU_port drive the same 16-state TAP controller, so that the VME
+  * algorithm and data files run unchanged off-target.
+  *
+  * Only the instructions used by the VME algorithm are modelled: IDCODE,
+  * status, USERCODE, erase, programming and verify of the configuration and
+  * UFM rows, feature row, DONE bit and refresh. Each row programmed is kept,
+  * so that the verify of the algorithm reads back what it has written.
+  * Time is counted in TCK pulses and in ms of HAL_GetTick: every call of
+  * HAL_GetTick lets one ms elapse.
+  *
+  ******************************************************************************
+  */
+
+#ifndef JTAG_EMU_H_
+#define JTAG_EMU_H_
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+#include "FPGA.h"
+
+#define JTAG_EMU_IDCODE		0x012B5043	// LCMXO2-7000HC
+#define JTAG_EMU_CFG_ROWS	9212		// rows of 128 bits of the configuration flash
+#define JTAG_EMU_UFM_ROWS	2048		// rows of 128 bits of the UFM
+
+/** Counters of the simulated device. */
+typedef struct {
+	uint64_t tck;				/**< TCK pulses since JTAG_EMU_reset */
+	uint64_t pin_accesses;		/**< reads and writes of the JTAG pins through the HAL */
+	uint64_t port_calls;		/**< calls to the functions of JTAG_EMU_port */
+	uint64_t wait_ms;			/**< ms elapsed on HAL_GetTick */
+	uint32_t rows;				/**< rows programmed, configuration and UFM */
+	uint32_t errors;			/**< rows out of the flash, or programmed outside of the programming mode */
+} JTAG_EMU_STATS;
+
+/** Port of FPGA.c that drives the simulator directly, a whole shift per call (see B5_FPGA_SetPort). */
+extern const B5_FPGA_PORT JTAG_EMU_port;
+
+/**
+ * @brief Power-on of a blank device: flash erased, not configured, TAP in Test-Logic-Reset, counters cleared.
+ */
+void JTAG_EMU_reset(void);
+
+/**
+ * @brief Read the counters of the simulated device.
+ * @param stats Filled with the current values.
+ */
+void JTAG_EMU_stats(JTAG_EMU_STATS *stats);
+
+/**
+ * @brief State of the DONE bit of the status register.
+ * @return 1 if the device has been configured from its flash, 0 otherwise.
+ */
+int JTAG_EMU_configured(void);
+
+/**
+ * @brief Flip a bit of a configuration row when it is programmed, as a flash cell that does not hold its value.
+ * @param row Row of the configuration flash, from 0 to JTAG_EMU_CFG_ROWS-1; any other value programs every row
+ * as it is shifted.
+ */
+void JTAG_EMU_corrupt_row(uint32_t row);
+
+#endif /* JTAG_EMU_H_ */
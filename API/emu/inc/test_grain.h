@@ -0,0 +1,26 @@
+/*
+ * test_grain.h
+ *
+ * Host version of the UART helpers of the test application (API/test), used
+ * by grain128aead_fpga.c to echo its inputs: on the host the echo is dropped.
+ */
+
+#ifndef INC_DEVICE_TEST_GRAIN_H_
+#define INC_DEVICE_TEST_GRAIN_H_
+
+#include <stdint.h>
+
+void print_uart(uint8_t data[]);
+
+void print_uart_hex(uint8_t num);
+
+void print_uart_8(uint8_t num);
+
+void print_uart_int(uint8_t num);
+
+void generate_rnd_vector(uint8_t *dataout, uint16_t size);
+
+uint8_t to_hex(uint8_t num);
+
+
+#endif /* INC_DEVICE_TEST_GRAIN_H_ */
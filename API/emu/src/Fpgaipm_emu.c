@@ -0,0 +1,208 @@
+/**
+  ******************************************************************************
+  * File Name          : Fpgaipm_emu.c
+  * Description        : Low-level APIs for CPU-FPGA communication, on top of
+                         the host-side emulator of the FPGA
+  ******************************************************************************
+  *
+  * Same transactions, window lock, queues of the cores and row 0 handling as
+  * Fpgaipm.c: only the accesses to the FMC bus are replaced by the bus of the
+  * emulator.
+  *
+  ******************************************************************************
+  */
+
+#include "Fpgaipm.h"
+#include "grain128aead_emu.h"
+
+static FPGA_IPM_DATA row0;
+static FPGA_IPM_CORE currentCore;
+static FPGA_IPM_UINT8 currentBank;                            // bank selected by the last transaction holding the window
+static FPGA_IPM_DATA suspendedRow0[FPGA_IPM_NUM_CORES]; // row 0 of the transactions left open, 0 if none
+static FPGA_IPM_BOOLEAN initialized = 0;
+static volatile FPGA_IPM_SEM sem;                             // 1 while the CPU window is free
+static volatile FPGA_IPM_TICKET nextTicket[FPGA_IPM_NUM_CORES];   // next ticket handed out for each core
+static volatile FPGA_IPM_TICKET servedTicket[FPGA_IPM_NUM_CORES]; // ticket whose transaction holds each core
+static FPGA_IPM_YIELD yieldFn = NULL;
+
+// private functions
+static FPGA_IPM_BOOLEAN checkCore(FPGA_IPM_CORE coreID);
+static void writeRow0(FPGA_IPM_DATA newRow0);
+static FPGA_IPM_BOOLEAN queued(FPGA_IPM_CORE coreID);
+static FPGA_IPM_BOOLEAN takeWindow(void);
+static void releaseWindow(void);
+static void startTransaction(FPGA_IPM_CORE coreID, FPGA_IPM_OPCODE opcode, FPGA_IPM_BOOLEAN interruptMode, FPGA_IPM_BOOLEAN ack);
+
+
+FPGA_IPM_BOOLEAN FPGA_IPM_init() {
+
+	if (initialized) return 0;
+
+	initialized = 1;
+
+	// INIT SEMAPHORE
+	sem = 1;
+
+	return 0;
+}
+
+
+FPGA_IPM_BOOLEAN FPGA_IPM_open(FPGA_IPM_CORE coreID, FPGA_IPM_OPCODE opcode, FPGA_IPM_BOOLEAN interruptMode, FPGA_IPM_BOOLEAN ack) {
+  FPGA_IPM_TICKET ticket = 0;
+  if (queued(coreID)) {
+    // take the core only if no transaction holds it or waits for it
+    ticket = servedTicket[coreID-1];
+    if (!__atomic_compare_exchange_n(&nextTicket[coreID-1], &ticket, ticket + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return 1;
+  }
+  if (!takeWindow()) {
+    if (queued(coreID)) __atomic_fetch_add(&servedTicket[coreID-1], 1, __ATOMIC_RELEASE);
+    return 1;
+  }
+  startTransaction(coreID, opcode, interruptMode, ack);
+  return 0;
+}
+
+
+FPGA_IPM_TICKET FPGA_IPM_enqueue(FPGA_IPM_CORE coreID) {
+  return queued(coreID) ? __atomic_fetch_add(&nextTicket[coreID-1], 1, __ATOMIC_RELAXED) : 0;
+}
+
+
+FPGA_IPM_BOOLEAN FPGA_IPM_try_open(FPGA_IPM_CORE coreID, FPGA_IPM_TICKET ticket, FPGA_IPM_OPCODE opcode, FPGA_IPM_BOOLEAN interruptMode, FPGA_IPM_BOOLEAN ack) {
+  // the window is taken only once the core is ours: a task never holds it while waiting for a core
+  if (queued(coreID) && __atomic_load_n(&servedTicket[coreID-1], __ATOMIC_ACQUIRE) != ticket) return 1;
+  if (!takeWindow()) return 1;
+  startTransaction(coreID, opcode, interruptMode, ack);
+  return 0;
+}
+
+
+FPGA_IPM_BOOLEAN FPGA_IPM_open_wait(FPGA_IPM_CORE coreID, FPGA_IPM_OPCODE opcode, FPGA_IPM_BOOLEAN interruptMode, FPGA_IPM_BOOLEAN ack) {
+  FPGA_IPM_TICKET ticket;
+  // the window is never free before FPGA_IPM_init: do not wait for it forever
+  if (!initialized) return 1;
+  ticket = FPGA_IPM_enqueue(coreID);
+  while (FPGA_IPM_try_open(coreID, ticket, opcode, interruptMode, ack)) {
+    if (yieldFn != NULL) yieldFn();
+  }
+  return 0;
+}
+
+
+void FPGA_IPM_set_yield(FPGA_IPM_YIELD yield) {
+  yieldFn = yield;
+}
+
+
+FPGA_IPM_BOOLEAN FPGA_IPM_read(FPGA_IPM_CORE coreID, FPGA_IPM_ADDRESS address, FPGA_IPM_DATA *dataPtr) {
+	if (checkCore(coreID)) {
+		GRAIN128AEAD_EMU_bus_read(address, dataPtr);
+		return 0;
+	}
+	return 1;
+}
+
+
+FPGA_IPM_BOOLEAN FPGA_IPM_write(FPGA_IPM_CORE coreID, FPGA_IPM_ADDRESS address, FPGA_IPM_DATA *dataPtr) {
+	if (checkCore(coreID)) {
+		GRAIN128AEAD_EMU_bus_write(address, dataPtr);
+		return 0;
+	}
+	return 1;
+}
+
+
+FPGA_IPM_BOOLEAN FPGA_IPM_select_bank(FPGA_IPM_CORE coreID, FPGA_IPM_UINT8 bank) {
+	FPGA_IPM_DATA bankWord = bank;
+	if (bank >= FPGA_IPM_NUM_BANKS) return 1;
+	if (FPGA_IPM_write(coreID, FPGA_IPM_BANK_ADDRESS, &bankWord)) return 1;
+	currentBank = bank;
+	return 0;
+}
+
+
+FPGA_IPM_BOOLEAN FPGA_IPM_suspend(FPGA_IPM_CORE coreID) {
+  // row 0 is left untouched: the IP manager keeps the core enabled until the transaction is closed
+  if (checkCore(coreID) && coreID > 0 && coreID <= FPGA_IPM_NUM_CORES) {
+    suspendedRow0[coreID-1] = row0;
+    releaseWindow();
+    return 0;
+  }
+  return 1;
+}
+
+
+FPGA_IPM_BOOLEAN FPGA_IPM_resume(FPGA_IPM_CORE coreID) {
+  // the suspended transaction still holds its core: only the window has to be taken back
+  if (queued(coreID) && suspendedRow0[coreID-1] != 0 && takeWindow()) {
+    writeRow0(suspendedRow0[coreID-1]);
+    suspendedRow0[coreID-1] = 0;
+    currentCore = coreID;
+    return 0;
+  }
+  return 1;
+}
+
+
+FPGA_IPM_BOOLEAN FPGA_IPM_resume_wait(FPGA_IPM_CORE coreID) {
+  if (!queued(coreID) || suspendedRow0[coreID-1] == 0) return 1;
+  while (FPGA_IPM_resume(coreID)) {
+    if (yieldFn != NULL) yieldFn();
+  }
+  return 0;
+}
+
+
+FPGA_IPM_BOOLEAN FPGA_IPM_close(FPGA_IPM_CORE coreID) {
+  if (checkCore(coreID)) {
+    FPGA_IPM_DATA newRow0 = row0 & ~FPGA_IPM_BEGIN_TRANSACTION;
+    writeRow0(newRow0);
+    // the next ticket of the core may be opened as soon as the window is released
+    if (queued(coreID)) __atomic_fetch_add(&servedTicket[coreID-1], 1, __ATOMIC_RELEASE);
+    releaseWindow();
+    return 0;
+  }
+  return 1;
+}
+
+
+
+
+static FPGA_IPM_BOOLEAN checkCore(FPGA_IPM_CORE coreID) { return coreID == currentCore && __atomic_load_n(&sem, __ATOMIC_RELAXED) == 0 && initialized; }
+
+
+static FPGA_IPM_BOOLEAN queued(FPGA_IPM_CORE coreID) { return coreID > 0 && coreID <= FPGA_IPM_NUM_CORES; }
+
+
+// LDREX/STREX on the Cortex-M4: safe against other tasks and interrupts
+static FPGA_IPM_BOOLEAN takeWindow(void) {
+  FPGA_IPM_SEM expected = 1;
+  return initialized && __atomic_compare_exchange_n(&sem, &expected, 0, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+
+static void releaseWindow(void) {
+  __atomic_store_n(&sem, 1, __ATOMIC_RELEASE);
+}
+
+
+static void startTransaction(FPGA_IPM_CORE coreID, FPGA_IPM_OPCODE opcode, FPGA_IPM_BOOLEAN interruptMode, FPGA_IPM_BOOLEAN ack) {
+  FPGA_IPM_DATA newRow0 = 0 | (coreID & FPGA_IPM_CORE_MASK) | ((opcode & FPGA_IPM_OPCODE_MASK) << FPGA_IPM_OPCODE_OFFSET) |
+                          (interruptMode ? FPGA_IPM_INTERRUPT_MODE : 0) | (ack ? FPGA_IPM_ACK : 0) | FPGA_IPM_BEGIN_TRANSACTION;
+  FPGA_IPM_DATA bankWord = 0;
+  // the bank select word is shared: a new transaction starts on bank 0, whatever the previous one left selected.
+  // It is written before row 0: once the core is enabled, the IP manager notifies it of every write of the CPU,
+  // and a single packet counts them to know which words of the packet are there
+  if (currentBank != 0) {
+    GRAIN128AEAD_EMU_bus_write(FPGA_IPM_BANK_ADDRESS, &bankWord);
+    currentBank = 0;
+  }
+  writeRow0(newRow0);
+  currentCore = coreID;
+}
+
+
+static void writeRow0(FPGA_IPM_DATA newRow0) {
+  GRAIN128AEAD_EMU_bus_write(0, &newRow0);
+  row0 = newRow0;
+}
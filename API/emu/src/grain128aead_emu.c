@@ -0,0 +1,698 @@
+/**
+  ******************************************************************************
+  * File Name          : grain128aead_emu.c
+  * Description        : Host-side emulator of the IP Manager, of the banked
+                         data buffer and of the Grain controller+cipher cores
+  ******************************************************************************
+  *
+  * Every core owns FPGA_IPM_NUM_BANKS banks of 64 words (DATA_BUFFER.vhd), the
+  * CPU sees the banks of the core addressed by row 0 and the bank selected by
+  * word 62. A controller processes a whole packet as soon as it can start it
+  * (all the words written in a single-packet transaction, the status word of
+  * its bank rung in streaming and batch mode): its results become visible to
+  * the CPU when the cycles the FSM takes for that packet have elapsed.
+  *
+  * The cipher follows the equations of grain128_core.vhd, indexed as in the
+  * Grain-128AEAD specification (bit i of the VHDL registers is 127-i here).
+  *
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "grain128aead_emu.h"
+
+#define EMU_WORDS			64
+#define EMU_ADDR_CW			0
+#define EMU_ADDR_KEY		1
+#define EMU_ADDR_IV			9
+#define EMU_ADDR_LENGTH		17
+#define EMU_ADDR_AD			18
+#define EMU_ADDR_MSG_INIT	28
+#define EMU_ADDR_LENGTH_NEXT 1
+#define EMU_ADDR_MSG_NEXT	2
+#define EMU_ADDR_MAC		40
+#define EMU_ADDR_PERF		44
+#define EMU_ADDR_STATUS		63
+
+#define EMU_WORDS_KEY		8
+#define EMU_WORDS_IV		6
+#define EMU_WORDS_MAC		4
+#define EMU_AD_MAX			20
+
+#define EMU_STATUS_READY	0x0001
+#define EMU_STATUS_LAST		0x0002
+#define EMU_STATUS_DONE		0xFFFF
+#define EMU_STATUS_FAIL		0xFFFE
+
+// opcode fields, see DECODE_OPCODE
+#define EMU_OPCODE_DECRYPT	0x02
+#define EMU_OPCODE_STREAM	0x04
+#define EMU_OPCODE_BATCH	0x10
+#define EMU_OPCODE_NATURAL	0x08
+#define EMU_OPCODE_PACKET	0x37	// opcode without the word order bit
+
+// control word fields, see CONSTANTS.vhd
+#define EMU_CW_IPADDR		0x007F
+#define EMU_CW_BE			0x0080
+#define EMU_CW_IRQ			0x0200
+
+// state of a controller
+enum { EMU_OFF, EMU_WAIT_WORDS, EMU_WAIT_BANK, EMU_BUSY, EMU_DONE };
+
+// phases of the performance counters, see perf_phase() in the controller
+enum { EMU_PERF_LOAD, EMU_PERF_INIT, EMU_PERF_ADDKEY, EMU_PERF_AD, EMU_PERF_MSG, EMU_PERF_MAC, EMU_PERF_IDLE, EMU_PERF_PHASES };
+
+// Grain-128AEAD cipher core
+typedef struct {
+	uint8_t s[128];				// LFSR
+	uint8_t b[128];				// NFSR
+	uint8_t acc[64];			// accumulator
+	uint8_t sr[64];				// shift register of the authenticator
+} EMU_CIPHER;
+
+// Grain controller and its banks
+typedef struct {
+	FPGA_IPM_DATA banks[FPGA_IPM_NUM_BANKS][EMU_WORDS];
+	uint8_t state;
+	uint8_t enabled;
+	uint8_t stream;
+	uint8_t batch;				// each bank of the ring is a whole message (descriptor)
+	uint8_t batch_last;			// the descriptor in progress closes the batch
+	uint8_t decrypt;
+	uint8_t natural;
+	uint8_t set_init;			// the next packet is an INIT packet
+	uint8_t last;				// the packet closes the message
+	uint8_t cur_bank;
+	uint8_t stalled;			// the core is stuck, see GRAIN128AEAD_EMU_stall
+	uint32_t wc;				// writes of the CPU notified to the core since the opening of the transaction
+	uint64_t free_at;			// cycle from which the controller can take the next packet
+	uint64_t ring_at[FPGA_IPM_NUM_BANKS];	// cycle at which the CPU handed each bank over
+	uint64_t iv_at;				// cycle at which the CPU wrote the last word of the IV of a single packet
+	uint64_t perf[EMU_PERF_PHASES];	// cycles of each phase since the opening of the transaction
+	EMU_CIPHER cipher;
+	// results of the packet in progress, visible from done_at
+	uint64_t done_at;
+	uint8_t out_bank;
+	uint64_t out_mask;
+	FPGA_IPM_DATA out[EMU_WORDS];
+} EMU_IP;
+
+static EMU_IP ips[FPGA_IPM_NUM_CORES];
+static FPGA_IPM_DATA row0;
+static FPGA_IPM_DATA bank_sel;
+static GRAIN128AEAD_EMU_STATS stats;
+static int trace;
+// the FPGA is shared by the tasks of the tests: one access at a time, as on the FMC bus
+static pthread_mutex_t bus_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Position in the buffer of the i-th of n words, see ordered() in the controller
+static int EMU_pos(const EMU_IP *ip, int i, int n)
+{
+	return ip->natural ? i : n-1-i;
+}
+
+// Byte i of a block of words sent as-is by the CPU (the first byte is the upper half of a word)
+static uint8_t EMU_byte(const FPGA_IPM_DATA *words, int i)
+{
+	return ( i % 2 == 0 ) ? words[i/2] >> 8 : words[i/2] & 0xFF;
+}
+
+static void EMU_set_byte(FPGA_IPM_DATA *words, int i, uint8_t byte)
+{
+	if ( i % 2 == 0 )
+		words[i/2] = ( words[i/2] & 0x00FF ) | ( byte << 8 );
+	else
+		words[i/2] = ( words[i/2] & 0xFF00 ) | byte;
+}
+
+// Copy n words of the bank starting at add, in the order of the packet
+static void EMU_fetch(const EMU_IP *ip, const FPGA_IPM_DATA *bank, int add, int n, FPGA_IPM_DATA *words)
+{
+	for (int i = 0; i < n; i++)
+		words[i] = bank[( add + EMU_pos(ip, i, n) ) % EMU_WORDS];
+}
+
+// Write n words of the packet in the bank starting at add, when the packet is done
+static void EMU_store(EMU_IP *ip, int add, int n, const FPGA_IPM_DATA *words)
+{
+	for (int i = 0; i < n; i++) {
+		int a = ( add + EMU_pos(ip, i, n) ) % EMU_WORDS;
+		ip->out[a] = words[i];
+		ip->out_mask |= 1ULL << a;
+	}
+}
+
+// Count the cycles of a step of the controller in its phase
+static uint64_t EMU_count(uint64_t *perf, int phase, uint64_t cyc)
+{
+	perf[phase] += cyc;
+	return cyc;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Cipher core
+// ------------------------------------------------------------------------------------------------
+
+enum { EMU_INIT, EMU_ADD_KEY, EMU_NORMAL };
+
+static void EMU_shift(uint8_t *fsr, int len, uint8_t fb)
+{
+	memmove(fsr, fsr+1, len-1);
+	fsr[len-1] = fb;
+}
+
+// NEXT_Z: one clock of the pre-output generator
+static uint8_t EMU_next_z(EMU_CIPHER *c, int round, uint8_t serial_in)
+{
+	const uint8_t *s = c->s, *b = c->b;
+	uint8_t s_fb = s[0] ^ s[7] ^ s[38] ^ s[70] ^ s[81] ^ s[96];
+	uint8_t b_fb = b[0] ^ b[26] ^ b[56] ^ b[91] ^ b[96] ^ (b[3] & b[67]) ^ (b[11] & b[13]) ^ (b[17] & b[18]) ^
+				   (b[27] & b[59]) ^ (b[40] & b[48]) ^ (b[61] & b[65]) ^ (b[68] & b[84]) ^
+				   (b[22] & b[24] & b[25]) ^ (b[70] & b[78] & b[82]) ^ (b[88] & b[92] & b[93] & b[95]);
+	uint8_t h = (b[12] & s[8]) ^ (s[13] & s[20]) ^ (b[95] & s[42]) ^ (s[60] & s[79]) ^ (b[12] & b[95] & s[94]);
+	uint8_t y = h ^ s[93] ^ b[2] ^ b[15] ^ b[36] ^ b[45] ^ b[64] ^ b[73] ^ b[89];
+	uint8_t s0 = s[0];
+
+	switch (round) {
+		case EMU_INIT:
+			EMU_shift(c->s, 128, s_fb ^ y);
+			EMU_shift(c->b, 128, b_fb ^ s0 ^ y);
+			break;
+		case EMU_ADD_KEY:
+			EMU_shift(c->s, 128, s_fb ^ serial_in);
+			EMU_shift(c->b, 128, b_fb ^ s0);
+			break;
+		default:
+			EMU_shift(c->s, 128, s_fb);
+			EMU_shift(c->b, 128, b_fb ^ s0);
+			break;
+	}
+	return y;
+}
+
+// ACCUMULATE
+static void EMU_accumulate(EMU_CIPHER *c)
+{
+	for (int i = 0; i < 64; i++)
+		c->acc[i] ^= c->sr[i];
+}
+
+// Authenticate a bit with the keystream bit z_sr, shifted in the register: the stream of the core, once the
+// first keystream bit has ciphered the bit
+static void EMU_auth_bit(EMU_CIPHER *c, uint8_t bit, uint8_t z_sr)
+{
+	if (bit)
+		EMU_accumulate(c);
+	EMU_shift(c->sr, 64, z_sr);
+}
+
+// Key and IV loading, 256 clocks of initialisation, then accumulator and shift register from the keystream.
+// key and iv are the bytes of the packet. Returns the cycles of the controller states, counted in perf.
+static uint64_t EMU_init_cipher(EMU_CIPHER *c, const uint8_t *key, const uint8_t *iv, uint64_t *perf)
+{
+	uint64_t cyc = 0;
+	int i;
+
+	memset(c, 0, sizeof(*c));
+
+	// LOAD_IV/LOAD_KEY: 16 bits at a time, the padding of the LFSR is part of the IV words of the controller
+	for (i = 0; i < 128; i++) {
+		c->s[i] = ( i < 96 ) ? ( iv[i/8] >> (i%8) ) & 1 : ( i < 127 );
+		c->b[i] = ( key[i/8] >> (i%8) ) & 1;
+	}
+	cyc += EMU_count(perf, EMU_PERF_INIT, 2 * ( 8 * GRAIN128AEAD_EMU_CYC_CORE_OP + GRAIN128AEAD_EMU_CYC_STEP ));
+
+	// INIT_CORE_PRE_OUTPUT: GRAIN128AEAD_EMU_PARALLEL clocks per NEXT_Z
+	for (i = 0; i < 256; i++)
+		EMU_next_z(c, EMU_INIT, 0);
+	cyc += EMU_count(perf, EMU_PERF_INIT, ( 256 / GRAIN128AEAD_EMU_PARALLEL ) * GRAIN128AEAD_EMU_CYC_CORE_OP +
+					 GRAIN128AEAD_EMU_CYC_STEP);
+
+	// INIT_CORE_ACC_*, then INIT_CORE_SR_*: the key is fed again, GRAIN128AEAD_EMU_PARALLEL bits per NEXT_Z and
+	// LOAD_AUTH_x
+	for (i = 0; i < 64; i++)
+		c->acc[i] = EMU_next_z(c, EMU_ADD_KEY, ( key[i/8] >> (i%8) ) & 1);
+	for (i = 0; i < 64; i++)
+		c->sr[i] = EMU_next_z(c, EMU_ADD_KEY, ( key[8 + i/8] >> (i%8) ) & 1);
+	cyc += EMU_count(perf, EMU_PERF_ADDKEY, ( 128 / GRAIN128AEAD_EMU_PARALLEL ) *
+					 ( 2 * GRAIN128AEAD_EMU_CYC_CORE_OP + GRAIN128AEAD_EMU_CYC_LATCH ) + 2 * GRAIN128AEAD_EMU_CYC_STEP);
+
+	return cyc;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Controller
+// ------------------------------------------------------------------------------------------------
+
+// Words the CPU has to write before the controller of a single-packet transaction reads the whole packet
+static uint32_t EMU_words_needed(const EMU_IP *ip, const FPGA_IPM_DATA *bank)
+{
+	int lsub = bank[EMU_ADDR_LENGTH] >> 8;
+	int lad = bank[EMU_ADDR_LENGTH] & 0xFF;
+
+	return EMU_WORDS_KEY + EMU_WORDS_IV + 1 + (lad+1)/2 + (lsub+1)/2 + ( ip->decrypt ? EMU_WORDS_MAC : 0 );
+}
+
+// MSG_PIPE: a clock per access to the data buffer, the write-back FIFO before the prefetch FIFO, while the core
+// takes a prefetched word per clock; a read is answered two clocks later, the output of the core one clock later.
+// The trailing byte of an odd packet is written back in the upper half of its word. Returns the clocks of the
+// state, the exit included.
+static uint64_t EMU_msg_pipe(int lsub)
+{
+	int words = (lsub+1)/2, writes = words;
+	int fetch = 0, fetched = 0, ciphered = 0, out = 0, written = 0;
+	int pending[2] = { 0, 0 }, stream = 0;
+	uint64_t cyc = GRAIN128AEAD_EMU_CYC_STEP;
+
+	while ( written < writes || out < words ) {
+		int issue = 0, next_stream = 0;
+
+		if ( written < out && written < writes )
+			written++;
+		else if ( fetch < words && fetch - ciphered < GRAIN128AEAD_EMU_PIPE_DEPTH ) {
+			fetch++;
+			issue = 1;
+		}
+		if ( ciphered < fetched && ciphered - written < GRAIN128AEAD_EMU_PIPE_DEPTH ) {
+			ciphered++;
+			next_stream = 1;
+		}
+		out += stream;
+		stream = next_stream;
+		fetched += pending[1];
+		pending[1] = pending[0];
+		pending[0] = issue;
+		cyc += GRAIN128AEAD_EMU_CYC_STEP;
+	}
+	return cyc;
+}
+
+// Process the packet of the current bank, from the reading of its words to the writing of the status.
+// The results are kept in ip->out until the packet is done. Returns the cycles of the controller, head the
+// ones up to the initialisation of the core, which does not wait for the words after the IV.
+static uint64_t EMU_run_packet(EMU_IP *ip, uint64_t *head)
+{
+	const FPGA_IPM_DATA *bank = ip->banks[ip->cur_bank];
+	EMU_CIPHER *c = &ip->cipher;
+	FPGA_IPM_DATA words[EMU_WORDS], res[EMU_WORDS];
+	FPGA_IPM_DATA length;
+	uint8_t key[16], iv[12], mac[8], tag[8];
+	uint8_t ad[EMU_AD_MAX+1];		// AD register of the controller: byte k of the AD at ad[lad-1-k], the DER length at ad[lad]
+	int msg_addr, lsub, lad, mac_in, i, j;
+	uint8_t auth_fail = 0;
+	uint64_t cyc = 0;
+
+	ip->out_mask = 0;
+	ip->out_bank = ip->cur_bank;
+
+	// READ_BANK
+	if ( ip->stream )
+		cyc += EMU_count(ip->perf, EMU_PERF_IDLE, GRAIN128AEAD_EMU_CYC_BUF_READ);
+
+	if ( ip->set_init ) {
+		EMU_fetch(ip, bank, EMU_ADDR_KEY, EMU_WORDS_KEY, words);
+		for (i = 0; i < 16; i++)
+			key[i] = EMU_byte(words, i);
+		EMU_fetch(ip, bank, EMU_ADDR_IV, EMU_WORDS_IV, words);
+		for (i = 0; i < 12; i++)
+			iv[i] = EMU_byte(words, i);
+		cyc += EMU_count(ip->perf, EMU_PERF_LOAD, ( EMU_WORDS_KEY + EMU_WORDS_IV ) * GRAIN128AEAD_EMU_CYC_BUF_READ);
+		// INIT_CORE_*, right after the IV
+		cyc += EMU_init_cipher(c, key, iv, ip->perf);
+		length = bank[EMU_ADDR_LENGTH];
+		msg_addr = EMU_ADDR_MSG_INIT;
+	} else {
+		length = bank[EMU_ADDR_LENGTH_NEXT];
+		msg_addr = EMU_ADDR_MSG_NEXT;
+	}
+	*head = cyc;
+	lsub = length >> 8;
+	lad = length & 0xFF;
+	cyc += EMU_count(ip->perf, EMU_PERF_LOAD, GRAIN128AEAD_EMU_CYC_BUF_READ);
+
+	// READ_AD: an odd length leaves the lower half of the last word unused, an empty AD is not read
+	if ( ip->set_init ) {
+		if ( lad > EMU_AD_MAX )
+			lad = EMU_AD_MAX;
+		EMU_fetch(ip, bank, EMU_ADDR_AD, (lad+1)/2, words);
+		for (i = 0; i < lad; i++)
+			ad[lad-1-i] = EMU_byte(words, i);
+		ad[lad] = lad;
+		cyc += EMU_count(ip->perf, EMU_PERF_LOAD, ( (lad+1)/2 ) * GRAIN128AEAD_EMU_CYC_BUF_READ);
+	}
+
+	// READ_MAC_DECRYPTION: the MAC on the word after the message, which is read by MSG_PIPE
+	mac_in = ip->decrypt && ip->last;
+	EMU_fetch(ip, bank, msg_addr, (lsub+1)/2, words);
+	if ( mac_in ) {
+		FPGA_IPM_DATA mac_words[EMU_WORDS_MAC];
+		EMU_fetch(ip, bank, msg_addr + (lsub+1)/2, EMU_WORDS_MAC, mac_words);
+		for (i = 0; i < 8; i++)
+			mac[i] = EMU_byte(mac_words, i);
+		cyc += EMU_count(ip->perf, EMU_PERF_LOAD, EMU_WORDS_MAC * GRAIN128AEAD_EMU_CYC_BUF_READ);
+	}
+
+	if ( ip->set_init ) {
+		// TAG_STREAM: the AD register from ad[lad] down, i.e. the DER length of the AD and then the AD, two bytes
+		// per word; every other keystream bit goes to the shift register
+		for (i = 0; i < 8*(lad+1); i++) {
+			uint8_t byte = ad[lad - i/8];
+			EMU_next_z(c, EMU_NORMAL, 0);
+			EMU_auth_bit(c, ( byte >> (i%8) ) & 1, EMU_next_z(c, EMU_NORMAL, 0));
+		}
+		cyc += EMU_count(ip->perf, EMU_PERF_AD, ( (lad+2) / 2 ) * GRAIN128AEAD_EMU_CYC_STREAM + GRAIN128AEAD_EMU_CYC_STEP);
+	}
+
+	// MSG_PIPE: one keystream bit ciphers the message bit, the next one goes to the shift
+	// register, the message bit decides whether to accumulate
+	memset(res, 0, sizeof(res));
+	for (i = 0; i < 8*lsub; i++) {
+		uint8_t in = ( EMU_byte(words, i/8) >> (i%8) ) & 1;
+		uint8_t out = in ^ EMU_next_z(c, EMU_NORMAL, 0);
+		uint8_t msg_bit = ip->decrypt ? out : in;
+
+		EMU_auth_bit(c, msg_bit, EMU_next_z(c, EMU_NORMAL, 0));
+		if ( out )
+			EMU_set_byte(res, i/8, EMU_byte(res, i/8) | ( 1 << (i%8) ));
+	}
+	EMU_store(ip, msg_addr, (lsub+1)/2, res);
+	cyc += EMU_count(ip->perf, EMU_PERF_MSG, EMU_msg_pipe(lsub));
+
+	if ( ip->last ) {
+		// PAD_STREAM: the padding bit of the message, in a byte of its own
+		for (i = 0; i < 8; i++) {
+			EMU_next_z(c, EMU_NORMAL, 0);
+			EMU_auth_bit(c, i == 0, EMU_next_z(c, EMU_NORMAL, 0));
+		}
+		cyc += EMU_count(ip->perf, EMU_PERF_MSG, GRAIN128AEAD_EMU_CYC_STREAM + GRAIN128AEAD_EMU_CYC_STEP);
+
+		// GET_MAC
+		for (i = 0; i < 8; i++) {
+			tag[i] = 0;
+			for (j = 0; j < 8; j++)
+				tag[i] |= c->acc[8*i + j] << j;
+		}
+		cyc += EMU_count(ip->perf, EMU_PERF_MAC, 4 * ( GRAIN128AEAD_EMU_CYC_CORE_OP + GRAIN128AEAD_EMU_CYC_LATCH ) +
+						 GRAIN128AEAD_EMU_CYC_STEP);
+
+		// COMPARE_MAC, then ZERO_OUTPUT on a mismatch: the plaintext and the tag are cleared, a word per clock
+		if ( mac_in ) {
+			auth_fail = memcmp(tag, mac, 8) != 0;
+			cyc += EMU_count(ip->perf, EMU_PERF_MAC, GRAIN128AEAD_EMU_CYC_STEP);
+			if ( auth_fail ) {
+				memset(res, 0, sizeof(res));
+				memset(tag, 0, sizeof(tag));
+				EMU_store(ip, msg_addr, (lsub+1)/2, res);
+				cyc += EMU_count(ip->perf, EMU_PERF_MAC, ( (lsub+1)/2 ) * GRAIN128AEAD_EMU_CYC_STREAM + GRAIN128AEAD_EMU_CYC_STEP);
+			}
+		}
+	}
+
+	// WRITE_MAC at the end of the message, then UPDATE_STATE
+	if ( ip->last ) {
+		FPGA_IPM_DATA tag_words[EMU_WORDS_MAC];
+		for (i = 0; i < 8; i++)
+			EMU_set_byte(tag_words, i, tag[i]);
+		EMU_store(ip, EMU_ADDR_MAC, EMU_WORDS_MAC, tag_words);
+		cyc += EMU_count(ip->perf, EMU_PERF_MAC, EMU_WORDS_MAC * GRAIN128AEAD_EMU_CYC_BUF_WRITE + GRAIN128AEAD_EMU_CYC_STEP);
+	}
+	// WRITE_PERF before the last status word of the transaction: 32 bits per phase, low word first
+	if ( ip->last && ( !ip->batch || ip->batch_last ) ) {
+		for (i = 0; i < EMU_PERF_PHASES; i++) {
+			ip->out[EMU_ADDR_PERF + 2*i] = ip->perf[i] & 0xFFFF;
+			ip->out[EMU_ADDR_PERF + 2*i + 1] = ( ip->perf[i] >> 16 ) & 0xFFFF;
+			ip->out_mask |= 3ULL << ( EMU_ADDR_PERF + 2*i );
+		}
+		cyc += 2 * EMU_PERF_PHASES * GRAIN128AEAD_EMU_CYC_STEP;
+	}
+	ip->out[EMU_ADDR_STATUS] = auth_fail ? EMU_STATUS_FAIL : EMU_STATUS_DONE;
+	ip->out_mask |= 1ULL << EMU_ADDR_STATUS;
+	cyc += 2 * GRAIN128AEAD_EMU_CYC_STEP;
+
+	stats.packets++;
+	stats.busy_cycles += cyc;
+	stats.auth_failures += auth_fail;
+
+	return cyc;
+}
+
+// Let the controller go on up to the current cycle
+static void EMU_advance(EMU_IP *ip)
+{
+	const FPGA_IPM_DATA *bank;
+	uint64_t start, head, cyc, rest;
+
+	if ( ip->stalled )
+		return;
+
+	for (;;) {
+		switch (ip->state) {
+			case EMU_BUSY:
+				if ( stats.cycles < ip->done_at )
+					return;
+				for (int a = 0; a < EMU_WORDS; a++)
+					if ( ip->out_mask & (1ULL << a) )
+						ip->banks[ip->out_bank][a] = ip->out[a];
+				ip->free_at = ip->done_at;
+				// CLEAR_ALL: in batch mode the next bank of the ring carries the next descriptor, in streaming
+				// mode a message packet
+				if ( ip->batch && !ip->batch_last ) {
+					ip->cur_bank = ( ip->cur_bank + 1 ) % FPGA_IPM_NUM_BANKS;
+					ip->state = EMU_WAIT_BANK;
+				} else if ( ip->stream && !ip->last ) {
+					ip->cur_bank = ( ip->cur_bank + 1 ) % FPGA_IPM_NUM_BANKS;
+					ip->set_init = 0;
+					ip->state = EMU_WAIT_BANK;
+				} else {
+					ip->state = EMU_DONE;
+				}
+				break;
+
+			case EMU_WAIT_BANK:
+				bank = ip->banks[ip->cur_bank];
+				if ( bank[EMU_ADDR_STATUS] != EMU_STATUS_READY && bank[EMU_ADDR_STATUS] != EMU_STATUS_LAST )
+					return;
+				if ( ip->batch ) {
+					ip->last = 1;
+					ip->batch_last = ( bank[EMU_ADDR_STATUS] == EMU_STATUS_LAST );
+				} else {
+					ip->last = ( bank[EMU_ADDR_STATUS] == EMU_STATUS_LAST );
+				}
+				start = ip->free_at > ip->ring_at[ip->cur_bank] ? ip->free_at : ip->ring_at[ip->cur_bank];
+				ip->perf[EMU_PERF_IDLE] += start - ip->free_at;
+				ip->done_at = start + EMU_run_packet(ip, &head);
+				ip->state = EMU_BUSY;
+				break;
+
+			// the core is initialised from the writing of the IV, the rest of the packet waits for its words
+			case EMU_WAIT_WORDS:
+				bank = ip->banks[ip->cur_bank];
+				if ( ip->wc < EMU_WORDS_KEY + EMU_WORDS_IV + 1 || ip->wc < EMU_words_needed(ip, bank) )
+					return;
+				start = ip->free_at > ip->iv_at ? ip->free_at : ip->iv_at;
+				cyc = EMU_run_packet(ip, &head);
+				rest = start + head > stats.cycles ? start + head : stats.cycles;
+				ip->perf[EMU_PERF_IDLE] += ( start - ip->free_at ) + ( rest - start - head );
+				ip->done_at = rest + cyc - head;
+				ip->state = EMU_BUSY;
+				break;
+
+			default:
+				return;
+		}
+	}
+}
+
+static void EMU_advance_all(void)
+{
+	for (int i = 0; i < FPGA_IPM_NUM_CORES; i++)
+		EMU_advance(&ips[i]);
+}
+
+// DECODE_OPCODE, when the IP Manager enables the core
+static void EMU_open(EMU_IP *ip, FPGA_IPM_DATA cw)
+{
+	uint8_t opcode = cw >> 10;
+
+	ip->enabled = 1;
+	ip->natural = ( opcode & EMU_OPCODE_NATURAL ) != 0;
+	ip->decrypt = ( opcode & EMU_OPCODE_DECRYPT ) != 0;
+	ip->stream = ( opcode & EMU_OPCODE_STREAM ) != 0;
+	ip->batch = ( opcode & EMU_OPCODE_BATCH ) != 0;
+	ip->set_init = 1;
+	ip->last = 1;
+	ip->cur_bank = 0;
+	ip->wc = 0;
+	ip->iv_at = 0;
+	ip->free_at = stats.cycles + 5 * GRAIN128AEAD_EMU_CYC_STEP;
+	// WAIT_CW to DECODE_OPCODE
+	memset(ip->perf, 0, sizeof(ip->perf));
+	ip->perf[EMU_PERF_LOAD] = 5 * GRAIN128AEAD_EMU_CYC_STEP;
+
+	switch ( opcode & EMU_OPCODE_PACKET ) {
+		case 0x20:							// init encrypt
+		case 0x22:							// init decrypt
+			ip->state = EMU_WAIT_WORDS;
+			break;
+		case 0x24:							// stream encrypt
+		case 0x26:							// stream decrypt
+			ip->state = ( cw & EMU_CW_IRQ ) ? EMU_OFF : EMU_WAIT_BANK;
+			break;
+		case 0x30:							// batch encrypt
+		case 0x32:							// batch decrypt, both refused in interrupt mode as the streams
+			ip->stream = 1;
+			ip->state = ( cw & EMU_CW_IRQ ) ? EMU_OFF : EMU_WAIT_BANK;
+			break;
+		default:							// message packets of the legacy protocol are not modelled
+			ip->state = EMU_OFF;
+			break;
+	}
+}
+
+// IP Manager: B/E=1 enables the addressed core if it is not already running, B/E=0 disables it.
+// The CPU window follows the address of row 0, a core left by the CPU keeps on running.
+static void EMU_write_row0(FPGA_IPM_DATA cw)
+{
+	int ip = ( cw & EMU_CW_IPADDR ) - 1;
+
+	row0 = cw;
+	if ( ip < 0 || ip >= FPGA_IPM_NUM_CORES )
+		return;
+	if ( cw & EMU_CW_BE ) {
+		if ( !ips[ip].enabled )
+			EMU_open(&ips[ip], cw);
+	} else {
+		ips[ip].enabled = 0;
+		ips[ip].state = EMU_OFF;
+	}
+}
+
+// Core whose banks are seen by the CPU
+static EMU_IP *EMU_cpu_ip(void)
+{
+	int ip = ( row0 & EMU_CW_IPADDR ) - 1;
+	return &ips[( ip >= 0 && ip < FPGA_IPM_NUM_CORES ) ? ip : 0];
+}
+
+// Core notified of the writes of the CPU: the one of row 0 while its transaction is open. As write_completed in
+// the IP Manager, every write counts, the bank select word and the control word closing the transaction included
+static EMU_IP *EMU_active_ip(void)
+{
+	int ip = ( row0 & EMU_CW_IPADDR ) - 1;
+
+	if ( !( row0 & EMU_CW_BE ) || ip < 0 || ip >= FPGA_IPM_NUM_CORES || !ips[ip].enabled )
+		return NULL;
+	return &ips[ip];
+}
+
+void GRAIN128AEAD_EMU_bus_read(FPGA_IPM_ADDRESS address, FPGA_IPM_DATA *data)
+{
+	pthread_mutex_lock(&bus_lock);
+	address %= EMU_WORDS;
+	stats.cycles += GRAIN128AEAD_EMU_BUS_CYCLES;
+	stats.reads++;
+	EMU_advance_all();
+
+	if ( address == EMU_ADDR_CW )
+		*data = row0;
+	else if ( address == FPGA_IPM_BANK_ADDRESS )
+		*data = bank_sel;
+	else
+		*data = EMU_cpu_ip()->banks[bank_sel % FPGA_IPM_NUM_BANKS][address];
+
+	if ( trace )
+		printf("%10llu R %2u %04X\n", (unsigned long long)stats.cycles, address, *data);
+	pthread_mutex_unlock(&bus_lock);
+}
+
+void GRAIN128AEAD_EMU_bus_write(FPGA_IPM_ADDRESS address, const FPGA_IPM_DATA *data)
+{
+	EMU_IP *ip, *active;
+	uint8_t bank;
+
+	pthread_mutex_lock(&bus_lock);
+	address %= EMU_WORDS;
+	stats.cycles += GRAIN128AEAD_EMU_BUS_CYCLES;
+	stats.writes++;
+	EMU_advance_all();
+	// the control word opening a transaction is not counted by its own core
+	active = EMU_active_ip();
+
+	if ( trace )
+		printf("%10llu W %2u %04X\n", (unsigned long long)stats.cycles, address, *data);
+
+	if ( address == EMU_ADDR_CW ) {
+		EMU_write_row0(*data);
+	} else if ( address == FPGA_IPM_BANK_ADDRESS ) {
+		bank_sel = *data;
+	} else {
+		ip = EMU_cpu_ip();
+		bank = bank_sel % FPGA_IPM_NUM_BANKS;
+		ip->banks[bank][address] = *data;
+		if ( address == EMU_ADDR_STATUS )
+			ip->ring_at[bank] = stats.cycles;
+	}
+	if ( active != NULL ) {
+		active->wc++;
+		if ( active->wc == EMU_WORDS_KEY + EMU_WORDS_IV )
+			active->iv_at = stats.cycles;
+	}
+
+	EMU_advance_all();
+	pthread_mutex_unlock(&bus_lock);
+}
+
+void GRAIN128AEAD_EMU_reset(void)
+{
+	pthread_mutex_lock(&bus_lock);
+	memset(ips, 0, sizeof(ips));
+	memset(&stats, 0, sizeof(stats));
+	row0 = 0;
+	bank_sel = 0;
+	pthread_mutex_unlock(&bus_lock);
+}
+
+void GRAIN128AEAD_EMU_stats(GRAIN128AEAD_EMU_STATS *s)
+{
+	pthread_mutex_lock(&bus_lock);
+	*s = stats;
+	pthread_mutex_unlock(&bus_lock);
+}
+
+void GRAIN128AEAD_EMU_idle(uint64_t cycles)
+{
+	pthread_mutex_lock(&bus_lock);
+	stats.cycles += cycles;
+	EMU_advance_all();
+	pthread_mutex_unlock(&bus_lock);
+}
+
+void GRAIN128AEAD_EMU_delay(uint32_t cycles)
+{
+	GRAIN128AEAD_EMU_idle(cycles);
+}
+
+void GRAIN128AEAD_EMU_stall(FPGA_IPM_CORE core, int on)
+{
+	pthread_mutex_lock(&bus_lock);
+	if ( core > 0 && core <= FPGA_IPM_NUM_CORES )
+		ips[core-1].stalled = on;
+	EMU_advance_all();
+	pthread_mutex_unlock(&bus_lock);
+}
+
+void GRAIN128AEAD_EMU_trace(int on)
+{
+	trace = on;
+}
+
+uint32_t GRAIN128AEAD_EMU_clock(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint32_t)( t.tv_sec * 1000000000ULL + t.tv_nsec );
+}
@@ -0,0 +1,426 @@
+/**
+  ******************************************************************************
+  * File Name          : jtag_emu.c
+  * Description        : Host-side simulator of the JTAG port of the MachXO2,
+                         for the VME processor of FPGA.c
+  ******************************************************************************
+  *
+  * The TAP controller changes state on every rising edge of TCK and acts on
+  * the state it leaves: capture in Capture-xR, shift in Shift-xR, update in
+  * Update-xR. The register between TDI and TDO is kept bit by bit in the
+  * order of the shift: TDO is the bit that the next rising edge replaces
+  * with TDI, so that after a whole shift bit i of the register is the i-th
+  * bit shifted in, as in the VME files.
+  *
+  * Instructions are the values seen by the device, i.e. the bytes of the VME
+  * files bit-reversed (SIR 8 TDI(07) loads IDCODE, 0xE0).
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "jtag_emu.h"
+
+#define EMU_MAX_BITS		664			// longest register, the boundary scan
+#define EMU_ROW_BYTES		16
+#define EMU_ROWS			(JTAG_EMU_CFG_ROWS + JTAG_EMU_UFM_ROWS)
+
+// JTAG pins of FPGA.c, all on GPIOE
+#define EMU_PIN_TDO			GPIO_PIN_2
+#define EMU_PIN_TDI			GPIO_PIN_3
+#define EMU_PIN_TCK			GPIO_PIN_4
+#define EMU_PIN_TMS			GPIO_PIN_5
+
+// MachXO2 instructions used by the VME algorithm
+#define EMU_ISC_ERASE		0x0E
+#define EMU_LSC_PRELOAD		0x1C
+#define EMU_ISC_DISABLE		0x26
+#define EMU_LSC_READ_STATUS	0x3C
+#define EMU_LSC_INIT_ADDRESS 0x46
+#define EMU_LSC_INIT_ADDR_UFM 0x47
+#define EMU_ISC_PROGRAM_DONE 0x5E
+#define EMU_LSC_PROG_INCR_NV 0x70
+#define EMU_LSC_READ_INCR_NV 0x73
+#define EMU_LSC_REFRESH		0x79
+#define EMU_ISC_USERCODE	0xC0
+#define EMU_ISC_PROGRAM_USERCODE 0xC2
+#define EMU_ISC_ENABLE		0xC6
+#define EMU_IDCODE			0xE0
+#define EMU_LSC_PROG_FEATURE 0xE4
+#define EMU_LSC_READ_FEATURE 0xE7
+#define EMU_LSC_CHECK_BUSY	0xF0
+#define EMU_LSC_PROG_FEABITS 0xF8
+#define EMU_LSC_READ_FEABITS 0xFB
+#define EMU_BYPASS			0xFF
+
+// operand of ISC_ERASE
+#define EMU_ERASE_SRAM		0x01
+#define EMU_ERASE_FEATURE	0x02
+#define EMU_ERASE_CFG		0x04
+#define EMU_ERASE_UFM		0x08
+
+// status register
+#define EMU_STATUS_DONE		0x00000100
+#define EMU_STATUS_ENABLED	0x00000200
+
+// IR capture: 1 in bit 0 as IEEE 1149.1 requires, bit 2 set once the DONE bit is programmed
+#define EMU_IR_CAPTURE		0x01
+#define EMU_IR_DONE			0x04
+
+// TAP states
+enum {
+	EMU_TLR, EMU_RTI,
+	EMU_SELECT_DR, EMU_CAPTURE_DR, EMU_SHIFT_DR, EMU_EXIT1_DR, EMU_PAUSE_DR, EMU_EXIT2_DR, EMU_UPDATE_DR,
+	EMU_SELECT_IR, EMU_CAPTURE_IR, EMU_SHIFT_IR, EMU_EXIT1_IR, EMU_PAUSE_IR, EMU_EXIT2_IR, EMU_UPDATE_IR
+};
+
+// next state for TMS low and high
+static const uint8_t emu_next[16][2] = {
+	[EMU_TLR]        = { EMU_RTI,        EMU_TLR },
+	[EMU_RTI]        = { EMU_RTI,        EMU_SELECT_DR },
+	[EMU_SELECT_DR]  = { EMU_CAPTURE_DR, EMU_SELECT_IR },
+	[EMU_CAPTURE_DR] = { EMU_SHIFT_DR,   EMU_EXIT1_DR },
+	[EMU_SHIFT_DR]   = { EMU_SHIFT_DR,   EMU_EXIT1_DR },
+	[EMU_EXIT1_DR]   = { EMU_PAUSE_DR,   EMU_UPDATE_DR },
+	[EMU_PAUSE_DR]   = { EMU_PAUSE_DR,   EMU_EXIT2_DR },
+	[EMU_EXIT2_DR]   = { EMU_SHIFT_DR,   EMU_UPDATE_DR },
+	[EMU_UPDATE_DR]  = { EMU_RTI,        EMU_SELECT_DR },
+	[EMU_SELECT_IR]  = { EMU_CAPTURE_IR, EMU_TLR },
+	[EMU_CAPTURE_IR] = { EMU_SHIFT_IR,   EMU_EXIT1_IR },
+	[EMU_SHIFT_IR]   = { EMU_SHIFT_IR,   EMU_EXIT1_IR },
+	[EMU_EXIT1_IR]   = { EMU_PAUSE_IR,   EMU_UPDATE_IR },
+	[EMU_PAUSE_IR]   = { EMU_PAUSE_IR,   EMU_EXIT2_IR },
+	[EMU_EXIT2_IR]   = { EMU_SHIFT_IR,   EMU_UPDATE_IR },
+	[EMU_UPDATE_IR]  = { EMU_RTI,        EMU_SELECT_DR },
+};
+
+// TAP controller and pins
+static struct {
+	uint8_t state;
+	uint8_t ir;					// current instruction
+	uint8_t reg[EMU_MAX_BITS];	// register between TDI and TDO, one bit per byte
+	uint32_t len;				// length of the register
+	uint32_t pos;				// bits shifted since the capture
+	uint8_t tck, tms, tdi;
+} tap;
+
+// MachXO2
+static struct {
+	uint8_t flash[EMU_ROWS][EMU_ROW_BYTES];	// bit i of a row in bit i%8 of byte i/8
+	uint32_t row;				// row of the next LSC_PROG_INCR_NV/LSC_READ_INCR_NV
+	uint32_t corrupt;			// configuration row programmed with a bit flipped
+	uint8_t enabled;			// programming mode (ISC_ENABLE)
+	uint8_t done;				// DONE bit of the flash
+	uint8_t configured;			// SRAM loaded from the flash: DONE bit of the status register
+	uint32_t usercode;
+	uint32_t usercode_load;		// USERCODE shifted in, programmed by ISC_PROGRAM_USERCODE
+	uint64_t feature;
+	uint16_t feabits;
+} dev;
+
+static JTAG_EMU_STATS stats;
+
+
+static uint32_t dr_length(uint8_t ir)
+{
+	switch (ir) {
+	case EMU_IDCODE: case EMU_LSC_READ_STATUS: case EMU_ISC_USERCODE:
+		return 32;
+	case EMU_LSC_PRELOAD:
+		return EMU_MAX_BITS;
+	case EMU_ISC_ENABLE: case EMU_ISC_ERASE: case EMU_LSC_INIT_ADDRESS:
+		return 8;
+	case EMU_LSC_PROG_INCR_NV: case EMU_LSC_READ_INCR_NV:
+		return 8 * EMU_ROW_BYTES;
+	case EMU_LSC_PROG_FEATURE: case EMU_LSC_READ_FEATURE:
+		return 64;
+	case EMU_LSC_PROG_FEABITS: case EMU_LSC_READ_FEABITS:
+		return 16;
+	default:
+		return 1;				// BYPASS, LSC_CHECK_BUSY (never busy) and any other instruction
+	}
+}
+
+static void load_value(uint64_t value, uint32_t len)
+{
+	for (uint32_t i = 0; i < len; i++)
+		tap.reg[i] = i < 64 ? (value >> i) & 1 : 0;
+	tap.len = len;
+	tap.pos = 0;
+}
+
+static void load_row(const uint8_t *row)
+{
+	for (uint32_t i = 0; i < 8 * EMU_ROW_BYTES; i++)
+		tap.reg[i] = (row[i / 8] >> i % 8) & 1;
+	tap.len = 8 * EMU_ROW_BYTES;
+	tap.pos = 0;
+}
+
+// bit i of the register once shifted: the register rotates by one bit at every shift
+static uint8_t reg_bit(uint32_t i)
+{
+	return tap.reg[(tap.pos + i) % tap.len];
+}
+
+static uint64_t reg_value(void)
+{
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < tap.len && i < 64; i++)
+		value |= (uint64_t)reg_bit(i) << i;
+	return value;
+}
+
+static void capture_dr(void)
+{
+	switch (tap.ir) {
+	case EMU_IDCODE:
+		load_value(JTAG_EMU_IDCODE, 32);
+		break;
+	case EMU_LSC_READ_STATUS:
+		load_value((dev.configured ? EMU_STATUS_DONE : 0) | (dev.enabled ? EMU_STATUS_ENABLED : 0), 32);
+		break;
+	case EMU_ISC_USERCODE:
+		load_value(dev.usercode, 32);
+		break;
+	case EMU_LSC_READ_INCR_NV:
+		if ( dev.row < EMU_ROWS )
+			load_row(dev.flash[dev.row++]);
+		else
+			load_value(0, dr_length(tap.ir));
+		break;
+	case EMU_LSC_READ_FEATURE:
+		load_value(dev.feature, 64);
+		break;
+	case EMU_LSC_READ_FEABITS:
+		load_value(dev.feabits, 16);
+		break;
+	default:
+		load_value(0, dr_length(tap.ir));
+		break;
+	}
+}
+
+static void update_dr(void)
+{
+	uint64_t value = reg_value();
+
+	switch (tap.ir) {
+	case EMU_ISC_ENABLE:
+		dev.enabled = 1;
+		break;
+	case EMU_ISC_ERASE:
+		if ( value & EMU_ERASE_SRAM )
+			dev.configured = 0;
+		if ( value & EMU_ERASE_FEATURE ) {
+			dev.feature = 0;
+			dev.feabits = 0;
+		}
+		if ( value & EMU_ERASE_CFG ) {
+			memset(dev.flash, 0, JTAG_EMU_CFG_ROWS * EMU_ROW_BYTES);
+			dev.usercode = 0;
+			dev.done = 0;
+		}
+		if ( value & EMU_ERASE_UFM )
+			memset(dev.flash[JTAG_EMU_CFG_ROWS], 0, JTAG_EMU_UFM_ROWS * EMU_ROW_BYTES);
+		break;
+	case EMU_LSC_INIT_ADDRESS:
+		dev.row = 0;
+		break;
+	case EMU_LSC_PROG_INCR_NV:
+		if ( !dev.enabled || dev.row >= EMU_ROWS ) {
+			stats.errors++;
+			break;
+		}
+		memset(dev.flash[dev.row], 0, EMU_ROW_BYTES);
+		for (uint32_t i = 0; i < 8 * EMU_ROW_BYTES; i++)
+			dev.flash[dev.row][i / 8] |= reg_bit(i) << i % 8;
+		if ( dev.row == dev.corrupt )
+			dev.flash[dev.row][0] ^= 0x01;
+		dev.row++;
+		stats.rows++;
+		break;
+	case EMU_ISC_USERCODE:
+		dev.usercode_load = (uint32_t)value;
+		break;
+	case EMU_LSC_PROG_FEATURE:
+		dev.feature = value;
+		break;
+	case EMU_LSC_PROG_FEABITS:
+		dev.feabits = (uint16_t)value;
+		break;
+	}
+}
+
+static void update_ir(void)
+{
+	tap.ir = (uint8_t)reg_value();
+
+	switch (tap.ir) {
+	case EMU_LSC_INIT_ADDRESS:
+		dev.row = 0;
+		break;
+	case EMU_LSC_INIT_ADDR_UFM:
+		dev.row = JTAG_EMU_CFG_ROWS;
+		break;
+	case EMU_ISC_PROGRAM_USERCODE:
+		if ( dev.enabled )
+			dev.usercode = dev.usercode_load;
+		else
+			stats.errors++;
+		break;
+	case EMU_ISC_PROGRAM_DONE:
+		if ( dev.enabled )
+			dev.done = 1;
+		else
+			stats.errors++;
+		break;
+	case EMU_ISC_DISABLE:
+	case EMU_LSC_REFRESH:
+		// leaving the programming mode loads the SRAM from the flash
+		dev.enabled = 0;
+		dev.configured = dev.done;
+		break;
+	}
+}
+
+// rising edge of TCK
+static void tap_clock(void)
+{
+	switch (tap.state) {
+	case EMU_TLR:
+		tap.ir = EMU_IDCODE;
+		break;
+	case EMU_CAPTURE_DR:
+		capture_dr();
+		break;
+	case EMU_CAPTURE_IR:
+		load_value(EMU_IR_CAPTURE | (dev.done ? EMU_IR_DONE : 0), 8);
+		break;
+	case EMU_SHIFT_DR:
+	case EMU_SHIFT_IR:
+		tap.reg[tap.pos++ % tap.len] = tap.tdi;
+		break;
+	case EMU_UPDATE_DR:
+		update_dr();
+		break;
+	case EMU_UPDATE_IR:
+		update_ir();
+		break;
+	}
+	tap.state = emu_next[tap.state][tap.tms];
+	stats.tck++;
+}
+
+static uint8_t tap_tdo(void)
+{
+	if ( tap.state != EMU_SHIFT_DR && tap.state != EMU_SHIFT_IR )
+		return 0;
+	return tap.reg[tap.pos % tap.len];
+}
+
+
+void JTAG_EMU_reset(void)
+{
+	memset(&tap, 0, sizeof(tap));
+	memset(&dev, 0, sizeof(dev));
+	memset(&stats, 0, sizeof(stats));
+	tap.state = EMU_TLR;
+	tap.ir = EMU_IDCODE;
+	tap.len = 1;
+	dev.corrupt = EMU_ROWS;
+}
+
+void JTAG_EMU_stats(JTAG_EMU_STATS *s)
+{
+	*s = stats;
+}
+
+int JTAG_EMU_configured(void)
+{
+	return dev.configured;
+}
+
+void JTAG_EMU_corrupt_row(uint32_t row)
+{
+	dev.corrupt = row < JTAG_EMU_CFG_ROWS ? row : EMU_ROWS;
+}
+
+
+// GPIO of the HAL: only the JTAG pins of GPIOE reach the TAP, the other pins (mux, bus) are ignored
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	uint8_t level = PinState == GPIO_PIN_SET;
+
+	if ( GPIOx != GPIOE )
+		return;
+	switch (GPIO_Pin) {
+	case EMU_PIN_TDI:
+		tap.tdi = level;
+		break;
+	case EMU_PIN_TMS:
+		tap.tms = level;
+		break;
+	case EMU_PIN_TCK:
+		if ( level && !tap.tck )
+			tap_clock();
+		tap.tck = level;
+		break;
+	default:
+		return;
+	}
+	stats.pin_accesses++;
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	if ( GPIOx != GPIOE || GPIO_Pin != EMU_PIN_TDO )
+		return GPIO_PIN_RESET;
+	stats.pin_accesses++;
+	return tap_tdo() ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+uint32_t HAL_GetTick(void)
+{
+	return (uint32_t)stats.wait_ms++;
+}
+
+
+// bulk port: the same TAP, a whole state move or shift per call
+
+static void port_move(uint8_t pattern, uint8_t pulses)
+{
+	stats.port_calls++;
+	for (uint8_t i = 0; i < pulses; i++) {
+		tap.tms = (pattern << i) & 0x80 ? 1 : 0;
+		tap_clock();
+	}
+	tap.tdi = 0;
+	tap.tms = 0;
+}
+
+static void port_shift(const uint8_t *tdi, uint8_t *tdo, uint32_t bits)
+{
+	stats.port_calls++;
+	for (uint32_t i = 0; i < bits; i++) {
+		if ( tdo != NULL ) {
+			if ( i % 8 == 0 )
+				tdo[i / 8] = 0;
+			if ( tap_tdo() )
+				tdo[i / 8] |= 0x80 >> i % 8;
+		}
+		tap.tdi = (tdi[i / 8] << i % 8) & 0x80 ? 1 : 0;
+		if ( i < bits - 1 )
+			tap_clock();
+	}
+}
+
+static void port_clocks(uint32_t clocks)
+{
+	stats.port_calls++;
+	while (clocks--)
+		tap_clock();
+}
+
+const B5_FPGA_PORT JTAG_EMU_port = { port_move, port_shift, port_clocks };
@@ -0,0 +1,775 @@
+/*
+ * main.c
+ *
+ * Regression and benchmark runner of grain128aead_fpga.c on the host-side
+ * emulator of the FPGA.
+ *
+ *   grain_emu [KAT file]            known answer tests, every AD length, streaming,
+ *                                   batch of jobs, timeouts of a stuck core, suspended
+ *                                   streams, streams refused in interrupt mode, concurrent tasks,
+ *                                   FPGA/software dispatcher, programming of the
+ *                                   bitstream on the JTAG simulator
+ *   grain_emu --bench [KAT file]    cycles and bus accesses per transaction, TCK
+ *                                   and port accesses of the programming
+ *   grain_emu --telemetry           host time of each phase of the transactions of the driver,
+ *                                   FPGA cycles of each phase of the controller
+ *
+ * The exit status is the number of failed checks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include "Fpgaipm.h"
+#include "grain128aead_fpga.h"
+#include "grain128aead_hybrid.h"
+#include "grain128aead.h"
+#include "grain128aead_emu.h"
+#include "jtag_emu.h"
+
+#define EMU_KAT_FILE		"../test/LWC_AEAD_KAT_128_96.txt"
+#define EMU_MAX_MSG			2048				// bytes of the longest message of the tests
+#define EMU_FPGA_MHZ		45					// MCO clock of the FPGA
+
+static const char hex_digits[] = "0123456789abcdef";
+static int failures;
+
+static void check(int ok, const char *what, int n)
+{
+	if ( !ok ) {
+		printf("FAIL %s (%d)\n", what, n);
+		failures++;
+	}
+}
+
+// The driver returns one nibble per byte of res, the KAT gives the hex characters
+static int same_hex(const uint8_t *nibbles, const char *hex, size_t digits)
+{
+	for (size_t i = 0; i < digits; i++)
+		if ( nibbles[i] != to_hex(hex[i]) )
+			return 0;
+	return 1;
+}
+
+// Output of a decryption that failed: no plaintext released
+static int all_zero(const uint8_t *nibbles, size_t digits)
+{
+	for (size_t i = 0; i < digits; i++)
+		if ( nibbles[i] != 0 )
+			return 0;
+	return 1;
+}
+
+static void to_chars(const uint8_t *nibbles, size_t digits, char *hex)
+{
+	for (size_t i = 0; i < digits; i++)
+		hex[i] = hex_digits[nibbles[i] & 0x0F];
+	hex[digits] = '\0';
+}
+
+static void fill_msg(char *hex, size_t bytes, int seed)
+{
+	for (size_t i = 0; i < 2*bytes; i++)
+		hex[i] = hex_digits[( i*7 + seed*3 + 1 ) % 16];
+	hex[2*bytes] = '\0';
+}
+
+static void to_bytes(const char *hex, size_t bytes, uint8_t *data)
+{
+	for (size_t i = 0; i < bytes; i++)
+		data[i] = ( to_hex(hex[2*i]) << 4 ) | to_hex(hex[2*i + 1]);
+}
+
+// Value of a "Name = value" line of the KAT file, lowercase, in field (empty if the line is of another name)
+static int kat_field(const char *line, const char *name, char *field)
+{
+	size_t len = strlen(name), i = 0;
+
+	if ( strncmp(line, name, len) != 0 || strncmp(line + len, " =", 2) != 0 )
+		return 0;
+	for (line += len + 2; *line; line++)
+		if ( isxdigit((unsigned char)*line) )
+			field[i++] = tolower((unsigned char)*line);
+	field[i] = '\0';
+	return 1;
+}
+
+// Known answer tests: encryption against CT, decryption back to PT, tampered tag.
+static void run_kat(const char *path)
+{
+	static char key[64], nonce[64], pt[256], ad[256], ct[512], line[1024];
+	static uint8_t res[512];
+	int count = 0, checked = 0;
+	FILE *f = fopen(path, "r");
+
+	if ( f == NULL ) {
+		printf("FAIL cannot open %s\n", path);
+		failures++;
+		return;
+	}
+
+	while ( fgets(line, sizeof(line), f) ) {
+		if ( kat_field(line, "Count", key) ) count = atoi(key);
+		kat_field(line, "Key", key);
+		kat_field(line, "Nonce", nonce);
+		kat_field(line, "PT", pt);
+		kat_field(line, "AD", ad);
+		if ( !kat_field(line, "CT", ct) )
+			continue;
+
+		uint64_t ptLen = strlen(pt)/2, ctLen = strlen(ct)/2;
+		uint8_t adLen = strlen(ad)/2;
+		GRAIN128AEAD_FPGA_RETURN_CODE r;
+
+		r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)key, (uint8_t *)nonce, (uint8_t *)ad, adLen, (uint8_t *)pt, ptLen, res);
+		if ( adLen > 2*GRAIN128AEAD_FPGA_WORDS_AD_MAX ) {
+			check(r == GRAIN128AEAD_FPGA_RES_INVALID_ARGUMENT, "KAT AD too long not refused", count);
+			continue;
+		}
+		check(r == GRAIN128AEAD_FPGA_RES_OK && same_hex(res, ct, 2*ctLen), "KAT encrypt", count);
+
+		r = GRAIN128AEAD_FPGA_decrypt((uint8_t *)key, (uint8_t *)nonce, (uint8_t *)ad, adLen, (uint8_t *)ct, ctLen, res);
+		check(r == GRAIN128AEAD_FPGA_RES_OK && same_hex(res, pt, 2*ptLen), "KAT decrypt", count);
+
+		ct[2*ctLen - 1] = hex_digits[to_hex(ct[2*ctLen - 1]) ^ 1];
+		r = GRAIN128AEAD_FPGA_decrypt((uint8_t *)key, (uint8_t *)nonce, (uint8_t *)ad, adLen, (uint8_t *)ct, ctLen, res);
+		check(r == GRAIN128AEAD_FPGA_RES_AUTH_FAILED, "KAT tampered tag accepted", count);
+		check(all_zero(res, 2*ptLen), "KAT tampered tag plaintext released", count);
+		checked++;
+	}
+	fclose(f);
+
+	printf("KAT: %d vectors checked\n", checked);
+}
+
+static const char *test_key = "0123456789abcdef123456789abcdef0";
+static const char *test_iv = "0123456789abcdef12345678";
+static const char *test_ad = "0011abcd";
+
+// Messages streamed over several packets: one packet every 24 bytes, a single tag for the whole message
+static void run_stream(void)
+{
+	static char msg[2*EMU_MAX_MSG + 1], ct[2*EMU_MAX_MSG + 17];
+	static uint8_t res[2*EMU_MAX_MSG + 16];
+	GRAIN128AEAD_EMU_STATS before, after;
+	GRAIN128AEAD_FPGA_RETURN_CODE r;
+
+	for (uint64_t len = 2; len <= EMU_MAX_MSG; len += ( len < 100 ? 2 : 94 )) {
+		uint64_t packets = ( len + 2*GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR - 1 ) / ( 2*GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR );
+
+		fill_msg(msg, len, (int)len);
+		GRAIN128AEAD_EMU_stats(&before);
+		r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, len, res);
+		GRAIN128AEAD_EMU_stats(&after);
+		check(r == GRAIN128AEAD_FPGA_RES_OK, "stream encrypt", (int)len);
+		check(after.packets - before.packets == packets, "stream packets", (int)len);
+
+		to_chars(res, 2*len + 16, ct);
+		r = GRAIN128AEAD_FPGA_decrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)ct, len + 8, res);
+		check(r == GRAIN128AEAD_FPGA_RES_OK && same_hex(res, msg, 2*len), "stream decrypt", (int)len);
+
+		ct[len] = hex_digits[to_hex(ct[len]) ^ 8];
+		r = GRAIN128AEAD_FPGA_decrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)ct, len + 8, res);
+		check(r == GRAIN128AEAD_FPGA_RES_AUTH_FAILED, "stream tampered ciphertext accepted", (int)len);
+		check(all_zero(res, 2*len), "stream tampered plaintext released", (int)len);
+	}
+}
+
+// A batch of jobs on all the cores gives the same results as the jobs one after the other
+static void run_batch(void)
+{
+	enum { NJ = 11 };
+	static const uint64_t lens[NJ] = { 0, 2, 24, 26, 100, 400, 600, 4, 48, 50, 300 };
+	static char msg[NJ][2*600 + 1], ct[NJ][2*600 + 17];
+	static uint8_t single[NJ][2*600 + 16], batch[NJ][2*600 + 16];
+	GRAIN128AEAD_FPGA_JOB jobs[NJ];
+	int j;
+
+	for (j = 0; j < NJ; j++) {
+		fill_msg(msg[j], lens[j], j);
+		GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg[j], lens[j], single[j]);
+		jobs[j] = (GRAIN128AEAD_FPGA_JOB){ (uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4,
+										   (uint8_t *)msg[j], lens[j], batch[j], 1, GRAIN128AEAD_FPGA_RES_OK };
+	}
+	check(GRAIN128AEAD_FPGA_run_jobs(jobs, NJ) == GRAIN128AEAD_FPGA_RES_OK, "batch encrypt", NJ);
+	for (j = 0; j < NJ; j++) {
+		check(memcmp(single[j], batch[j], 2*lens[j] + 16) == 0, "batch encrypt differs", j);
+		to_chars(batch[j], 2*lens[j] + 16, ct[j]);
+		jobs[j] = (GRAIN128AEAD_FPGA_JOB){ (uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4,
+										   (uint8_t *)ct[j], lens[j] + 8, batch[j], 0, GRAIN128AEAD_FPGA_RES_OK };
+	}
+
+	ct[5][2*lens[5] + 3] = hex_digits[to_hex(ct[5][2*lens[5] + 3]) ^ 1];	// tag of job 5
+	check(GRAIN128AEAD_FPGA_run_jobs(jobs, NJ) == GRAIN128AEAD_FPGA_RES_AUTH_FAILED, "batch decrypt", NJ);
+	for (j = 0; j < NJ; j++) {
+		check(jobs[j].res == ( j == 5 ? GRAIN128AEAD_FPGA_RES_AUTH_FAILED : GRAIN128AEAD_FPGA_RES_OK ), "batch decrypt result", j);
+		if ( j != 5 )
+			check(same_hex(batch[j], msg[j], 2*lens[j]), "batch decrypt differs", j);
+		else
+			check(all_zero(batch[j], 2*lens[j]), "batch tampered plaintext released", j);
+	}
+}
+
+// Runs of small jobs are handed over as batches, a descriptor per bank and a single completion per batch:
+// same results as the jobs one after the other, one verdict per job, with far fewer status reads
+static void run_descriptors(void)
+{
+	enum { NJ = 40, LONG = 17, MAX = 100 };
+	static char msg[NJ][2*MAX + 1], ct[NJ][2*MAX + 17];
+	static uint8_t single[NJ][2*MAX + 16], batch[NJ][2*MAX + 16];
+	static char ad[NJ][2*20 + 1];
+	GRAIN128AEAD_FPGA_JOB jobs[NJ];
+	GRAIN128AEAD_EMU_STATS before, after;
+	uint64_t len[NJ];
+	uint8_t adLen;
+	int j;
+
+	for (j = 0; j < NJ; j++) {
+		// job LONG is streamed over several packets and breaks the run in two
+		len[j] = ( j == LONG ) ? MAX : 2 * ( j % 13 );
+		adLen = j % 21;
+		fill_msg(msg[j], len[j], j);
+		fill_msg(ad[j], adLen, 100 + j);
+		GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)ad[j], adLen, (uint8_t *)msg[j], len[j], single[j]);
+		jobs[j] = (GRAIN128AEAD_FPGA_JOB){ (uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)ad[j], adLen,
+										   (uint8_t *)msg[j], len[j], batch[j], 1, GRAIN128AEAD_FPGA_RES_OK };
+	}
+	GRAIN128AEAD_EMU_stats(&before);
+	check(GRAIN128AEAD_FPGA_run_jobs(jobs, NJ) == GRAIN128AEAD_FPGA_RES_OK, "descriptors encrypt", NJ);
+	GRAIN128AEAD_EMU_stats(&after);
+	check(after.packets - before.packets == NJ - 1 + 5, "descriptors packets", NJ);
+	for (j = 0; j < NJ; j++) {
+		check(memcmp(single[j], batch[j], 2*len[j] + 16) == 0, "descriptors encrypt differs", j);
+		to_chars(batch[j], 2*len[j] + 16, ct[j]);
+		jobs[j] = (GRAIN128AEAD_FPGA_JOB){ (uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)ad[j], (uint8_t)( j % 21 ),
+										   (uint8_t *)ct[j], len[j] + 8, batch[j], 0, GRAIN128AEAD_FPGA_RES_OK };
+	}
+
+	// a tampered tag fails its own job only, whatever its place in the batch
+	ct[3][2*len[3]] = hex_digits[to_hex(ct[3][2*len[3]]) ^ 4];
+	ct[30][2*len[30] + 15] = hex_digits[to_hex(ct[30][2*len[30] + 15]) ^ 1];
+	check(GRAIN128AEAD_FPGA_run_jobs(jobs, NJ) == GRAIN128AEAD_FPGA_RES_AUTH_FAILED, "descriptors decrypt", NJ);
+	for (j = 0; j < NJ; j++) {
+		check(jobs[j].res == ( j == 3 || j == 30 ? GRAIN128AEAD_FPGA_RES_AUTH_FAILED : GRAIN128AEAD_FPGA_RES_OK ), "descriptors decrypt result", j);
+		if ( j != 3 && j != 30 )
+			check(same_hex(batch[j], msg[j], 2*len[j]), "descriptors decrypt differs", j);
+	}
+}
+
+// Every AD length of a single packet, none and odd ones included, against the C reference model: byte k of the
+// AD reaches the tag k-th, wherever it sits in the words of the packet
+static void run_ad_lengths(void)
+{
+	enum { LEN = 5, AD_MAX = 2*GRAIN128AEAD_FPGA_WORDS_AD_MAX };
+	static char msg[2*LEN + 1], ad[2*AD_MAX + 1];
+	static uint8_t res[2*LEN + 16];
+	uint8_t key[16], iv[12], ad_bytes[AD_MAX], pt[LEN], ref[LEN + 8], out[LEN + 8];
+	GRAIN128AEAD_FPGA_RETURN_CODE r;
+	int adLen;
+
+	fill_msg(msg, LEN, 17);
+	fill_msg(ad, AD_MAX, 19);
+	to_bytes(test_key, sizeof(key), key);
+	to_bytes(test_iv, sizeof(iv), iv);
+	to_bytes(ad, AD_MAX, ad_bytes);
+	to_bytes(msg, LEN, pt);
+
+	for (adLen = 0; adLen <= AD_MAX; adLen++) {
+		grain_start(key, iv, ad_bytes, adLen);
+		grain_encrypt_bytes(pt, ref, LEN);
+		grain_tag(ref + LEN);
+		r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)ad, adLen, (uint8_t *)msg, LEN, res);
+		for (int i = 0; i < LEN + 8; i++)
+			out[i] = ( res[2*i] << 4 ) | res[2*i + 1];
+		check(r == GRAIN128AEAD_FPGA_RES_OK && memcmp(out, ref, LEN + 8) == 0, "AD length", adLen);
+	}
+}
+
+// Before FPGA_IPM_init the window is never free: the driver gives up with an error instead of waiting for it
+static void run_not_initialised(void)
+{
+	enum { LEN = 64 };
+	static char msg[2*LEN + 1];
+	static uint8_t res[2*LEN + 16];
+	GRAIN128AEAD_FPGA_JOB job;
+	GRAIN128AEAD_FPGA_RETURN_CODE r;
+
+	fill_msg(msg, LEN, 3);
+	r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, 8, res);
+	check(r == GRAIN128AEAD_FPGA_RES_IPM_ERROR, "not initialised single packet", 8);
+	r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, LEN, res);
+	check(r == GRAIN128AEAD_FPGA_RES_IPM_ERROR, "not initialised stream", LEN);
+	job = (GRAIN128AEAD_FPGA_JOB){ (uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4,
+								   (uint8_t *)msg, LEN, res, 1, GRAIN128AEAD_FPGA_RES_OK };
+	r = GRAIN128AEAD_FPGA_run_jobs(&job, 1);
+	check(r == GRAIN128AEAD_FPGA_RES_IPM_ERROR && job.res == r, "not initialised jobs", 1);
+}
+
+// A stuck core makes its transactions fail with a timeout instead of hanging the driver, the other cores go on
+static void run_timeout(void)
+{
+	enum { NJ = 6, LEN = 100 };
+	static char msg[2*LEN + 1];
+	static uint8_t ref[2*LEN + 16], res[NJ][2*LEN + 16];
+	GRAIN128AEAD_FPGA_JOB jobs[NJ];
+	GRAIN128AEAD_FPGA_RETURN_CODE r;
+	int j;
+
+	fill_msg(msg, LEN, 7);
+	r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, LEN, ref);
+	check(r == GRAIN128AEAD_FPGA_RES_OK, "timeout reference", LEN);
+
+	GRAIN128AEAD_EMU_stall(1, 1);						// core of the single transactions
+	r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, 8, res[0]);
+	check(r == GRAIN128AEAD_FPGA_RES_TIMEOUT, "timeout single packet", 8);
+	memset(res[0], 0xF, 2*8);
+	r = GRAIN128AEAD_FPGA_decrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, 8 + 8, res[0]);
+	check(r == GRAIN128AEAD_FPGA_RES_TIMEOUT && all_zero(res[0], 2*8), "timeout single decrypt output", 8);
+	r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, LEN, res[0]);
+	check(r == GRAIN128AEAD_FPGA_RES_TIMEOUT, "timeout stream", LEN);
+	GRAIN128AEAD_EMU_stall(1, 0);
+
+	// the core is usable again once released
+	r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, LEN, res[0]);
+	check(r == GRAIN128AEAD_FPGA_RES_OK && memcmp(res[0], ref, 2*LEN + 16) == 0, "timeout recovery", LEN);
+
+	for (j = 0; j < NJ; j++)
+		jobs[j] = (GRAIN128AEAD_FPGA_JOB){ (uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4,
+										   (uint8_t *)msg, LEN, res[j], 1, GRAIN128AEAD_FPGA_RES_OK };
+	GRAIN128AEAD_EMU_stall(2, 1);
+	check(GRAIN128AEAD_FPGA_run_jobs(jobs, NJ) == GRAIN128AEAD_FPGA_RES_TIMEOUT, "timeout batch", NJ);
+	GRAIN128AEAD_EMU_stall(2, 0);
+	for (j = 0; j < NJ; j++) {
+		// jobs are handed over in order to the free cores: the first one given to core 2 is stuck there
+		if ( j == 1 ) {
+			check(jobs[j].res == GRAIN128AEAD_FPGA_RES_TIMEOUT, "timeout batch result", j);
+		} else {
+			check(jobs[j].res == GRAIN128AEAD_FPGA_RES_OK, "timeout batch result", j);
+			check(memcmp(res[j], ref, 2*LEN + 16) == 0, "timeout batch differs", j);
+		}
+	}
+}
+
+// A stream of another core suspended on a bank other than 0: the bank select word set back to 0 for the next
+// transaction is not counted among the words of its single packet
+static void run_suspended_bank(void)
+{
+	enum { LEN = 16, CORE = 2, BANK = 3 };
+	static char msg[2*LEN + 1];
+	static uint8_t ref[2*LEN + 16], res[2*LEN + 16];
+	GRAIN128AEAD_FPGA_RETURN_CODE r;
+
+	fill_msg(msg, LEN, 11);
+	r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, LEN, ref);
+	check(r == GRAIN128AEAD_FPGA_RES_OK, "suspended bank reference", LEN);
+
+	check(FPGA_IPM_open(CORE, GRAIN128AEAD_FPGA_OPCODE_ENCR_STREAM | GRAIN128AEAD_FPGA_OPCODE_NATURAL_ORDER, 0, 0) == 0 &&
+		  FPGA_IPM_select_bank(CORE, BANK) == 0 && FPGA_IPM_suspend(CORE) == 0, "suspended bank stream", BANK);
+	r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, LEN, res);
+	check(r == GRAIN128AEAD_FPGA_RES_OK && memcmp(res, ref, 2*LEN + 16) == 0, "single packet after a suspended bank", BANK);
+
+	check(FPGA_IPM_resume_wait(CORE) == 0 && FPGA_IPM_close(CORE) == 0, "suspended bank stream closed", BANK);
+}
+
+// A stream or a batch opened in interrupt mode is refused: a bank handed over is never processed, and the core
+// takes the next transaction in polling mode
+static void run_interrupt_refused(void)
+{
+	enum { LEN = 100, POLLS = 200, CORE = 1 };
+	static const FPGA_IPM_OPCODE opcodes[] = { GRAIN128AEAD_FPGA_OPCODE_ENCR_STREAM, GRAIN128AEAD_FPGA_OPCODE_DECR_STREAM,
+											   GRAIN128AEAD_FPGA_OPCODE_ENCR_BATCH, GRAIN128AEAD_FPGA_OPCODE_DECR_BATCH };
+	static char msg[2*LEN + 1];
+	static uint8_t ref[2*LEN + 16], res[2*LEN + 16];
+	FPGA_IPM_DATA status;
+	GRAIN128AEAD_FPGA_RETURN_CODE r;
+	int i, p;
+
+	fill_msg(msg, LEN, 13);
+	r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, LEN, ref);
+	check(r == GRAIN128AEAD_FPGA_RES_OK, "interrupt refused reference", LEN);
+
+	for (i = 0; i < 4; i++) {
+		status = GRAIN128AEAD_FPGA_STATUS_LAST;
+		check(FPGA_IPM_open(CORE, opcodes[i] | GRAIN128AEAD_FPGA_OPCODE_NATURAL_ORDER, 1, 0) == 0 &&
+			  FPGA_IPM_write(CORE, GRAIN128AEAD_FPGA_ADDR_STATUS, &status) == 0, "interrupt refused open", i);
+		for (p = 0; p < POLLS && status == GRAIN128AEAD_FPGA_STATUS_LAST; p++)
+			FPGA_IPM_read(CORE, GRAIN128AEAD_FPGA_ADDR_STATUS, &status);
+		check(status == GRAIN128AEAD_FPGA_STATUS_LAST, "interrupt refused bank processed", i);
+		status = GRAIN128AEAD_FPGA_STATUS_IDLE;
+		FPGA_IPM_write(CORE, GRAIN128AEAD_FPGA_ADDR_STATUS, &status);
+		FPGA_IPM_close(CORE);
+	}
+
+	r = GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, LEN, res);
+	check(r == GRAIN128AEAD_FPGA_RES_OK && memcmp(res, ref, 2*LEN + 16) == 0, "interrupt refused polling stream", LEN);
+}
+
+// Several tasks share the cores: the transactions of each one are serialised by the IP manager
+enum { TASKS = 4, TASK_ROUNDS = 5, TASK_JOBS = 6, TASK_MAX_MSG = 300 };
+static const uint64_t task_lens[TASK_JOBS] = { 0, 8, 24, 26, 100, 300 };
+
+typedef struct {
+	int id;
+	char msg[TASK_JOBS][2*TASK_MAX_MSG + 1];
+	uint8_t ref[TASK_JOBS][2*TASK_MAX_MSG + 16];
+	uint8_t res[TASK_JOBS][2*TASK_MAX_MSG + 16];
+	int errors;
+} TASK;
+
+static void *task_main(void *arg)
+{
+	TASK *t = arg;
+	GRAIN128AEAD_FPGA_JOB jobs[TASK_JOBS];
+	int j;
+
+	for (int round = 0; round < TASK_ROUNDS; round++) {
+		// the first task runs batches on all the cores while the others encrypt one message at a time
+		if ( t->id == 0 ) {
+			for (j = 0; j < TASK_JOBS; j++)
+				jobs[j] = (GRAIN128AEAD_FPGA_JOB){ (uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4,
+												   (uint8_t *)t->msg[j], task_lens[j], t->res[j], 1, GRAIN128AEAD_FPGA_RES_OK };
+			if ( GRAIN128AEAD_FPGA_run_jobs(jobs, TASK_JOBS) != GRAIN128AEAD_FPGA_RES_OK )
+				t->errors++;
+		} else {
+			for (j = 0; j < TASK_JOBS; j++)
+				if ( GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4,
+											   (uint8_t *)t->msg[j], task_lens[j], t->res[j]) != GRAIN128AEAD_FPGA_RES_OK )
+					t->errors++;
+		}
+		for (j = 0; j < TASK_JOBS; j++)
+			if ( memcmp(t->res[j], t->ref[j], 2*task_lens[j] + 16) != 0 )
+				t->errors++;
+	}
+	return NULL;
+}
+
+static void yield_task(void)
+{
+	sched_yield();
+}
+
+static void run_tasks(void)
+{
+	static TASK tasks[TASKS];
+	pthread_t threads[TASKS];
+	int i, j;
+
+	for (i = 0; i < TASKS; i++) {
+		tasks[i].id = i;
+		tasks[i].errors = 0;
+		for (j = 0; j < TASK_JOBS; j++) {
+			fill_msg(tasks[i].msg[j], task_lens[j], 10*i + j);
+			GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4,
+									  (uint8_t *)tasks[i].msg[j], task_lens[j], tasks[i].ref[j]);
+		}
+	}
+
+	FPGA_IPM_set_yield(yield_task);
+	for (i = 0; i < TASKS; i++)
+		pthread_create(&threads[i], NULL, task_main, &tasks[i]);
+	for (i = 0; i < TASKS; i++) {
+		pthread_join(threads[i], NULL);
+		check(tasks[i].errors == 0, "concurrent task", i);
+	}
+	FPGA_IPM_set_yield(NULL);
+
+	// nothing is left holding the window or a core
+	for (FPGA_IPM_CORE c = 1; c <= FPGA_IPM_NUM_CORES; c++) {
+		check(FPGA_IPM_open(c, GRAIN128AEAD_FPGA_OPCODE_ENCR, 0, 0) == 0, "concurrent tasks left a core busy", c);
+		FPGA_IPM_close(c);
+	}
+}
+
+// The dispatcher gives the results of the FPGA driver whatever the path, single requests and batches
+static void run_hybrid(void)
+{
+	enum { NJ = 12 };
+	static const uint64_t lens[NJ] = { 0, 2, 24, 26, 100, 400, 7, 4, 48, 50, 300, 64 };
+	static char msg[NJ][2*400 + 1], ct[NJ][2*400 + 17];
+	static uint8_t ref[NJ][2*400 + 16], res[NJ][2*400 + 16];
+	const GRAIN128AEAD_HYBRID_COST cheap = { 0, 0, 0 }, costly = { 1000000, 1 << 16, 0 };
+	GRAIN128AEAD_HYBRID_COST before[GRAIN128AEAD_HYBRID_PATHS], after[GRAIN128AEAD_HYBRID_PATHS];
+	GRAIN128AEAD_FPGA_JOB jobs[NJ];
+	GRAIN128AEAD_FPGA_RETURN_CODE r;
+	int j, p;
+
+	check(GRAIN128AEAD_HYBRID_init(GRAIN128AEAD_EMU_clock) == GRAIN128AEAD_FPGA_RES_OK, "hybrid init", 0);
+
+	for (j = 0; j < NJ; j++) {
+		fill_msg(msg[j], lens[j], j + 5);
+		GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 3, (uint8_t *)msg[j], lens[j], ref[j]);
+		to_chars(ref[j], 2*lens[j] + 16, ct[j]);
+	}
+
+	// each path in turn, by making the other one look much slower
+	for (p = 0; p < GRAIN128AEAD_HYBRID_PATHS; p++) {
+		GRAIN128AEAD_HYBRID_set_cost(p, &cheap);
+		GRAIN128AEAD_HYBRID_set_cost(!p, &costly);
+		for (j = 0; j < NJ; j++) {
+			r = GRAIN128AEAD_HYBRID_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 3, (uint8_t *)msg[j], lens[j], res[j]);
+			check(r == GRAIN128AEAD_FPGA_RES_OK && memcmp(res[j], ref[j], 2*lens[j] + 16) == 0, p ? "hybrid software encrypt" : "hybrid FPGA encrypt", j);
+			r = GRAIN128AEAD_HYBRID_decrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 3, (uint8_t *)ct[j], lens[j] + 8, res[j]);
+			check(r == GRAIN128AEAD_FPGA_RES_OK && same_hex(res[j], msg[j], 2*lens[j]), p ? "hybrid software decrypt" : "hybrid FPGA decrypt", j);
+		}
+		ct[4][2*lens[4]] = hex_digits[to_hex(ct[4][2*lens[4]]) ^ 2];
+		r = GRAIN128AEAD_HYBRID_decrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 3, (uint8_t *)ct[4], lens[4] + 8, res[4]);
+		check(r == GRAIN128AEAD_FPGA_RES_AUTH_FAILED, "hybrid tampered tag accepted", p);
+		check(all_zero(res[4], 2*lens[4]), "hybrid tampered plaintext released", p);
+		ct[4][2*lens[4]] = hex_digits[to_hex(ct[4][2*lens[4]]) ^ 2];
+	}
+
+	// a batch split between the paths, with the same cost model on both
+	GRAIN128AEAD_HYBRID_set_cost(GRAIN128AEAD_HYBRID_FPGA, &costly);
+	GRAIN128AEAD_HYBRID_set_cost(GRAIN128AEAD_HYBRID_SW, &costly);
+	for (p = 0; p < GRAIN128AEAD_HYBRID_PATHS; p++)
+		GRAIN128AEAD_HYBRID_get_cost(p, &before[p]);
+	for (j = 0; j < NJ; j++)
+		jobs[j] = (GRAIN128AEAD_FPGA_JOB){ (uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 3,
+										   (uint8_t *)msg[j], lens[j], res[j], 1, GRAIN128AEAD_FPGA_RES_OK };
+	check(GRAIN128AEAD_HYBRID_run_jobs(jobs, NJ) == GRAIN128AEAD_FPGA_RES_OK, "hybrid batch", NJ);
+	for (j = 0; j < NJ; j++)
+		check(jobs[j].res == GRAIN128AEAD_FPGA_RES_OK && memcmp(res[j], ref[j], 2*lens[j] + 16) == 0, "hybrid batch differs", j);
+	for (p = 0; p < GRAIN128AEAD_HYBRID_PATHS; p++) {
+		GRAIN128AEAD_HYBRID_get_cost(p, &after[p]);
+		check(after[p].requests > before[p].requests, "hybrid batch on a single path", p);
+	}
+
+	// a new calibration from the measurements
+	check(GRAIN128AEAD_HYBRID_init(GRAIN128AEAD_EMU_clock) == GRAIN128AEAD_FPGA_RES_OK, "hybrid init", 1);
+}
+
+// Bitstream of TEST_FPGA.h programmed through both ports of FPGA.c, then a verify that must fail
+static void run_programming(void)
+{
+	JTAG_EMU_STATS gpio, bulk;
+
+	// GPIO port: every pin through the HAL
+	JTAG_EMU_reset();
+	B5_FPGA_SetPort(NULL);
+	check(B5_FPGA_Programming() == 0, "programming over the GPIO", 0);
+	JTAG_EMU_stats(&gpio);
+	check(JTAG_EMU_configured(), "DONE after programming", 0);
+	check(gpio.rows == JTAG_EMU_CFG_ROWS + JTAG_EMU_UFM_ROWS && gpio.errors == 0, "rows programmed", (int)gpio.rows);
+
+	// bulk port: the same TCK, a call per shift
+	JTAG_EMU_reset();
+	B5_FPGA_SetPort(&JTAG_EMU_port);
+	check(B5_FPGA_ForceProgramming() == 0, "programming over the bulk port", 0);
+	JTAG_EMU_stats(&bulk);
+	check(JTAG_EMU_configured() && bulk.rows == gpio.rows && bulk.errors == 0, "device after programming", (int)bulk.rows);
+	check(bulk.tck == gpio.tck && bulk.wait_ms == gpio.wait_ms, "TCK of the bulk port", (int)(bulk.tck - gpio.tck));
+	check(bulk.pin_accesses == 0 && bulk.port_calls > 0 && bulk.port_calls < gpio.pin_accesses, "port accesses", (int)bulk.port_calls);
+
+	// the bitstream programs a USERCODE of 0, which never identifies it: no skip
+	check(B5_FPGA_ReadUsercode() == 0, "USERCODE", 0);
+	check(B5_FPGA_Programming() == 0, "programming of a configured device", 0);
+
+	// a row that does not hold its value fails the verify, the device is left unconfigured
+	JTAG_EMU_reset();
+	JTAG_EMU_corrupt_row(1000);
+	check(B5_FPGA_ForceProgramming() < 0, "verify of a bad row", 0);
+	check(!JTAG_EMU_configured(), "DONE after a failed verify", 0);
+
+	B5_FPGA_SetPort(NULL);
+}
+
+// TCK, waits and accesses to the port of a programming of the bitstream, for both ports
+static void run_bench_programming(void)
+{
+	static const char *names[] = { "gpio", "bulk" };
+	JTAG_EMU_STATS stats;
+
+	printf("\n%8s %10s %10s %12s %12s  (programming)\n", "port", "TCK", "wait ms", "pin access", "port calls");
+	for (int p = 0; p < 2; p++) {
+		JTAG_EMU_reset();
+		B5_FPGA_SetPort(p ? &JTAG_EMU_port : NULL);
+		B5_FPGA_ForceProgramming();
+		JTAG_EMU_stats(&stats);
+		printf("%8s %10llu %10llu %12llu %12llu\n", names[p], (unsigned long long)stats.tck,
+			   (unsigned long long)stats.wait_ms, (unsigned long long)stats.pin_accesses,
+			   (unsigned long long)stats.port_calls);
+	}
+	B5_FPGA_SetPort(NULL);
+}
+
+// Small messages one transaction each, then as batches of descriptors on all the cores
+static void run_bench_small(void)
+{
+	enum { NJ = 64, LEN = 16 };
+	static char msg[2*LEN + 1];
+	static uint8_t res[NJ][2*LEN + 16];
+	GRAIN128AEAD_FPGA_JOB jobs[NJ];
+	GRAIN128AEAD_EMU_STATS before, after;
+	int j;
+
+	fill_msg(msg, LEN, 1);
+	printf("\n%8s %10s %8s %8s  (%d jobs of %d bytes)\n", "", "cycles", "reads", "writes", NJ, LEN);
+	GRAIN128AEAD_EMU_stats(&before);
+	for (j = 0; j < NJ; j++)
+		GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, LEN, res[j]);
+	GRAIN128AEAD_EMU_stats(&after);
+	printf("%8s %10llu %8llu %8llu\n", "single", (unsigned long long)(after.cycles - before.cycles),
+		   (unsigned long long)(after.reads - before.reads), (unsigned long long)(after.writes - before.writes));
+
+	for (j = 0; j < NJ; j++)
+		jobs[j] = (GRAIN128AEAD_FPGA_JOB){ (uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4,
+										   (uint8_t *)msg, LEN, res[j], 1, GRAIN128AEAD_FPGA_RES_OK };
+	GRAIN128AEAD_EMU_stats(&before);
+	GRAIN128AEAD_FPGA_run_jobs(jobs, NJ);
+	GRAIN128AEAD_EMU_stats(&after);
+	printf("%8s %10llu %8llu %8llu\n", "batch", (unsigned long long)(after.cycles - before.cycles),
+		   (unsigned long long)(after.reads - before.reads), (unsigned long long)(after.writes - before.writes));
+}
+
+// Cycles of the FPGA and accesses of the CPU per encryption, for several message lengths
+static void run_bench(void)
+{
+	static const uint64_t lens[] = { 0, 16, 24, 64, 256, 1024, EMU_MAX_MSG };
+	static char msg[2*EMU_MAX_MSG + 1];
+	static uint8_t res[2*EMU_MAX_MSG + 16];
+	GRAIN128AEAD_EMU_STATS before, after;
+
+	printf("%8s %10s %8s %8s %8s %10s %10s\n", "bytes", "cycles", "reads", "writes", "packets", "cyc/byte", "Mbit/s");
+	for (size_t i = 0; i < sizeof(lens)/sizeof(lens[0]); i++) {
+		fill_msg(msg, lens[i], (int)i);
+		GRAIN128AEAD_EMU_stats(&before);
+		GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, lens[i], res);
+		GRAIN128AEAD_EMU_stats(&after);
+
+		uint64_t cycles = after.cycles - before.cycles;
+		printf("%8llu %10llu %8llu %8llu %8llu %10.1f %10.3f\n", (unsigned long long)lens[i], (unsigned long long)cycles,
+			   (unsigned long long)(after.reads - before.reads), (unsigned long long)(after.writes - before.writes),
+			   (unsigned long long)(after.packets - before.packets),
+			   lens[i] ? (double)cycles / lens[i] : 0.0, (double)lens[i] * 8 * EMU_FPGA_MHZ / cycles);
+	}
+
+	run_bench_small();
+	run_bench_programming();
+}
+
+// Counters of the controller: every phase of a single packet is counted, within the cycles of its transaction;
+// a stream also waits for the CPU to hand its banks over
+static void run_counters(void)
+{
+	static char msg[2*EMU_MAX_MSG + 1];
+	static uint8_t res[2*EMU_MAX_MSG + 16];
+	static const uint64_t lens[] = { 16, 1024 };
+	GRAIN128AEAD_FPGA_HW_COUNTERS counters;
+	GRAIN128AEAD_EMU_STATS before, after;
+
+	GRAIN128AEAD_FPGA_enable_hw_counters(1);
+	for (size_t i = 0; i < sizeof(lens)/sizeof(lens[0]); i++) {
+		uint64_t sum = 0;
+
+		fill_msg(msg, lens[i], (int)i);
+		GRAIN128AEAD_FPGA_reset_hw_counters();
+		GRAIN128AEAD_EMU_stats(&before);
+		GRAIN128AEAD_FPGA_encrypt((uint8_t *)test_key, (uint8_t *)test_iv, (uint8_t *)test_ad, 4, (uint8_t *)msg, lens[i], res);
+		GRAIN128AEAD_EMU_stats(&after);
+		GRAIN128AEAD_FPGA_get_hw_counters(&counters);
+
+		check(counters.transactions == 1, "counters transactions", (int)lens[i]);
+		for (int p = 0; p < GRAIN128AEAD_FPGA_HW_PHASES; p++) {
+			check(counters.cycles[p] > 0 || ( p == GRAIN128AEAD_FPGA_HW_IDLE && lens[i] <= 24 ), "counters phase", p);
+			sum += counters.cycles[p];
+		}
+		check(sum <= after.cycles - before.cycles, "counters total", (int)lens[i]);
+	}
+	GRAIN128AEAD_FPGA_enable_hw_counters(0);
+}
+
+// Histograms of the driver and counters of the controller, over the transactions of the benchmark
+static void run_telemetry(void)
+{
+	static const char *names[GRAIN128AEAD_FPGA_PHASES] = { "format", "upload", "wait", "download", "total" };
+	static const char *hw_names[GRAIN128AEAD_FPGA_HW_PHASES] = { "load", "init", "addkey", "ad", "msg", "mac", "idle" };
+	GRAIN128AEAD_FPGA_HISTOGRAM hist;
+	GRAIN128AEAD_FPGA_HW_COUNTERS counters;
+
+	GRAIN128AEAD_FPGA_set_clock(GRAIN128AEAD_EMU_clock);
+	GRAIN128AEAD_FPGA_reset_telemetry();
+	GRAIN128AEAD_FPGA_enable_hw_counters(1);
+	run_bench();
+
+	printf("\n%-9s %8s %12s %12s %12s  (ns)\n", "phase", "count", "mean", "min", "max");
+	for (int p = 0; p < GRAIN128AEAD_FPGA_PHASES; p++) {
+		GRAIN128AEAD_FPGA_get_telemetry(p, &hist);
+		printf("%-9s %8u %12llu %12u %12u\n", names[p], hist.count,
+			   (unsigned long long)( hist.count ? hist.sum / hist.count : 0 ), hist.min, hist.max);
+		for (int b = 0; b < GRAIN128AEAD_FPGA_TELEMETRY_BINS; b++)
+			if ( hist.bins[b] )
+				printf("%9s < %-10llu %u\n", "", 1ULL << b, hist.bins[b]);
+	}
+
+	GRAIN128AEAD_FPGA_get_hw_counters(&counters);
+	printf("\n%-9s %12s  (FPGA cycles over %u transactions)\n", "phase", "cycles", counters.transactions);
+	for (int p = 0; p < GRAIN128AEAD_FPGA_HW_PHASES; p++)
+		printf("%-9s %12llu\n", hw_names[p], (unsigned long long)counters.cycles[p]);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *kat = EMU_KAT_FILE;
+	int bench = 0, telemetry = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if ( strcmp(argv[i], "--bench") == 0 )
+			bench = 1;
+		else if ( strcmp(argv[i], "--telemetry") == 0 )
+			telemetry = 1;
+		else
+			kat = argv[i];
+	}
+
+	if ( !bench && !telemetry )
+		run_not_initialised();
+
+	FPGA_IPM_init();
+	GRAIN128AEAD_EMU_reset();
+	GRAIN128AEAD_FPGA_set_delay(GRAIN128AEAD_EMU_delay);
+
+	if ( telemetry ) {
+		run_telemetry();
+		return 0;
+	}
+
+	if ( bench ) {
+		run_bench();
+		return 0;
+	}
+
+	GRAIN128AEAD_FPGA_set_clock(GRAIN128AEAD_EMU_clock);
+	run_kat(kat);
+	run_stream();
+	run_batch();
+	run_descriptors();
+	run_ad_lengths();
+
+	// every transaction of the driver so far has been timed, its phases within its total
+	{
+		GRAIN128AEAD_FPGA_HISTOGRAM hist, total;
+		uint64_t phases = 0;
+
+		GRAIN128AEAD_FPGA_get_telemetry(GRAIN128AEAD_FPGA_PHASE_TOTAL, &total);
+		for (int p = 0; p < GRAIN128AEAD_FPGA_PHASE_TOTAL; p++) {
+			GRAIN128AEAD_FPGA_get_telemetry(p, &hist);
+			check(hist.count == total.count, "telemetry count", p);
+			phases += hist.sum;
+		}
+		check(total.count > 0 && phases <= total.sum, "telemetry total", (int)total.count);
+	}
+
+	run_counters();
+	run_timeout();
+	run_suspended_bank();
+	run_interrupt_refused();
+	run_tasks();
+	run_hybrid();
+	run_programming();
+
+	printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+	return failures;
+}
@@ -0,0 +1,41 @@
+/*
+ * test_grain_emu.c
+ *
+ * Host version of API/test/src/test_grain.c: there is no UART to print on.
+ */
+
+#include <stdlib.h>
+#include "test_grain.h"
+
+void print_uart(uint8_t data[]) {
+	(void)data;
+}
+
+
+void print_uart_hex(uint8_t num) {
+	(void)num;
+}
+
+uint8_t to_hex(uint8_t num) {
+	if (num > '9')
+		num = num - 'a' + 10;
+	else
+		num = num - '0';
+
+	return num;
+}
+
+void print_uart_int(uint8_t num) {
+	(void)num;
+}
+
+void print_uart_8(uint8_t num) {
+	(void)num;
+}
+
+
+void generate_rnd_vector(uint8_t *dataout, uint16_t size) {
+	for (size_t i = 0; i < size; i++) {
+		dataout[i] = (uint8_t) rand() ;
+	}
+}
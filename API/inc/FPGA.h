@@ -25,7 +25,29 @@
 #ifndef APPLICATION_SRC_FPGA_H_
 #define APPLICATION_SRC_FPGA_H_
 
+// B5_FPGA_Programming skips erase, program and verify when the USERCODE of the device
+// matches the one the VME algorithm programs (set it in the Diamond strategy, e.g. to a
+// hash of the design): the device already runs the bitstream.
+#define B5_FPGA_ALREADY_PROGRAMMED	1
+
+// JTAG port the VME processor drives the TAP of the MachXO2 through. The bits of a shift are
+// handed over as whole bytes, the first bit in the MSB of the first byte as in the VME files.
+// B5_FPGA_SetPort(NULL) restores the default port, bit-banged on the GPIO (PE2-PE5).
+typedef struct
+{
+	// a_ucPulses TCK pulses, TMS set to the bits of a_ucPattern from the MSB; then TDI and TMS low
+	void (*move) (uint8_t a_ucPattern, uint8_t a_ucPulses);
+	// a_uiBits bits with TMS low: TDO sampled into a_pucTDO (if not NULL), then TDI set, for each bit,
+	// and a TCK pulse between two bits: the last bit is clocked by the following move or clocks
+	void (*shift) (const uint8_t *a_pucTDI, uint8_t *a_pucTDO, uint32_t a_uiBits);
+	// a_uiClocks TCK pulses, TDI and TMS unchanged
+	void (*clocks) (uint32_t a_uiClocks);
+} B5_FPGA_PORT;
+
 int32_t     B5_FPGA_Programming (void);
+int32_t     B5_FPGA_ForceProgramming (void);
+uint32_t    B5_FPGA_ReadUsercode (void);
+void        B5_FPGA_SetPort (const B5_FPGA_PORT *port);
 void        B5_FPGA_SetMux (uint8_t mux);
 void        B5_FPGA_FpgaCpuGPIO (uint8_t gpioNum, GPIO_PinState set);
 
@@ -33,6 +33,7 @@
 // class types
 #define FPGA_IPM_UINT8   uint8_t
 #define FPGA_IPM_UINT16  uint16_t
+#define FPGA_IPM_UINT32  uint32_t
 #define FPGA_IPM_BOOLEAN int
 #define FPGA_IPM_SEM     FPGA_IPM_BOOLEAN
 
@@ -41,6 +42,10 @@
 #define FPGA_IPM_ADDRESS FPGA_IPM_UINT8
 #define FPGA_IPM_DATA    FPGA_IPM_UINT16
 #define FPGA_IPM_OPCODE  FPGA_IPM_UINT8
+#define FPGA_IPM_TICKET  FPGA_IPM_UINT32
+
+/** Called while a task waits for its turn, e.g. a function calling vTaskDelay(1) under FreeRTOS */
+typedef void (*FPGA_IPM_YIELD)(void);
 
 // masks
 #define FPGA_IPM_CORE_MASK    0b1111111u
@@ -55,23 +60,67 @@
 #define FPGA_IPM_ACK 			   0b0000000100000000u
 #define FPGA_IPM_INTERRUPT_MODE    0b0000001000000000u
 #define FPGA_IPM_SRAM_BASE_ADDR    0x60000000U
+#define FPGA_IPM_BANK_ADDRESS      0x3E
+#define FPGA_IPM_NUM_BANKS         16
+#define FPGA_IPM_NUM_CORES         4
+
+// cores of the bitstream, NUM_IPS of vhdl/controller/CONSTANTS.vhd: checked when the build passes it (API/emu/Makefile)
+#if defined(FPGA_IPM_NUM_IPS) && FPGA_IPM_NUM_IPS != FPGA_IPM_NUM_CORES
+#error "FPGA_IPM_NUM_CORES differs from NUM_IPS of vhdl/controller/CONSTANTS.vhd"
+#endif
 
 // public functions
+//
+// Several tasks may share the IP manager. The CPU window of the data buffer (row 0, bank select and the words of
+// the selected bank) belongs to one transaction at a time, from FPGA_IPM_open/FPGA_IPM_resume to
+// FPGA_IPM_suspend/FPGA_IPM_close, and is taken with an atomic operation. Each core (from 1 to FPGA_IPM_NUM_CORES)
+// also has a queue of tickets: its transactions are served one at a time, in the order of the tickets, so that a
+// transaction left suspended keeps its core until it is closed. A task never holds the window while waiting for a core.
 
-/** \brief Initialise CPU-FPGA communication environment
+/** \brief Initialise CPU-FPGA communication environment, before any task uses it
  *  \return 0 on success
  */
 FPGA_IPM_BOOLEAN FPGA_IPM_init(void);
 
-/** \brief Opens a transaction with a given IP core
+/** \brief Opens a transaction with a given IP core, if nothing else holds or waits for the core and the window is free
  *  \param coreID unique identifier/address of the core
  *  \param opcode operative code to be sent to the core
  *  \param interruptMode to be set at 1 if the transaction is in interrupt mode, at 0 if it is in polling mode
  *  \param ack to be set at 1 if the transaction is an acknowledge transaction, at 0 if it is not
- *  \return Returns 0 on success
+ *  \return Returns 0 on success, 1 if the core or the window is busy
  */
 FPGA_IPM_BOOLEAN FPGA_IPM_open(FPGA_IPM_CORE coreID, FPGA_IPM_OPCODE opcode, FPGA_IPM_BOOLEAN interruptMode, FPGA_IPM_BOOLEAN ack);
 
+/** \brief Takes a place in the queue of a core; the ticket must then be opened with FPGA_IPM_try_open
+ *  \param coreID unique identifier/address of the core (from 1 to FPGA_IPM_NUM_CORES)
+ *  \return Ticket of the transaction
+ */
+FPGA_IPM_TICKET FPGA_IPM_enqueue(FPGA_IPM_CORE coreID);
+
+/** \brief Opens the transaction of a ticket if its turn has come and the window is free, without waiting
+ *  \param coreID unique identifier/address of the core
+ *  \param ticket ticket returned by FPGA_IPM_enqueue for the core (ignored for cores without a queue)
+ *  \param opcode operative code to be sent to the core
+ *  \param interruptMode to be set at 1 if the transaction is in interrupt mode, at 0 if it is in polling mode
+ *  \param ack to be set at 1 if the transaction is an acknowledge transaction, at 0 if it is not
+ *  \return Returns 0 on success, 1 if the caller has to poll again
+ */
+FPGA_IPM_BOOLEAN FPGA_IPM_try_open(FPGA_IPM_CORE coreID, FPGA_IPM_TICKET ticket, FPGA_IPM_OPCODE opcode, FPGA_IPM_BOOLEAN interruptMode, FPGA_IPM_BOOLEAN ack);
+
+/** \brief Opens a transaction with a given IP core, waiting for the transactions queued before it and for the window
+ *  \param coreID unique identifier/address of the core
+ *  \param opcode operative code to be sent to the core
+ *  \param interruptMode to be set at 1 if the transaction is in interrupt mode, at 0 if it is in polling mode
+ *  \param ack to be set at 1 if the transaction is an acknowledge transaction, at 0 if it is not
+ *  \return Returns 0 on success, 1 if the IP manager has not been initialised
+ */
+FPGA_IPM_BOOLEAN FPGA_IPM_open_wait(FPGA_IPM_CORE coreID, FPGA_IPM_OPCODE opcode, FPGA_IPM_BOOLEAN interruptMode, FPGA_IPM_BOOLEAN ack);
+
+/** \brief Selects what a task does while it waits in FPGA_IPM_open_wait and FPGA_IPM_resume_wait
+ *  \param yield function called between two attempts, NULL to spin
+ */
+void FPGA_IPM_set_yield(FPGA_IPM_YIELD yield);
+
 /** \brief Reads a 16-bit word from the buffer
  *  \param coreID unique identifier/address of the core
  *  \param address memory offset within the buffer (from 0x01 (1) to 0x3F (63))
@@ -88,6 +137,31 @@ FPGA_IPM_BOOLEAN FPGA_IPM_read(FPGA_IPM_CORE coreID, FPGA_IPM_ADDRESS address, F
  */
 FPGA_IPM_BOOLEAN FPGA_IPM_write(FPGA_IPM_CORE coreID, FPGA_IPM_ADDRESS address, FPGA_IPM_DATA *dataPtr);
 
+/** \brief Selects the bank of the buffer seen by the CPU (row 0 and the bank select word are shared by all the banks)
+ *  \param coreID unique identifier/address of the core
+ *  \param bank bank to be accessed by the following reads and writes (from 0 to FPGA_IPM_NUM_BANKS-1)
+ *  \return Returns 0 on success
+ */
+FPGA_IPM_BOOLEAN FPGA_IPM_select_bank(FPGA_IPM_CORE coreID, FPGA_IPM_UINT8 bank);
+
+/** \brief Leaves the current transaction open, so that the core keeps on working on its own banks, and frees the CPU for another core
+ *  \param coreID unique identifier/address of the core
+ *  \return Returns 0 on success
+ */
+FPGA_IPM_BOOLEAN FPGA_IPM_suspend(FPGA_IPM_CORE coreID);
+
+/** \brief Goes back to a transaction left open by FPGA_IPM_suspend
+ *  \param coreID unique identifier/address of the core (from 1 to FPGA_IPM_NUM_CORES)
+ *  \return Returns 0 on success
+ */
+FPGA_IPM_BOOLEAN FPGA_IPM_resume(FPGA_IPM_CORE coreID);
+
+/** \brief Goes back to a transaction left open by FPGA_IPM_suspend, waiting for the window
+ *  \param coreID unique identifier/address of the core (from 1 to FPGA_IPM_NUM_CORES)
+ *  \return Returns 0 on success, 1 if the core has no suspended transaction
+ */
+FPGA_IPM_BOOLEAN FPGA_IPM_resume_wait(FPGA_IPM_CORE coreID);
+
 /** \brief Closes a transaction with a given IP core
  *  \param coreID unique identifier/address of the core
  *  \return Returns 0 on success
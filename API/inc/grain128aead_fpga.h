@@ -1,8 +1,8 @@
 /**
   ******************************************************************************
-  * File Name          : sha256_fpga.h
+  * File Name          : grain128aead_fpga.h
   * Description        : High-level driver for communication between CPU and 
-                         SHA256 IP core in an IP-Manager-based environment
+                         GRAIN128AEAD IP core in an IP-Manager-based environment
   ******************************************************************************
   *
   * Copyright ï¿½ 2016-present Blu5 Group <https://www.blu5group.com>
@@ -42,6 +42,9 @@
 ///@{
 #define GRAIN128AEAD_FPGA_RES_OK				 ( 0)
 #define GRAIN128AEAD_FPGA_RES_INVALID_ARGUMENT (-1)
+#define GRAIN128AEAD_FPGA_RES_AUTH_FAILED (-2)
+#define GRAIN128AEAD_FPGA_RES_TIMEOUT (-3)
+#define GRAIN128AEAD_FPGA_RES_IPM_ERROR (-4)
 #define GRAIN128AEAD_FPGA_WORDS_INIT_PACK 12
 #define GRAIN128AEAD_FPGA_WORDS_NEXT_PACK 12
 #define GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR 12
@@ -61,9 +64,101 @@
 #define GRAIN128AEAD_FPGA_NOT_WRITE_MAC 0
 #define GRAIN128AEAD_FPGA_OPCODE_ENCR 0b0100000u
 #define GRAIN128AEAD_FPGA_OPCODE_DECR 0b0100010u
+// The stream and batch opcodes are polling only: the controller refuses them in a transaction opened in
+// interrupt mode, and never completes it
+#define GRAIN128AEAD_FPGA_OPCODE_ENCR_STREAM 0b0100100u
+#define GRAIN128AEAD_FPGA_OPCODE_DECR_STREAM 0b0100110u
+#define GRAIN128AEAD_FPGA_OPCODE_ENCR_BATCH 0b0110000u
+#define GRAIN128AEAD_FPGA_OPCODE_DECR_BATCH 0b0110010u
+#define GRAIN128AEAD_FPGA_OPCODE_NATURAL_ORDER 0b0001000u
+#define GRAIN128AEAD_FPGA_ADDR_STATUS 0x3F
+#define GRAIN128AEAD_FPGA_ADDR_PERF 44			// counters of the controller, see GRAIN128AEAD_FPGA_HW_PHASE
+#define GRAIN128AEAD_FPGA_STATUS_IDLE 0x0000
+#define GRAIN128AEAD_FPGA_STATUS_READY 0x0001
+#define GRAIN128AEAD_FPGA_STATUS_LAST 0x0002
+#define GRAIN128AEAD_FPGA_STATUS_DONE 0xFFFF
+#define GRAIN128AEAD_FPGA_STATUS_FAIL 0xFFFE
+#define GRAIN128AEAD_FPGA_NUM_CORES FPGA_IPM_NUM_CORES
+///@}
+
+/** \name GRAIN128AEAD_FPGA completion wait, in FPGA clock cycles */
+///@{
+#define GRAIN128AEAD_FPGA_CYCLES_INIT 220			// key/IV loading, 256+128 initialisation rounds, length of the AD
+#define GRAIN128AEAD_FPGA_CYCLES_PER_AD_BYTE 2		// buffer read, TAG_STREAM two bytes per cycle
+#define GRAIN128AEAD_FPGA_CYCLES_PER_MSG_BYTE 1	// MSG_PIPE: a buffer read and a buffer write per word
+#define GRAIN128AEAD_FPGA_CYCLES_PACKET 100			// decoding of a packet, MAC and status write-back
+#define GRAIN128AEAD_FPGA_CYCLES_POLL 4				// status read by the CPU (FMC access)
+#define GRAIN128AEAD_FPGA_CYCLES_WRITE 4			// word written by the CPU (FMC access)
+#define GRAIN128AEAD_FPGA_HCLK_PER_CYCLE 4			// HCLK 180 MHz, FPGA clock (MCO) 45 MHz
+#define GRAIN128AEAD_FPGA_BACKOFF_MIN 16				// first wait after the predicted completion
+#define GRAIN128AEAD_FPGA_BACKOFF_MAX 1024			// longest wait between two status reads
+#define GRAIN128AEAD_FPGA_TIMEOUT_FACTOR 4			// a packet times out after this many times its prediction...
+#define GRAIN128AEAD_FPGA_TIMEOUT_MIN 100000			// ...plus this margin
 ///@}
 /** @} */
 
+/** \name GRAIN128AEAD_FPGA telemetry */
+///@{
+#define GRAIN128AEAD_FPGA_TELEMETRY_BINS 32		// bin i counts the transactions of [2^(i-1), 2^i) ticks, bin 0 those of 0 ticks
+///@}
+
+/** Phases of a transaction timed by the driver. */
+typedef enum {
+	GRAIN128AEAD_FPGA_PHASE_FORMAT = 0,		/**< conversion of the inputs and their echo on the UART */
+	GRAIN128AEAD_FPGA_PHASE_UPLOAD,			/**< opening of the transaction, packets written onto the data buffer */
+	GRAIN128AEAD_FPGA_PHASE_WAIT,			/**< polling of the status word */
+	GRAIN128AEAD_FPGA_PHASE_DOWNLOAD,		/**< results read from the data buffer, closing of the transaction */
+	GRAIN128AEAD_FPGA_PHASE_TOTAL,			/**< whole transaction, from the call to the return */
+	GRAIN128AEAD_FPGA_PHASES
+} GRAIN128AEAD_FPGA_PHASE;
+
+/** Phases of a transaction counted by the controller, in FPGA clock cycles: 32 bits each from
+ * GRAIN128AEAD_FPGA_ADDR_PERF, low word first, written before the last status word of the transaction. */
+typedef enum {
+	GRAIN128AEAD_FPGA_HW_LOAD = 0,			/**< control word, key, IV, lengths, AD, message and MAC read from the data buffer */
+	GRAIN128AEAD_FPGA_HW_INIT,				/**< key and IV loaded in the core, pre-output clocks */
+	GRAIN128AEAD_FPGA_HW_ADDKEY,			/**< accumulator and shift register from the key */
+	GRAIN128AEAD_FPGA_HW_AD,				/**< AD through the authenticator */
+	GRAIN128AEAD_FPGA_HW_MSG,				/**< message ciphered and authenticated, output written to the data buffer */
+	GRAIN128AEAD_FPGA_HW_MAC,				/**< MAC read from the core, compared and written to the data buffer */
+	GRAIN128AEAD_FPGA_HW_IDLE,				/**< waiting for the CPU: words not written yet, banks not handed over */
+	GRAIN128AEAD_FPGA_HW_PHASES
+} GRAIN128AEAD_FPGA_HW_PHASE;
+
+/** Counters of the controller summed over the transactions read since the last reset. */
+typedef struct {
+	uint32_t transactions;
+	uint64_t cycles[GRAIN128AEAD_FPGA_HW_PHASES];
+} GRAIN128AEAD_FPGA_HW_COUNTERS;
+
+/** Free-running clock, wrapping around at 2^32 ticks. */
+typedef uint32_t (*GRAIN128AEAD_FPGA_CLOCK)(void);
+
+/** Wait for a number of FPGA clock cycles without accessing the FMC bus. */
+typedef void (*GRAIN128AEAD_FPGA_DELAY)(uint32_t cycles);
+
+/** Times of a phase over the transactions recorded so far, in ticks of the clock of the driver. */
+typedef struct {
+	uint32_t count;
+	uint64_t sum;
+	uint32_t min;
+	uint32_t max;
+	uint32_t bins[GRAIN128AEAD_FPGA_TELEMETRY_BINS];
+} GRAIN128AEAD_FPGA_HISTOGRAM;
+
+/** Encryption or decryption to be dispatched on one of the Grain cores (see GRAIN128AEAD_FPGA_run_jobs). */
+typedef struct {
+	uint8_t *key;
+	uint8_t *IV;
+	uint8_t *AD;
+	uint8_t ADlen;
+	const uint8_t *dataIN;				/**< message (encrypt) or ciphertext+MAC (decrypt) */
+	uint64_t datainLen;
+	uint8_t *res_hex;					/**< ciphertext+MAC (encrypt) or message (decrypt) */
+	uint8_t encrypt;
+	GRAIN128AEAD_FPGA_RETURN_CODE res;	/**< outcome of the job, set by GRAIN128AEAD_FPGA_run_jobs */
+} GRAIN128AEAD_FPGA_JOB;
+
 // public function
 
 /**
@@ -89,5 +184,89 @@ GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_FPGA_decrypt (
 												const uint8_t *ciphertext, uint64_t cipherLen,
 												uint8_t *msg);
 
+/**
+ * @brief Run a batch of independent jobs on the Grain cores of the FPGA: each free core takes the next job, and the
+ * CPU suspends a core while it is working to serve the other ones. A run of jobs of a single packet in the same
+ * direction is handed over to a core as one transaction, a descriptor per bank, with a single completion. Like GRAIN128AEAD_FPGA_encrypt/decrypt, it may
+ * be called by several tasks at once: each transaction waits for its turn on its core (see FPGA_IPM_open_wait).
+ * @param jobs Jobs to be run; the outcome of each one is stored in its res field.
+ * @param n Number of jobs.
+ * @return GRAIN128AEAD_FPGA_RES_OK if every job succeeded, otherwise the error of a failed job.
+ */
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_FPGA_run_jobs(GRAIN128AEAD_FPGA_JOB *jobs, uint32_t n);
+
+/** Work done by the CPU while the Grain cores are busy (see GRAIN128AEAD_FPGA_run_jobs_idle). */
+typedef void (*GRAIN128AEAD_FPGA_IDLE)(void *arg);
+
+/**
+ * @brief Same as GRAIN128AEAD_FPGA_run_jobs, calling idle after each round over the cores while some of them are
+ * still working, so that the CPU can do something else in the meantime.
+ * @param jobs Jobs to be run; the outcome of each one is stored in its res field.
+ * @param n Number of jobs.
+ * @param idle Function called between two rounds, NULL for none. It should not last longer than the time the
+ * cores take to empty their banks.
+ * @param arg Argument of idle.
+ * @return GRAIN128AEAD_FPGA_RES_OK if every job succeeded, otherwise the error of a failed job.
+ */
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_FPGA_run_jobs_idle(GRAIN128AEAD_FPGA_JOB *jobs, uint32_t n,
+															  GRAIN128AEAD_FPGA_IDLE idle, void *arg);
+
+
+/**
+ * @brief Select the clock that times the transactions. By default the driver uses the DWT cycle counter of the
+ * Cortex-M4 when it is available, otherwise the transactions are not timed until a clock is given.
+ * @param clock Clock of the driver, NULL to stop timing the transactions.
+ */
+void GRAIN128AEAD_FPGA_set_clock(GRAIN128AEAD_FPGA_CLOCK clock);
+
+/**
+ * @brief Select how the driver waits between two reads of the status word. By default it spins on the DWT cycle
+ * counter when available, otherwise on an empty loop of about one iteration per cycle.
+ * @param delay Delay function of the driver, NULL for the default one.
+ */
+void GRAIN128AEAD_FPGA_set_delay(GRAIN128AEAD_FPGA_DELAY delay);
+
+#ifdef DWT
+/**
+ * @brief Clock reading the DWT cycle counter (one tick per HCLK cycle), enabled on the first call.
+ */
+uint32_t GRAIN128AEAD_FPGA_dwt_clock(void);
+#endif
+
+/**
+ * @brief Read the times of a phase of the transactions recorded since the last reset.
+ * @param phase Phase of the transactions.
+ * @param hist Filled with the histogram of the phase.
+ */
+void GRAIN128AEAD_FPGA_get_telemetry(GRAIN128AEAD_FPGA_PHASE phase, GRAIN128AEAD_FPGA_HISTOGRAM *hist);
+
+/**
+ * @brief Clear the histograms of every phase.
+ */
+void GRAIN128AEAD_FPGA_reset_telemetry(void);
+
+/**
+ * @brief Print the count, mean, min, max and the non-empty bins of each phase on the UART, followed by the
+ * counters of the controller if they are read.
+ */
+void GRAIN128AEAD_FPGA_print_telemetry(void);
+
+/**
+ * @brief Read the counters of the controller at the end of each transaction (2*GRAIN128AEAD_FPGA_HW_PHASES words
+ * more on the FMC bus), off by default. A transaction which times out is not counted.
+ * @param on 1 to read them, 0 to stop.
+ */
+void GRAIN128AEAD_FPGA_enable_hw_counters(uint8_t on);
+
+/**
+ * @brief Read the counters of the controller summed since the last reset.
+ * @param counters Filled with the sums.
+ */
+void GRAIN128AEAD_FPGA_get_hw_counters(GRAIN128AEAD_FPGA_HW_COUNTERS *counters);
+
+/**
+ * @brief Clear the sums of the counters of the controller.
+ */
+void GRAIN128AEAD_FPGA_reset_hw_counters(void);
 
 #endif /* GRAIN128AEAD_FPGA_H_ */
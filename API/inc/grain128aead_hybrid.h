@@ -0,0 +1,104 @@
+/**
+  ******************************************************************************
+  * File Name          : grain128aead_hybrid.h
+  * Description        : Dispatcher between the GRAIN128AEAD IP cores of the
+                         FPGA and the software implementation of the cipher
+  ******************************************************************************
+  *
+  * Every request goes to the path expected to be the faster one: the FPGA
+  * path pays a fixed cost for each transaction (open/close, key and IV words,
+  * polling) that the software path does not, while its cost per byte is
+  * lower. Each path has a linear cost model, fixed + per_byte * bytes, that is
+  * measured by GRAIN128AEAD_HYBRID_init and updated by every request it
+  * serves, in ticks of the clock given to GRAIN128AEAD_HYBRID_init.
+  *
+  * Inputs and outputs are the same as GRAIN128AEAD_FPGA_encrypt/decrypt: the
+  * results do not depend on the path. Requests the FPGA driver refuses are
+  * always sent to the FPGA path.
+  *
+  ******************************************************************************
+  */
+
+#ifndef GRAIN128AEAD_HYBRID_H_
+#define GRAIN128AEAD_HYBRID_H_
+
+#include <stdint.h>
+#include "grain128aead_fpga.h"
+
+/** \name GRAIN128AEAD_HYBRID constants */
+///@{
+#define GRAIN128AEAD_HYBRID_CALIB_BYTES 64		// message of the measurement of the cost per byte
+#define GRAIN128AEAD_HYBRID_MAX_BATCH 16		// jobs of a batch handed over to the FPGA at a time
+#define GRAIN128AEAD_HYBRID_EWMA_SHIFT 3		// a new measurement weighs 1/8 in the cost model
+///@}
+
+/** Paths a request can take. */
+typedef enum {
+	GRAIN128AEAD_HYBRID_FPGA = 0,
+	GRAIN128AEAD_HYBRID_SW = 1,
+	GRAIN128AEAD_HYBRID_PATHS
+} GRAIN128AEAD_HYBRID_PATH;
+
+/** Clock used to measure the requests, e.g. the one of the driver (GRAIN128AEAD_FPGA_dwt_clock). */
+typedef GRAIN128AEAD_FPGA_CLOCK GRAIN128AEAD_HYBRID_CLOCK;
+
+/** Cost model of a path. */
+typedef struct {
+	uint32_t fixed;						/**< ticks of a request without message */
+	uint32_t per_byte;					/**< ticks per message byte, in 1/256 of tick */
+	uint32_t requests;					/**< requests served by the path */
+} GRAIN128AEAD_HYBRID_COST;
+
+/**
+ * @brief Measure the cost model of both paths with an encryption without message and one of
+ * GRAIN128AEAD_HYBRID_CALIB_BYTES bytes on each path. FPGA_IPM_init must have been called.
+ * @param clock Clock used to measure every request.
+ * @return GRAIN128AEAD_FPGA_RES_OK, or the error of a failed measurement.
+ */
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_HYBRID_init(GRAIN128AEAD_HYBRID_CLOCK clock);
+
+/**
+ * @brief Path a request would take.
+ * @param job Request, its res field is not used.
+ * @return Path with the lower expected cost.
+ */
+GRAIN128AEAD_HYBRID_PATH GRAIN128AEAD_HYBRID_route(const GRAIN128AEAD_FPGA_JOB *job);
+
+/**
+ * @brief Read the cost model of a path.
+ * @param path Path.
+ * @param cost Filled with the current model.
+ */
+void GRAIN128AEAD_HYBRID_get_cost(GRAIN128AEAD_HYBRID_PATH path, GRAIN128AEAD_HYBRID_COST *cost);
+
+/**
+ * @brief Replace the cost model of a path, e.g. with one saved from a previous run. The model is still updated
+ * by the following requests.
+ * @param path Path.
+ * @param cost New model; its requests field is not used.
+ */
+void GRAIN128AEAD_HYBRID_set_cost(GRAIN128AEAD_HYBRID_PATH path, const GRAIN128AEAD_HYBRID_COST *cost);
+
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_HYBRID_encrypt (
+												uint8_t *key,
+												uint8_t *IV,
+												uint8_t *AD, uint8_t ADlen,
+												const uint8_t *msg, uint64_t msgLen,
+												uint8_t *ciphertext);
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_HYBRID_decrypt (
+												uint8_t *key,
+												uint8_t *IV,
+												uint8_t *AD, uint8_t ADlen,
+												const uint8_t *ciphertext, uint64_t cipherLen,
+												uint8_t *msg);
+
+/**
+ * @brief Run a batch of independent jobs split between the two paths: the jobs are assigned so that both paths
+ * end at about the same time, and the CPU runs the software jobs while the Grain cores are working.
+ * @param jobs Jobs to be run; the outcome of each one is stored in its res field.
+ * @param n Number of jobs.
+ * @return GRAIN128AEAD_FPGA_RES_OK if every job succeeded, otherwise the error of a failed job.
+ */
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_HYBRID_run_jobs(GRAIN128AEAD_FPGA_JOB *jobs, uint32_t n);
+
+#endif /* GRAIN128AEAD_HYBRID_H_ */
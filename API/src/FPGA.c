@@ -23,6 +23,7 @@
   */
 
 #include <stdint.h>
+#include <stddef.h>
 #include <TEST_FPGA.h>
 #include "stm32f4xx_hal.h"
 #include "stm32f4xx.h"
@@ -82,6 +83,15 @@ uint32_t g_iDataSize = 239514;
 #define DRCAPTURE  0x06
 
 
+// MachXO2 Instructions, bit-reversed as they are shifted from the VME files
+
+#define ISC_USERCODE		0x03	/*** read the USERCODE (0xC0) ***/
+#define ISC_PROGRAM_USERCODE 0x43	/*** program the USERCODE (0xC2) ***/
+#define LSC_READ_STATUS		0x3C	/*** read the status register (0x3C) ***/
+
+#define STATUS_DONE			0x00000100	/*** the device has been configured ***/
+
+
 
 
 // VME Opcodes
@@ -156,6 +166,45 @@ uint8_t g_ucCompressCounter = 0; /*** used to indicate how many times 0xFF is re
 int16_t g_siIspPins = 0x00;   /*** holds the current byte to be sent to the hardware ***/
 char g_cCurrentJTAGState = 0;	/*** holds the current state of JTAG state machine ***/
 
+/*************************************************************
+*                                                            *
+* SHIFT BUFFERS                                              *
+*                                                            *
+*     The bits of an SIR/SDR are decoded into whole bytes    *
+*     before they are shifted: the port (see B5_FPGA_PORT)   *
+*     takes up to SHIFT_BYTES bytes at a time, enough for    *
+*     the longest register of the MachXO2 (664 bits).        *
+*                                                            *
+*************************************************************/
+#define SHIFT_BYTES 96
+
+uint8_t g_ucTDIBuffer[SHIFT_BYTES];	/*** bits shifted into TDI ***/
+uint8_t g_ucTDOBuffer[SHIFT_BYTES];	/*** bits sampled from TDO ***/
+
+/*************************************************************
+*                                                            *
+* UNPACKING WINDOWS                                          *
+*                                                            *
+*     The algorithm and data arrays are stored in blocks     *
+*     of FPGA_VME_BLOCK bytes, each one compressed on its    *
+*     own: GetByte unpacks the blocks it needs in a window   *
+*     of WINDOW_BLOCKS blocks.                               *
+*                                                            *
+*************************************************************/
+#define WINDOW_BLOCKS 2
+
+struct iWindow
+{
+	const uint8_t  *pucPacked;		/*** packed blocks ***/
+	const uint32_t *puiBlocks;		/*** offset of each packed block ***/
+	int32_t  iBlock[WINDOW_BLOCKS];	/*** block unpacked in each slot, -1 if none ***/
+	uint8_t  ucNext;				/*** slot of the next block to be unpacked ***/
+	uint8_t  ucData[WINDOW_BLOCKS][FPGA_VME_BLOCK];
+};
+
+struct iWindow g_AlgoWindow = { __fpga_alg, __fpga_alg_blocks, { -1, -1 }, 0 };
+struct iWindow g_DataWindow = { __fpga_data, __fpga_data_blocks, { -1, -1 }, 0 };
+
 int32_t  g_iLoopIndex = 0;
 int32_t  g_iLoopMovingIndex = 0;	/*** Used to point32_t to the location of LOOP data ***/
 int32_t  g_iLoopDataMovingIndex = 0;
@@ -252,14 +301,24 @@ uint32_t ispVMDataSize (void);
 int16_t ispVMShiftExec (uint32_t a_uiDataSize);
 int16_t ispVMShift (char a_cCommand);
 uint8_t GetByte (int32_t a_iCurrentIndex, char a_cAlgo);
+void ispVMUnpack (const uint8_t *a_pucPacked, uint32_t a_uiPackedSize, uint8_t *a_pucBlock);
+uint8_t ispVMWindowByte (struct iWindow *a_pWindow, int32_t a_iCurrentIndex);
 void ispVMStateMachine (char a_cNextState);
 void ispVMClocks (uint32_t a_usClocks);
 void ispVMBypass (uint32_t a_siLength);
 void sclock (void);
+void gpioMove (uint8_t a_ucPattern, uint8_t a_ucPulses);
+void gpioShift (const uint8_t *a_pucTDI, uint8_t *a_pucTDO, uint32_t a_uiBits);
+void gpioClocks (uint32_t a_uiClocks);
+uint8_t ispVMDataByte (void);
 int16_t ispVMRead (uint32_t a_uiDataSize);
 void ispVMSend (uint32_t a_uiDataSize);
 void ispVMLCOUNT (uint16_t a_usCountSize);
 void ispVMLDELAY (void);
+uint32_t ispVMReadRegister (uint8_t a_ucInstruction, uint8_t a_ucBits);
+int16_t ispVMAlgoUsercode (uint32_t *a_puiUsercode);
+int16_t ispVMAlreadyProgrammed (void);
+int32_t ispVMEntryPoint (char a_cForce);
 /*************************************************************
 *                                                            *
 * EXTERNAL FUNCTION                                          *
@@ -962,7 +1021,7 @@ int16_t ispVMShift(char a_cCommand)
 		if (g_siHeadIR > 0)
 		{
 			ispVMBypass(g_siHeadIR);
-			sclock();
+			ispVMClocks(1);
 		}
 		break;
 	case SDR:
@@ -980,7 +1039,7 @@ int16_t ispVMShift(char a_cCommand)
 		if (g_siHeadDR > 0)
 		{
 			ispVMBypass(g_siHeadDR);
-			sclock();
+			ispVMClocks(1);
 		}
 		break;
 	}
@@ -1058,7 +1117,7 @@ int16_t ispVMShift(char a_cCommand)
 	case SIR:
 		if (g_siTailIR > 0)
 		{
-			sclock();
+			ispVMClocks(1);
 			ispVMBypass(g_siTailIR);
 		}
 		ispVMStateMachine(g_cEndIR);
@@ -1066,7 +1125,7 @@ int16_t ispVMShift(char a_cCommand)
     case SDR:
 		if (g_siTailDR > 0)
 		{
-			sclock();
+			ispVMClocks(1);
 			ispVMBypass(g_siTailDR);
 		}
 		ispVMStateMachine(g_cEndDR);
@@ -1110,7 +1169,7 @@ uint8_t GetByte(int32_t a_iCurrentIndex, char a_cAlgo)
 		{
 			return (unsigned char) 0xFF;
 		}
-		ucData = (unsigned char) __fpga_alg[a_iCurrentIndex];
+		ucData = ispVMWindowByte(&g_AlgoWindow, a_iCurrentIndex);
 	}
 	else
 	{
@@ -1124,12 +1183,109 @@ uint8_t GetByte(int32_t a_iCurrentIndex, char a_cAlgo)
 		{
 			return (unsigned char) 0xFF;
 		}
-		ucData = (unsigned char) __fpga_data[a_iCurrentIndex];
+		ucData = ispVMWindowByte(&g_DataWindow, a_iCurrentIndex);
 	}
 
 	return ucData;
 }
 
+/*************************************************************
+*                                                            *
+* ISPVMUNPACK                                                *
+*                                                            *
+* INPUT:                                                     *
+*     a_pucPacked: first byte of a packed block.             *
+*                                                            *
+*     a_uiPackedSize: bytes of the packed block.             *
+*                                                            *
+*     a_pucBlock: filled with the unpacked block.            *
+*                                                            *
+* RETURN:                                                    *
+*     None.                                                  *
+*                                                            *
+* DESCRIPTION:                                               *
+*     This function unpacks a block of the VME arrays: a     *
+*     token below 0x80 is followed by token + 1 literal      *
+*     bytes, otherwise (token & 0x7F) + 4 bytes are copied   *
+*     from the offset on the next two bytes, back in the     *
+*     block (see API/tools/vme_pack.py).                     *
+*                                                            *
+*************************************************************/
+
+void ispVMUnpack(const uint8_t *a_pucPacked, uint32_t a_uiPackedSize, uint8_t *a_pucBlock)
+{
+	const uint8_t *pucEnd = a_pucPacked + a_uiPackedSize;
+	uint8_t ucToken = 0;
+	uint16_t usOffset = 0;
+	uint8_t ucCount = 0;
+
+	while (a_pucPacked < pucEnd)
+	{
+		ucToken = *a_pucPacked++;
+		if (ucToken < 0x80)
+		{
+			for (ucCount = ucToken + 1; ucCount > 0; ucCount--)
+			{
+				*a_pucBlock++ = *a_pucPacked++;
+			}
+		}
+		else
+		{
+			usOffset = a_pucPacked[0] | (uint16_t) a_pucPacked[1] << 8;
+			a_pucPacked += 2;
+			for (ucCount = (ucToken & 0x7F) + 4; ucCount > 0; ucCount--)
+			{
+				*a_pucBlock = *(a_pucBlock - usOffset);
+				a_pucBlock++;
+			}
+		}
+	}
+}
+
+/*************************************************************
+*                                                            *
+* ISPVMWINDOWBYTE                                            *
+*                                                            *
+* INPUT:                                                     *
+*     a_pWindow: window on the algorithm or data array.      *
+*                                                            *
+*     a_iCurrentIndex: index of the byte in the array.       *
+*                                                            *
+* RETURN:                                                    *
+*     The byte of the unpacked array.                        *
+*                                                            *
+* DESCRIPTION:                                               *
+*     This function returns a byte from one of the blocks    *
+*     held by the window, unpacking its block in place of    *
+*     the least recently unpacked one if needed.  The        *
+*     processor goes back and forth between the bytes of an  *
+*     instruction and its TDI/TDO/MASK data, which may lie   *
+*     on two blocks: the window holds two of them.           *
+*                                                            *
+*************************************************************/
+
+uint8_t ispVMWindowByte(struct iWindow *a_pWindow, int32_t a_iCurrentIndex)
+{
+	int32_t iBlock = a_iCurrentIndex / FPGA_VME_BLOCK;
+	uint8_t ucSlot = 0;
+
+	for (ucSlot = 0; ucSlot < WINDOW_BLOCKS; ucSlot++)
+	{
+		if (a_pWindow->iBlock[ucSlot] == iBlock)
+		{
+			return a_pWindow->ucData[ucSlot][a_iCurrentIndex % FPGA_VME_BLOCK];
+		}
+	}
+
+	ucSlot = a_pWindow->ucNext;
+	a_pWindow->ucNext = (ucSlot + 1) % WINDOW_BLOCKS;
+	ispVMUnpack(&a_pWindow->pucPacked[a_pWindow->puiBlocks[iBlock]],
+				a_pWindow->puiBlocks[iBlock + 1] - a_pWindow->puiBlocks[iBlock], a_pWindow->ucData[ucSlot]);
+	a_pWindow->iBlock[ucSlot] = iBlock;
+
+	return a_pWindow->ucData[ucSlot][a_iCurrentIndex % FPGA_VME_BLOCK];
+}
+
 /*************************************************************
 *                                                            *
 * SCLOCK                                                     *
@@ -1158,6 +1314,124 @@ void sclock()
 	writePort(pinTCK, 0x00);
 }
 
+/*************************************************************
+*                                                            *
+* GPIO PORT                                                  *
+*                                                            *
+* DESCRIPTION:                                               *
+*     The default port of the VME processor: every bit is    *
+*     bit-banged on the GPIO through readPort, writePort     *
+*     and sclock.  Another port, e.g. a JTAG simulator, can  *
+*     be selected with B5_FPGA_SetPort.                      *
+*                                                            *
+*************************************************************/
+
+void gpioMove(uint8_t a_ucPattern, uint8_t a_ucPulses)
+{
+	uint8_t ucIndex = 0;
+
+	for (ucIndex = 0; ucIndex < a_ucPulses; ucIndex++)
+	{
+		writePort(pinTMS, (uint8_t) (((a_ucPattern << ucIndex) & 0x80) ? 0x01 : 0x00));
+		sclock();
+	}
+
+	writePort(pinTDI, 0x00);
+	writePort(pinTMS, 0x00);
+}
+
+void gpioShift(const uint8_t *a_pucTDI, uint8_t *a_pucTDO, uint32_t a_uiBits)
+{
+	uint32_t uiIndex = 0;
+
+	for (uiIndex = 0; uiIndex < a_uiBits; uiIndex++)
+	{
+		if (a_pucTDO != NULL)
+		{
+			if (uiIndex % 8 == 0)
+			{
+				a_pucTDO[uiIndex / 8] = 0x00;
+			}
+			if (readPort())
+			{
+				a_pucTDO[uiIndex / 8] |= 0x80 >> uiIndex % 8;
+			}
+		}
+
+		writePort(pinTDI, (uint8_t) (((a_pucTDI[uiIndex / 8] << uiIndex % 8) & 0x80) ? 0x01 : 0x00));
+
+		if (uiIndex < a_uiBits - 1)
+		{
+			sclock();
+		}
+	}
+}
+
+void gpioClocks(uint32_t a_uiClocks)
+{
+	for (; a_uiClocks > 0; a_uiClocks--)
+	{
+		sclock();
+	}
+}
+
+const B5_FPGA_PORT g_GpioPort = { gpioMove, gpioShift, gpioClocks };
+const B5_FPGA_PORT *g_pPort = &g_GpioPort;	/*** port the TAP is driven through ***/
+
+/*************************************************************
+*                                                            *
+* ISPVMDATABYTE                                              *
+*                                                            *
+* INPUT:                                                     *
+*     None.                                                  *
+*                                                            *
+* RETURN:                                                    *
+*     The next byte of the current frame of the data array.  *
+*                                                            *
+* DESCRIPTION:                                               *
+*     This function reads the DTDI/DTDO bytes of a frame,    *
+*     expanding the runs of 0xFF of the compressed frames.   *
+*                                                            *
+*************************************************************/
+
+uint8_t ispVMDataByte()
+{
+	uint8_t ucCurByte = 0;
+
+	/*************************************************************
+	*                                                            *
+	* If the compression counter exists, then the next byte must *
+	* be 0xFF.  If it doesn't exist, then get next byte from     *
+	* data file array.                                           *
+	*                                                            *
+	*************************************************************/
+
+	if (g_ucCompressCounter)
+	{
+		g_ucCompressCounter--;
+		return (uint8_t) 0xFF;
+	}
+
+	ucCurByte = GetByte(g_iMovingDataIndex++, 0);
+
+	/*************************************************************
+	*                                                            *
+	* If the frame is compressed and the byte is 0xFF, then the  *
+	* next couple bytes must be read to determine how many       *
+	* repetitions of 0xFF are there.  That value will be stored  *
+	* in the variable g_ucCompressCounter.                       *
+	*                                                            *
+	*************************************************************/
+
+	if ((g_usDataType & COMPRESS_FRAME) &&(ucCurByte ==(uint8_t) 0xFF))
+	{
+		g_ucCompressCounter = GetByte(g_iMovingDataIndex++, 0);
+		g_ucCompressCounter--;
+	}
+
+	return ucCurByte;
+}
+
 /*************************************************************
 *                                                            *
 * ISPVMREAD                                                  *
@@ -1178,105 +1452,66 @@ void sclock()
 int16_t ispVMRead(uint32_t a_uiDataSize)
 {
 	uint32_t uiIndex = 0;
+	uint32_t uiBits = 0;
+	uint32_t uiByte = 0;
 	uint16_t usErrorCount = 0;
-	uint8_t ucTDIByte = 0;
 	uint8_t ucTDOByte = 0;
 	uint8_t ucMaskByte = 0;
-	uint8_t ucCurBit = 0;
 
-	for (uiIndex = 0;uiIndex < a_uiDataSize; uiIndex++)
+	for (uiIndex = 0; uiIndex < a_uiDataSize; uiIndex += uiBits)
 	{
-		if (uiIndex % 8 == 0)
+		uiBits = a_uiDataSize - uiIndex;
+		if (uiBits > SHIFT_BYTES * 8)
 		{
-			if ( g_usDataType & TDI_DATA ) {
-				/*************************************************************
-				*                                                            *
-				* If the TDI_DATA flag is set, then grab the next byte from  *
-				* the algo array and increment the TDI index.                *
-				*                                                            *
-				*************************************************************/
-				ucTDIByte = GetByte( g_iTDIIndex++, 1 );
-			}
-			else
-			{
-				ucTDIByte = 0xFF;
-			}
-			if (g_usDataType & TDO_DATA)
-			{
-			/*************************************************************
-			*                                                            *
-			* If the TDO_DATA flag is set, then grab the next byte from  *
-			* the algo array and increment the TDO index.                *
-			*                                                            *
-			*************************************************************/
-				ucTDOByte = GetByte(g_iTDOIndex++, 1);
-			}
-			else
-			{
-			/*************************************************************
-			*                                                            *
-			* If TDO_DATA is not set, then DTDO_DATA must be set.  If    *
-			* the compression counter exists, then the next TDO byte     *
-			* must be 0xFF.  If it doesn't exist, then get next byte     *
-			* from data file array.                                      *
-			*                                                            *
-			*************************************************************/
-				if (g_ucCompressCounter)
-				{
-					g_ucCompressCounter--;
-					ucTDOByte =(uint8_t) 0xFF;
-				}
-				else
-				{
-					ucTDOByte = GetByte(g_iMovingDataIndex++, 0);
-
-					/*************************************************************
-					*                                                            *
-					* If the frame is compressed and the byte is 0xFF, then the  *
-					* next couple bytes must be read to determine how many       *
-					* repetitions of 0xFF are there.  That value will be stored  *
-					* in the variable g_ucCompressCounter.                       *
-					*                                                            *
-					*************************************************************/
-					if ((g_usDataType & COMPRESS_FRAME) &&(ucTDOByte ==(uint8_t) 0xFF))
-					{
-						g_ucCompressCounter = GetByte(g_iMovingDataIndex++, 0);
-						g_ucCompressCounter--;
-					}
-				}
-			}
-
-			if (g_usDataType & MASK_DATA)
-			{
-				ucMaskByte = GetByte(g_iMASKIndex++, 1);
-			}
-			else
-			{
-				ucMaskByte =(uint8_t) 0xFF;
-			}
+			uiBits = SHIFT_BYTES * 8;
 		}
 
-		ucCurBit = readPort();
+		/*************************************************************
+		*                                                            *
+		* If the TDI_DATA flag is set, then grab the TDI bytes from  *
+		* the algo array, else shift 0x01 into TDI.                  *
+		*                                                            *
+		*************************************************************/
 
-		if ((((ucMaskByte << uiIndex % 8) & 0x80) ? 0x01 : 0x00))
+		for (uiByte = 0; uiByte < (uiBits + 7) / 8; uiByte++)
 		{
-			if (ucCurBit !=(uint8_t)(((ucTDOByte << uiIndex % 8) & 0x80) ? 0x01 : 0x00))
-			{
-				usErrorCount++;
-			}
+			g_ucTDIBuffer[uiByte] = (g_usDataType & TDI_DATA) ? GetByte(g_iTDIIndex++, 1) : (uint8_t) 0xFF;
 		}
 
 		/*************************************************************
 		*                                                            *
-		* Always shift 0x01 into TDI pin when reading.               *
+		* The last bit of the previous buffer is still on TDI.       *
 		*                                                            *
 		*************************************************************/
 
-		writePort(pinTDI, (uint8_t) (((ucTDIByte << uiIndex % 8) & 0x80) ? 0x01 : 0x00));
+		if (uiIndex > 0)
+		{
+			ispVMClocks(1);
+		}
+		g_pPort->shift(g_ucTDIBuffer, g_ucTDOBuffer, uiBits);
 
-		if (uiIndex < a_uiDataSize - 1)
+		for (uiByte = 0; uiByte < (uiBits + 7) / 8; uiByte++)
 		{
-			sclock();
+			/*************************************************************
+			*                                                            *
+			* If the TDO_DATA flag is set, then grab the next byte from  *
+			* the algo array and increment the TDO index.  If it is not  *
+			* set, then DTDO_DATA must be set: the next byte comes from  *
+			* the data array.                                            *
+			*                                                            *
+			*************************************************************/
+
+			ucTDOByte = (g_usDataType & TDO_DATA) ? GetByte(g_iTDOIndex++, 1) : ispVMDataByte();
+			ucMaskByte = (g_usDataType & MASK_DATA) ? GetByte(g_iMASKIndex++, 1) : (uint8_t) 0xFF;
+
+			if (uiBits - uiByte * 8 < 8)
+			{
+				ucMaskByte &= (uint8_t) (0xFF << (8 - (uiBits - uiByte * 8)));
+			}
+			if ((g_ucTDOBuffer[uiByte] ^ ucTDOByte) & ucMaskByte)
+			{
+				usErrorCount++;
+			}
 		}
 	}
 
@@ -1306,9 +1541,9 @@ int16_t ispVMRead(uint32_t a_uiDataSize)
 
 void ispVMSend(uint32_t a_uiDataSize)
 {
-	uint32_t iIndex;
-	uint8_t ucCurByte = 0;
-	uint8_t ucBitState = 0;
+	uint32_t uiIndex = 0;
+	uint32_t uiBits = 0;
+	uint32_t uiByte = 0;
 
 	/*************************************************************
 	*                                                            *
@@ -1316,64 +1551,32 @@ void ispVMSend(uint32_t a_uiDataSize)
 	*                                                            *
 	*************************************************************/
 
-	for (iIndex = 0;iIndex < a_uiDataSize; iIndex++)
+	for (uiIndex = 0; uiIndex < a_uiDataSize; uiIndex += uiBits)
 	{
-		if (iIndex % 8 == 0)
+		uiBits = a_uiDataSize - uiIndex;
+		if (uiBits > SHIFT_BYTES * 8)
 		{
-			if (g_usDataType & TDI_DATA)
-			{
-			/*************************************************************
-			*                                                            *
-			* If the TDI_DATA flag is set, then grab the next byte from  *
-			* the algo array and increment the TDI index.                *
-			*                                                            *
-			*************************************************************/
-				ucCurByte = GetByte(g_iTDIIndex++, 1);
-			}
-			else
-			{
-			/*************************************************************
-			*                                                            *
-			* If TDI_DATA flag is not set, then DTDI_DATA flag must have *
-			* already been set.  If the compression counter exists, then *
-			* the next TDI byte must be 0xFF.  If it doesn't exist, then *
-			* get next byte from data file array.                        *
-			*                                                            *
-			*************************************************************/
-				if (g_ucCompressCounter)
-				{
-					g_ucCompressCounter--;
-					ucCurByte =(uint8_t) 0xFF;
-				}
-				else
-				{
-					ucCurByte = GetByte(g_iMovingDataIndex++, 0);
+			uiBits = SHIFT_BYTES * 8;
+		}
 
-					/*************************************************************
-					*                                                            *
-					* If the frame is compressed and the byte is 0xFF, then the  *
-					* next couple bytes must be read to determine how many       *
-					* repetitions of 0xFF are there.  That value will be stored  *
-					* in the variable g_ucCompressCounter.                       *
-					*                                                            *
-					*************************************************************/
+		/*************************************************************
+		*                                                            *
+		* If the TDI_DATA flag is set, then grab the next bytes from *
+		* the algo array.  If it is not set, then DTDI_DATA must     *
+		* have already been set: they come from the data array.     *
+		*                                                            *
+		*************************************************************/
 
-					if ((g_usDataType & COMPRESS_FRAME) &&(ucCurByte ==(uint8_t) 0xFF))
-					{
-						g_ucCompressCounter = GetByte(g_iMovingDataIndex++, 0);
-						g_ucCompressCounter--;
-					}
-				}
-			}
+		for (uiByte = 0; uiByte < (uiBits + 7) / 8; uiByte++)
+		{
+			g_ucTDIBuffer[uiByte] = (g_usDataType & TDI_DATA) ? GetByte(g_iTDIIndex++, 1) : ispVMDataByte();
 		}
 
-		ucBitState =(uint8_t)(((ucCurByte << iIndex % 8) & 0x80) ? 0x01 : 0x00);
-		writePort(pinTDI, ucBitState);
-
-		if (iIndex < a_uiDataSize - 1)
+		if (uiIndex > 0)
 		{
-			sclock();
+			ispVMClocks(1);
 		}
+		g_pPort->shift(g_ucTDIBuffer, NULL, uiBits);
 	}
 }
 
@@ -1397,7 +1600,7 @@ void ispVMSend(uint32_t a_uiDataSize)
 
 void ispVMStateMachine(char a_cNextState)
 {
-	char cPathIndex, cStateIndex;
+	char cStateIndex;
 	if ((g_cCurrentJTAGState == DRPAUSE) &&(a_cNextState== DRPAUSE) && m_loopState)
 	{
 	}
@@ -1408,27 +1611,13 @@ void ispVMStateMachine(char a_cNextState)
 
 	for (cStateIndex = 0;cStateIndex < 25; cStateIndex++)
 	{
-		if ((g_cCurrentJTAGState == iStates[cStateIndex].CurState) &&(a_cNextState == iStates[cStateIndex].NextState))
+		if ((g_cCurrentJTAGState == iStates[(int)cStateIndex].CurState) &&(a_cNextState == iStates[(int)cStateIndex].NextState))
 		{
 			break;
 		}
 	}
 	g_cCurrentJTAGState = a_cNextState;
-	for (cPathIndex = 0;cPathIndex < iStates[cStateIndex].Pulses; cPathIndex++)
-	{
-		if ((iStates[cStateIndex].Pattern << cPathIndex) & 0x80)
-		{
-			writePort(pinTMS, (uint8_t) 0x01);
-		}
-		else
-		{
-			writePort(pinTMS, (uint8_t) 0x00);
-		}
-		sclock();
-	}
-
-	writePort(pinTDI, 0x00);
-	writePort(pinTMS, 0x00);
+	g_pPort->move(iStates[(int)cStateIndex].Pattern, iStates[(int)cStateIndex].Pulses);
 }
 
 /*************************************************************
@@ -1449,9 +1638,9 @@ void ispVMStateMachine(char a_cNextState)
 
 void ispVMClocks(uint32_t a_uiClocks)
 {
-	for (; a_uiClocks > 0; a_uiClocks--)
+	if (a_uiClocks > 0)
 	{
-		sclock();
+		g_pPort->clocks(a_uiClocks);
 	}
 }
 
@@ -1475,19 +1664,33 @@ void ispVMClocks(uint32_t a_uiClocks)
 
 void ispVMBypass(uint32_t a_uiLength)
 {
+	uint32_t uiIndex = 0;
+	uint32_t uiBits = 0;
+
 /*************************************************************
 *                                                            *
 * Issue a_siLength number of 0x01 to the TDI pin to bypass.  *
 *                                                            *
 *************************************************************/
 
-	for (; a_uiLength > 1; a_uiLength--)
+	for (uiIndex = 0; uiIndex < SHIFT_BYTES; uiIndex++)
 	{
-		writePort(pinTDI, (char) 0x01);
-		sclock();
+		g_ucTDIBuffer[uiIndex] = 0xFF;
 	}
 
-	writePort(pinTDI, (char) 0x01);
+	for (uiIndex = 0; uiIndex < a_uiLength; uiIndex += uiBits)
+	{
+		uiBits = a_uiLength - uiIndex;
+		if (uiBits > SHIFT_BYTES * 8)
+		{
+			uiBits = SHIFT_BYTES * 8;
+		}
+		if (uiIndex > 0)
+		{
+			ispVMClocks(1);
+		}
+		g_pPort->shift(g_ucTDIBuffer, NULL, uiBits);
+	}
 }
 /*************************************************************
 *                                                            *
@@ -1558,6 +1761,15 @@ extern int16_t ispProcessVME (void);
 extern void EnableHardware (void);
 extern void DisableHardware (void);
 
+/***************************************************************
+*
+* Programming of the USERCODE in the VME algorithm:
+*     SIR 8 TDI(ISC_USERCODE); SDR 32 TDI(usercode); SIR 8 TDI(ISC_PROGRAM_USERCODE);
+*
+***************************************************************/
+const uint8_t g_ucUsercodeLoad[] = { SIR, 8, TDI, ISC_USERCODE, CONTINUE, SDR, 32, TDI };
+const uint8_t g_ucUsercodeProgram[] = { CONTINUE, SIR, 8, TDI, ISC_PROGRAM_USERCODE, CONTINUE };
+
 /***************************************************************
 *
 * Supported VME versions.
@@ -1570,27 +1782,175 @@ char *g_szSupportedVersions[] = { (char *) "_SVME1.1", (char *) "_SVME1.2", (cha
 
 /*************************************************************
 *                                                            *
-* ISPVMENTRYPOINT                                            *
+* ISPVMREADREGISTER                                          *
 *                                                            *
 * INPUT:                                                     *
-*     a_pszAlgoFile: this is the name of the algorithm file. *
+*     a_ucInstruction: instruction selecting the register,   *
+*     bit-reversed as in the VME files.                      *
 *                                                            *
-*     a_pszDataFile: this is the name of the data file.      *
-*     Note that this argument may be empty if the algorithm  *
-*     does not require a data file.                          *
+*     a_ucBits: length of the register, up to 32 bits.       *
+*                                                            *
+* RETURN:                                                    *
+*     The value of the register, the first bit shifted out   *
+*     in bit 0.                                              *
+*                                                            *
+* DESCRIPTION:                                               *
+*     This function loads the instruction, then shifts the   *
+*     register out through the port, as the VME algorithm    *
+*     does when it verifies the USERCODE.  It leaves the TAP *
+*     in IDLE.                                               *
+*                                                            *
+*************************************************************/
+
+uint32_t ispVMReadRegister(uint8_t a_ucInstruction, uint8_t a_ucBits)
+{
+	uint32_t uiValue = 0;
+	uint8_t ucIndex = 0;
+
+	ispVMStateMachine(IRPAUSE);
+	ispVMStateMachine(SHIFTIR);
+	g_ucTDIBuffer[0] = a_ucInstruction;
+	g_pPort->shift(g_ucTDIBuffer, NULL, 8);
+	ispVMStateMachine(IDLE);
+	ispVMClocks(2);
+
+	ispVMStateMachine(DRPAUSE);
+	ispVMStateMachine(SHIFTDR);
+	for (ucIndex = 0; ucIndex < 4; ucIndex++)
+	{
+		g_ucTDIBuffer[ucIndex] = 0x00;
+	}
+	g_pPort->shift(g_ucTDIBuffer, g_ucTDOBuffer, a_ucBits);
+	for (ucIndex = 0; ucIndex < a_ucBits; ucIndex++)
+	{
+		if ((g_ucTDOBuffer[ucIndex / 8] << ucIndex % 8) & 0x80)
+		{
+			uiValue |= (uint32_t) 1 << ucIndex;
+		}
+	}
+	ispVMStateMachine(IDLE);
+
+	return uiValue;
+}
+
+/*************************************************************
+*                                                            *
+* ISPVMALGOUSERCODE                                          *
+*                                                            *
+* INPUT:                                                     *
+*     a_puiUsercode: filled with the USERCODE.               *
+*                                                            *
+* RETURN:                                                    *
+*     0 if the algorithm programs a USERCODE, -1 otherwise.  *
+*                                                            *
+* DESCRIPTION:                                               *
+*     This function looks for the programming of the         *
+*     USERCODE in the algorithm array, without running it:   *
+*     the USERCODE identifies the bitstream the VME files    *
+*     carry.                                                 *
+*                                                            *
+*************************************************************/
+
+int16_t ispVMAlgoUsercode(uint32_t *a_puiUsercode)
+{
+	int32_t iIndex = 0;
+	uint32_t uiLoad = sizeof(g_ucUsercodeLoad);
+	uint32_t uiProgram = sizeof(g_ucUsercodeProgram);
+	uint32_t uiByte = 0;
+	uint32_t uiBit = 0;
+
+	for (iIndex = 0; iIndex + uiLoad + 4 + uiProgram <= g_iAlgoSize; iIndex++)
+	{
+		for (uiByte = 0; uiByte < uiLoad && GetByte(iIndex + uiByte, 1) == g_ucUsercodeLoad[uiByte]; uiByte++);
+		if (uiByte < uiLoad)
+		{
+			continue;
+		}
+		for (uiByte = 0; uiByte < uiProgram && GetByte(iIndex + uiLoad + 4 + uiByte, 1) == g_ucUsercodeProgram[uiByte]; uiByte++);
+		if (uiByte < uiProgram)
+		{
+			continue;
+		}
+
+		/*************************************************************
+		*                                                            *
+		* Same bit order as ispVMSend: bit 0 is shifted first.       *
+		*                                                            *
+		*************************************************************/
+
+		*a_puiUsercode = 0;
+		for (uiBit = 0; uiBit < 32; uiBit++)
+		{
+			if ((GetByte(iIndex + uiLoad + uiBit / 8, 1) << uiBit % 8) & 0x80)
+			{
+				*a_puiUsercode |= (uint32_t) 1 << uiBit;
+			}
+		}
+		return 0;
+	}
+
+	return -1;
+}
+
+/*************************************************************
+*                                                            *
+* ISPVMALREADYPROGRAMMED                                     *
+*                                                            *
+* INPUT:                                                     *
+*     None.                                                  *
+*                                                            *
+* RETURN:                                                    *
+*     1 if the device runs the bitstream of the VME files,   *
+*     0 otherwise.                                           *
+*                                                            *
+* DESCRIPTION:                                               *
+*     This function compares the USERCODE of the device with *
+*     the one programmed by the algorithm.  The device must  *
+*     also be configured (DONE): an erased device reads a    *
+*     USERCODE of 0, which never identifies a bitstream.     *
+*                                                            *
+*************************************************************/
+
+int16_t ispVMAlreadyProgrammed()
+{
+	uint32_t uiExpected = 0;
+
+	if (ispVMAlgoUsercode(&uiExpected) < 0 || uiExpected == 0x00000000 || uiExpected == 0xFFFFFFFF)
+	{
+		return 0;
+	}
+	if (!(ispVMReadRegister(LSC_READ_STATUS, 32) & STATUS_DONE))
+	{
+		return 0;
+	}
+
+	return (ispVMReadRegister(ISC_USERCODE, 32) == uiExpected);
+}
+
+/*************************************************************
+*                                                            *
+* ISPVMENTRYPOINT                                            *
+*                                                            *
+* INPUT:                                                     *
+*     a_cForce: program the device even if it already runs   *
+*     the bitstream of the VME files.                        *
 *                                                            *
 * RETURN:                                                    *
 *     The return value will be a negative number if an error *
-*     occurred, or 0 if everything was successful            *
+*     occurred, B5_FPGA_ALREADY_PROGRAMMED if the device     *
+*     already runs the bitstream, or 0 if everything was     *
+*     successful                                             *
 *                                                            *
 * DESCRIPTION:                                               *
 *     This function opens the file pointers to the algo and  *
 *     data file.  It intializes global variables to their    *
-*     default values and enters the processor.               *
+*     default values and enters the processor, unless the    *
+*     USERCODE of the device matches the one of the          *
+*     algorithm: erase, program and verify are skipped.      *
 *                                                            *
 *************************************************************/
 
-int32_t B5_FPGA_Programming()
+int32_t ispVMEntryPoint(char a_cForce)
 {
 	char szFileVersion[ 9 ] = { 0 };
 	int16_t siRetCode     = 0;
@@ -1669,6 +2029,18 @@ int32_t B5_FPGA_Programming()
 
     EnableHardware();
 
+	/*************************************************************
+	*                                                            *
+	* Skip the programming if the bitstream is already loaded.   *
+	*                                                            *
+	*************************************************************/
+
+	if (!a_cForce && ispVMAlreadyProgrammed())
+	{
+		DisableHardware();
+		return B5_FPGA_ALREADY_PROGRAMMED;
+	}
+
 	/*************************************************************
 	*                                                            *
 	* Begin processing algorithm and data file.                  *
@@ -1697,6 +2069,35 @@ int32_t B5_FPGA_Programming()
 
 
 
+int32_t B5_FPGA_Programming()
+{
+	return ispVMEntryPoint(0);
+}
+
+int32_t B5_FPGA_ForceProgramming()
+{
+	return ispVMEntryPoint(1);
+}
+
+void B5_FPGA_SetPort(const B5_FPGA_PORT *port)
+{
+	g_pPort = (port != NULL) ? port : &g_GpioPort;
+}
+
+uint32_t B5_FPGA_ReadUsercode()
+{
+	uint32_t uiUsercode = 0;
+
+	EnableHardware();
+	uiUsercode = ispVMReadRegister(ISC_USERCODE, 32);
+	DisableHardware();
+
+	return uiUsercode;
+}
+
+
+
+
 
 
 
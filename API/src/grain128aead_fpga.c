@@ -10,6 +10,66 @@
 
 #define GRAIN128AEAD_FPGA_CORE 0x1
 
+// outcome of a step of a streaming transaction
+#define GRAIN128AEAD_FPGA_STEP_WAITING 0		// nothing to do until the core is done with a packet
+#define GRAIN128AEAD_FPGA_STEP_BUSY 1		// a packet has been handed over or collected
+#define GRAIN128AEAD_FPGA_STEP_DONE 2		// every packet has been collected (or the core timed out)
+
+// Clock timing the transactions, and their times per phase
+#ifdef DWT
+static GRAIN128AEAD_FPGA_CLOCK clock_ticks = GRAIN128AEAD_FPGA_dwt_clock;
+#else
+static GRAIN128AEAD_FPGA_CLOCK clock_ticks = NULL;
+#endif
+static GRAIN128AEAD_FPGA_HISTOGRAM telemetry[GRAIN128AEAD_FPGA_PHASES];
+static volatile uint8_t telemetry_busy = 0;	// the histograms are shared by every task using the driver
+
+static void GRAIN128AEAD_FPGA_spin(uint32_t cycles);
+static GRAIN128AEAD_FPGA_DELAY delay_cycles = GRAIN128AEAD_FPGA_spin;
+
+static const char *phase_names[GRAIN128AEAD_FPGA_PHASES] = { "format", "upload", "wait", "download", "total" };
+
+// Counters of the controller, summed under the lock of the histograms
+static uint8_t hw_counters_on = 0;
+static GRAIN128AEAD_FPGA_HW_COUNTERS hw_counters;
+static const char *hw_phase_names[GRAIN128AEAD_FPGA_HW_PHASES] = { "load", "init", "addkey", "ad", "msg", "mac", "idle" };
+
+// Times of the transaction in progress on a core
+typedef struct {
+	uint32_t start;							// beginning of the transaction
+	uint32_t lap;							// end of the last timed step
+	uint32_t ticks[GRAIN128AEAD_FPGA_PHASE_TOTAL];
+} GRAIN128AEAD_FPGA_TIMING;
+
+// Wait for the completion of a packet, in FPGA clock cycles: first until its predicted completion, then with
+// an exponential backoff between two reads of the status word, up to a timeout
+typedef struct {
+	uint32_t next;							// cycles of the next wait
+	uint32_t backoff;						// last backoff, 0 while waiting for the predicted completion
+	uint32_t waited;						// cycles elapsed since the packet was handed over
+	uint32_t limit;							// the packet times out after limit cycles
+} GRAIN128AEAD_FPGA_WAIT;
+
+// State of the job streamed through the banks of a core, or of the batch of jobs handed over to it
+typedef struct {
+	GRAIN128AEAD_FPGA_JOB *job;				// job streamed, first job of a batch
+	FPGA_IPM_CORE core;						// core of the transaction
+	uint8_t batch;							// jobs of the batch, one per bank; 0 when a single job is streamed
+	FPGA_IPM_DATA keyBlock[GRAIN128AEAD_FPGA_WORDS_KEY];
+	FPGA_IPM_DATA ivBlock[GRAIN128AEAD_FPGA_WORDS_IV];
+	FPGA_IPM_DATA ADblock[GRAIN128AEAD_FPGA_WORDS_AD_MAX];
+	uint64_t i_datain;						// next byte of the input
+	uint64_t left;							// bytes of the input still to be sent, MAC excluded
+	uint32_t packets;						// packets of the job
+	uint32_t sent;							// packets handed over to the core
+	uint32_t collected;						// packets whose results have been read out
+	uint8_t *res_hex;						// end of the output
+	uint32_t predicted;						// cycles of the descriptors of the batch handed over so far
+	FPGA_IPM_DATA pending[FPGA_IPM_NUM_BANKS];	// message bytes of the packet of each bank
+	GRAIN128AEAD_FPGA_TIMING timing;
+	GRAIN128AEAD_FPGA_WAIT wait;			// completion of the oldest packet not collected yet
+} GRAIN128AEAD_FPGA_CONTEXT;
+
 static FPGA_CLEAR_DATA_BUFFER(){
 	//CLEAR DATABUFFER
 	FPGA_IPM_DATA add = 0x0;
@@ -22,433 +82,399 @@ static FPGA_CLEAR_DATA_BUFFER(){
 }
 
 
-static FPGA_IPM_DATA GRAIN128AEAD_FPGA_8_to_16(uint8_t dataMSV, uint8_t dataLSV) {
-	return ( dataMSV << 8 ) | dataLSV ;
+static void GRAIN128AEAD_FPGA_time_start(GRAIN128AEAD_FPGA_TIMING *timing) {
+	memset(timing, 0, sizeof(*timing));
+	if( clock_ticks != NULL )
+		timing->start = timing->lap = clock_ticks();
 }
 
-static void GRAIN128AEAD_FPGA_init_pack(FPGA_IPM_DATA *key,
-										FPGA_IPM_DATA *iv,
-										FPGA_IPM_DATA *ad, uint8_t adLen,
-										FPGA_IPM_DATA *msg, uint8_t msgLen,
-										FPGA_IPM_DATA *res, uint8_t *i_res, FPGA_IPM_OPCODE opcode)
-{
+// Carry on timing a transaction left aside while the CPU was serving other cores
+static void GRAIN128AEAD_FPGA_time_resume(GRAIN128AEAD_FPGA_TIMING *timing) {
+	if( clock_ticks != NULL )
+		timing->lap = clock_ticks();
+}
 
-	FPGA_IPM_ADDRESS add = 1;
-	FPGA_IPM_DATA lengths;
-	uint8_t index_res = *i_res;
-	FPGA_IPM_DATA polling_semaphore;
-	int i;
-	FPGA_IPM_BOOLEAN ret;
-	FPGA_IPM_DATA data_bytes;
-	FPGA_IPM_DATA words_data_res[msgLen/2];
-	FPGA_IPM_DATA words_mac_res[4];
-	FPGA_IPM_DATA words_mac_inv[4] = {0};
-	FPGA_IPM_DATA words_ct_inv[msgLen/2];
-
-	//Inversion
-	if ( opcode == GRAIN128AEAD_FPGA_OPCODE_ENCR ){
-		data_bytes = msgLen;
-		for(size_t j=0; j<data_bytes/2 ; j++){
-			words_ct_inv[(data_bytes/2 - 1) - j] =  msg[j];
-		}
-		memcpy(msg, words_ct_inv, sizeof(FPGA_IPM_DATA)*data_bytes/2);
-		for(size_t j=0; j<data_bytes/2 ; j++){
-		}
-	}else{
-		//post encryption , init decryption
-		data_bytes = msgLen - 8;
+// Charge the time elapsed since the last step to a phase
+static void GRAIN128AEAD_FPGA_time_lap(GRAIN128AEAD_FPGA_TIMING *timing, GRAIN128AEAD_FPGA_PHASE phase) {
+	uint32_t now;
 
-		FPGA_IPM_DATA datain_mac[4];
-		FPGA_IPM_DATA datain_mac_inv[4] = {0};
-		FPGA_IPM_DATA datain_ct[data_bytes/2];
-		FPGA_IPM_DATA datain_ct_inv[data_bytes/2];
+	if( clock_ticks != NULL ) {
+		now = clock_ticks();
+		timing->ticks[phase] += now - timing->lap;
+		timing->lap = now;
+	}
+}
 
-		memcpy(datain_mac, msg + (data_bytes/2), sizeof(FPGA_IPM_DATA)*4);
+static void GRAIN128AEAD_FPGA_histogram_add(GRAIN128AEAD_FPGA_HISTOGRAM *hist, uint32_t ticks) {
+	uint8_t bin = 0;
+
+	for(uint32_t t = ticks; t != 0; t >>= 1)
+		bin++;
+	if( bin >= GRAIN128AEAD_FPGA_TELEMETRY_BINS )
+		bin = GRAIN128AEAD_FPGA_TELEMETRY_BINS - 1;
+
+	if( hist->count == 0 || ticks < hist->min )
+		hist->min = ticks;
+	if( ticks > hist->max )
+		hist->max = ticks;
+	hist->count++;
+	hist->sum += ticks;
+	hist->bins[bin]++;
+}
 
-		memcpy(datain_ct, msg, sizeof(FPGA_IPM_DATA)*(data_bytes/2));
+static void GRAIN128AEAD_FPGA_telemetry_lock(void) {
+	while( __atomic_test_and_set(&telemetry_busy, __ATOMIC_ACQUIRE) );
+}
 
-		//MAC inversion
-		for(size_t j=0; j<4 ; j++){
-			datain_mac_inv[(4-1) - j] =  datain_mac[j];
-		}
+static void GRAIN128AEAD_FPGA_telemetry_unlock(void) {
+	__atomic_clear(&telemetry_busy, __ATOMIC_RELEASE);
+}
 
-		//CT inversion
-		for(size_t j=0; j<data_bytes/2 ; j++){
-			datain_ct_inv[(data_bytes/2 - 1) - j] =  datain_ct[j];
-		}
+// The transaction is over: its times go into the histograms
+static void GRAIN128AEAD_FPGA_time_record(GRAIN128AEAD_FPGA_TIMING *timing) {
+	uint32_t total;
+	uint8_t phase;
+
+	if( clock_ticks == NULL )
+		return;
+	total = clock_ticks() - timing->start;
+	GRAIN128AEAD_FPGA_telemetry_lock();
+	for(phase = 0; phase < GRAIN128AEAD_FPGA_PHASE_TOTAL; phase++)
+		GRAIN128AEAD_FPGA_histogram_add(&telemetry[phase], timing->ticks[phase]);
+	GRAIN128AEAD_FPGA_histogram_add(&telemetry[GRAIN128AEAD_FPGA_PHASE_TOTAL], total);
+	GRAIN128AEAD_FPGA_telemetry_unlock();
+}
 
-		memcpy(msg, datain_ct_inv, sizeof(FPGA_IPM_DATA)*(data_bytes/2));
-		memcpy(msg + (data_bytes/2), datain_mac_inv, sizeof(FPGA_IPM_DATA)*4);
+static FPGA_IPM_DATA GRAIN128AEAD_FPGA_8_to_16(uint8_t dataMSV, uint8_t dataLSV) {
+	return ( dataMSV << 8 ) | dataLSV ;
+}
+
+// Convert the hex characters of a byte into the byte itself
+static uint8_t GRAIN128AEAD_FPGA_hex_to_8(const uint8_t *hex) {
+	return ( to_hex(hex[0]) & 0x0F ) << 4 | ( to_hex(hex[1]) & 0x0F );
+}
 
+// Append the first bytes of a block of words to the output, one nibble per byte. Returns the new end of the output.
+static uint8_t *GRAIN128AEAD_FPGA_16_to_hex(const FPGA_IPM_DATA *words, uint8_t bytes, uint8_t *res_hex) {
+	uint8_t data;
+
+	for(size_t i=0; i<bytes; i++) {
+		data = ( i % 2 == 0 ) ? ( words[i/2] & 0xFF00 ) >> 8 : words[i/2] & 0x00FF;
+		*res_hex++ = ( data & 0xF0 ) >> 4;
+		*res_hex++ = data & 0x0F;
 	}
+	return res_hex;
+}
 
-	// open a polling transaction
-	FPGA_IPM_open(GRAIN128AEAD_FPGA_CORE, opcode, 0, 0);
+// Number of message bytes of a packet, without the MAC it may carry
+static FPGA_IPM_DATA GRAIN128AEAD_FPGA_data_bytes(uint8_t msgLen, uint8_t mac_in)
+{
+	return mac_in ? msgLen - 2*GRAIN128AEAD_FPGA_WORDS_MAC : msgLen;
+}
+
+// The core has processed the packet, whatever the outcome of the tag verification
+static uint8_t GRAIN128AEAD_FPGA_completed(FPGA_IPM_DATA status)
+{
+	return ( status == GRAIN128AEAD_FPGA_STATUS_DONE ) || ( status == GRAIN128AEAD_FPGA_STATUS_FAIL );
+}
+
+// Write key, iv, lengths, ad and message of an INIT packet onto the data buffer
+static void GRAIN128AEAD_FPGA_write_init_pack(FPGA_IPM_CORE core,
+											  FPGA_IPM_DATA *key,
+											  FPGA_IPM_DATA *iv,
+											  FPGA_IPM_DATA *ad, uint8_t adLen,
+											  FPGA_IPM_DATA *msg, uint8_t msgLen,
+											  FPGA_IPM_DATA data_bytes)
+{
+	FPGA_IPM_ADDRESS add = 1;
+	FPGA_IPM_DATA lengths;
+	int i;
 
 	// write the key onto the data buffer
 	for(i=0; i < GRAIN128AEAD_FPGA_WORDS_KEY; i++) {
-		FPGA_IPM_write(GRAIN128AEAD_FPGA_CORE, add, &key[i]);
+		FPGA_IPM_write(core, add, &key[i]);
 		add++;
 	}
 
 	// write the iv (nonce) onto the data buffer
-	 for(i=0; i < GRAIN128AEAD_FPGA_WORDS_IV; i++) {
-		FPGA_IPM_write(GRAIN128AEAD_FPGA_CORE, add, &iv[i]);
+	for(i=0; i < GRAIN128AEAD_FPGA_WORDS_IV; i++) {
+		FPGA_IPM_write(core, add, &iv[i]);
 		add++;
-	 }
-
-	 //2 words are left unwritten
-	 add+=GRAIN128AEAD_FPGA_WORDS_UNUSED;
-
-	 // write length(subMsg) | length(ad) onto the data buffer
-	 lengths = ( data_bytes << 8) | adLen ;
-	 FPGA_IPM_write(GRAIN128AEAD_FPGA_CORE, add, &lengths);
-	 add++;
-
-	 // write ad (Associated Data) onto the buffer
-	 for(i=0; i < adLen/2; i++) {
-		 FPGA_IPM_write(GRAIN128AEAD_FPGA_CORE, add, &ad[i]);
- 	 	 add++;
-	 }
-	 // write msg onto the buffer
-	 add = GRAIN128AEAD_FPGA_ADDR_MSG_INIT_PACK;
-
-	 for(i=0; i < msgLen/2; i++) {
-		 ret = FPGA_IPM_write(GRAIN128AEAD_FPGA_CORE, add, &msg[i]);
-	 	 add++;
-	 }
-	 FPGA_IPM_DATA tmp = 0x0;
-	 FPGA_IPM_DATA unlock_polling = 0;
-
-	 // Printing data buffer
-
-	 tmp = 0x0;
-
-	 tmp = 0x0;
-	 FPGA_IPM_read(GRAIN128AEAD_FPGA_CORE, 0x3F, &tmp);
-
-	 if(tmp == 0xFFFF)
-		 unlock_polling = 1;
-	 else
-		 unlock_polling = 0;
-
-	// HAL_Delay(1000);
-	 // Polling
-
-	 if(unlock_polling == 0){
-		 polling_semaphore = 0x0000;
-		 FPGA_IPM_write(GRAIN128AEAD_FPGA_CORE, 0x3F, &polling_semaphore);
-
-		 while(polling_semaphore != (FPGA_IPM_DATA)0xFFFF) {
-			FPGA_IPM_read(GRAIN128AEAD_FPGA_CORE, 0x3F, &polling_semaphore);
-		 }
-	 }
-
+	}
 
-	 //Clean the polling word
-	 polling_semaphore = 0x0000;
-     FPGA_IPM_write(GRAIN128AEAD_FPGA_CORE, 0x3F, &polling_semaphore);
-	 // Printing data buffer
-	 tmp = 0x0;
+	//2 words are left unwritten
+	add+=GRAIN128AEAD_FPGA_WORDS_UNUSED;
 
-	//read out results from data buffer
-	add = GRAIN128AEAD_FPGA_ADDR_MSG_INIT_PACK;
+	// write length(subMsg) | length(ad) onto the data buffer
+	lengths = ( data_bytes << 8) | adLen ;
+	FPGA_IPM_write(core, add, &lengths);
+	add++;
 
-//////////////NEW INVERSION OUTPUT////////////////////////////////
-	for(i=0; i < data_bytes/2; i++) {
-		FPGA_IPM_read(GRAIN128AEAD_FPGA_CORE, add, &words_data_res[i]);
+	// write ad (Associated Data) onto the buffer, an odd last byte is in the upper half of a word
+	for(i=0; i < (adLen+1)/2; i++) {
+		FPGA_IPM_write(core, add, &ad[i]);
 		add++;
 	}
 
-	// Reading MAC only during enryption
-	if( opcode == GRAIN128AEAD_FPGA_OPCODE_ENCR ) {
-		add = GRAIN128AEAD_FPGA_ADDR_MAC;
-
-		for(i=0; i < GRAIN128AEAD_FPGA_WORDS_MAC; i++) {
-			FPGA_IPM_read(GRAIN128AEAD_FPGA_CORE, add, &words_mac_res[i]);
-			add++;
-		}
-		uint8_t ct_words, mac_words;
-		ct_words = data_bytes/2;
-		mac_words = 4;
-		//MAC invertion
-		for(size_t j=0; j<mac_words ; j++){
-			words_mac_inv[(mac_words-1) - j] =  words_mac_res[j];
-		}
-		//CT invertion
-		for(size_t j=0; j<ct_words ; j++){
-			words_ct_inv[(ct_words - 1) - j] =  words_data_res[j];
-		}
-		for(size_t i=0;i<ct_words;i++, index_res++)
-			res[index_res] = words_ct_inv[i];
-		for(size_t i=0;i<mac_words;i++, index_res++)
-			res[index_res] = words_mac_inv[i];
-
-	} else {
-
-		for(size_t j=0; j<data_bytes/2 ; j++){
-			words_ct_inv[((data_bytes/2) - 1) - j] =  words_data_res[j];
-		}
-		for(size_t i=0;i<data_bytes/2;i++, index_res++)
-			res[index_res] = words_ct_inv[i];
+	// write msg onto the buffer, an odd last byte is in the upper half of a word
+	add = GRAIN128AEAD_FPGA_ADDR_MSG_INIT_PACK;
+	for(i=0; i < (msgLen+1)/2; i++) {
+		FPGA_IPM_write(core, add, &msg[i]);
+		add++;
 	}
-
-
-	*i_res = index_res;
-	// close the polling transaction
-	FPGA_IPM_close(GRAIN128AEAD_FPGA_CORE);
-	//FPGA_CLEAR_DATA_BUFFER();
 }
 
-static void GRAIN128AEAD_FPGA_next_pack(FPGA_IPM_DATA *msg, uint8_t msgLen, FPGA_IPM_DATA *res, uint8_t *i_res, FPGA_IPM_OPCODE opcode)
+// Write length and message of a NEXT packet onto the data buffer
+static void GRAIN128AEAD_FPGA_write_next_pack(FPGA_IPM_CORE core, FPGA_IPM_DATA *msg, uint8_t msgLen, FPGA_IPM_DATA data_bytes)
 {
-
 	FPGA_IPM_ADDRESS add = 0x1;
 	FPGA_IPM_DATA submsglength;
-	FPGA_IPM_DATA polling_semaphore;
-	uint8_t index_res = *i_res;
 	int i;
-	FPGA_IPM_DATA data_bytes;
-	FPGA_IPM_DATA words_data_res[msgLen/2];
-	FPGA_IPM_DATA words_mac_res[4];
-	FPGA_IPM_DATA words_mac_inv[4] = {0};
-	FPGA_IPM_DATA words_ct_inv[msgLen/2];
-
-////////////////////NEW INVERSION////////////////////////////////////////////////////////////////////
-	//Inversion
-		if ( opcode == GRAIN128AEAD_FPGA_OPCODE_ENCR+1){
-			data_bytes = msgLen;
-			for(size_t j=0; j<data_bytes/2 ; j++){
-				words_ct_inv[(data_bytes/2 - 1) - j] =  msg[j];
-			}
-			memcpy(msg, words_ct_inv, sizeof(FPGA_IPM_DATA)*data_bytes/2);
-
-		}else{
-			//post encryption , init decryption
-			data_bytes = msgLen - 8;
-
-			FPGA_IPM_DATA datain_mac[4];
-			FPGA_IPM_DATA datain_mac_inv[4] = {0};
-			FPGA_IPM_DATA datain_ct[data_bytes/2];
-			FPGA_IPM_DATA datain_ct_inv[data_bytes/2];
-
-			memcpy(datain_mac, msg + (data_bytes/2), sizeof(FPGA_IPM_DATA)*4);
-
-			memcpy(datain_ct, msg, sizeof(FPGA_IPM_DATA)*(data_bytes/2));
-
-			//MAC inversion
-			for(size_t j=0; j<4 ; j++){
-				datain_mac_inv[(4-1) - j] =  datain_mac[j];
-			}
-
-			//CT inversion
-			for(size_t j=0; j<data_bytes/2 ; j++){
-				datain_ct_inv[(data_bytes/2 - 1) - j] =  datain_ct[j];
-			}
-
-			memcpy(msg, datain_ct_inv, sizeof(FPGA_IPM_DATA)*(data_bytes/2));
-			memcpy(msg + (data_bytes/2), datain_mac_inv, sizeof(FPGA_IPM_DATA)*4);
-		}
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-	// open a polling transaction
-	FPGA_IPM_open(GRAIN128AEAD_FPGA_CORE, opcode, 0, 0);
 
 	//write length
 	submsglength = (data_bytes << 8);
-	FPGA_IPM_write(GRAIN128AEAD_FPGA_CORE, add, &submsglength);
+	FPGA_IPM_write(core, add, &submsglength);
 	add++;
 
-	// write message onto the buffer
-	for(i=0; i < msgLen/2; i++) {
-		FPGA_IPM_write(GRAIN128AEAD_FPGA_CORE, add, &msg[i]);
+	// write message onto the buffer, an odd last byte is in the upper half of a word
+	for(i=0; i < (msgLen+1)/2; i++) {
+		FPGA_IPM_write(core, add, &msg[i]);
 		add++;
 	}
+}
 
-	FPGA_IPM_DATA tmp = 0x0;
-	FPGA_IPM_DATA unlock_polling = 0;
+// Open a transaction on coreID once the transactions of other tasks queued before it are over
+static GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_FPGA_open(FPGA_IPM_CORE coreID, FPGA_IPM_OPCODE opcode)
+{
+	if( FPGA_IPM_open_wait(coreID, opcode | GRAIN128AEAD_FPGA_OPCODE_NATURAL_ORDER, 0, 0) )
+		return GRAIN128AEAD_FPGA_RES_IPM_ERROR;
+	return GRAIN128AEAD_FPGA_RES_OK;
+}
 
-	 // Printing data buffer
-	 tmp = 0x0;
+// Cycles the controller takes for a packet of msg_bytes message bytes (and the initialisation if init)
+static uint32_t GRAIN128AEAD_FPGA_predict(uint8_t init, uint8_t adLen, FPGA_IPM_DATA msg_bytes)
+{
+	uint32_t cycles = GRAIN128AEAD_FPGA_CYCLES_PACKET + msg_bytes * GRAIN128AEAD_FPGA_CYCLES_PER_MSG_BYTE;
 
-	 FPGA_IPM_read(GRAIN128AEAD_FPGA_CORE, 0x3F, &tmp);
+	if( init )
+		cycles += GRAIN128AEAD_FPGA_CYCLES_INIT + adLen * GRAIN128AEAD_FPGA_CYCLES_PER_AD_BYTE;
+	return cycles;
+}
 
-	 if(tmp == 0xFFFF)
-		 unlock_polling = 1;
-	 else
-		 unlock_polling = 0;
+// A packet predicted to take predicted cycles has just been handed over
+static void GRAIN128AEAD_FPGA_wait_start(GRAIN128AEAD_FPGA_WAIT *wait, uint32_t predicted)
+{
+	wait->next = predicted - predicted / 8;
+	wait->backoff = 0;
+	wait->waited = 0;
+	wait->limit = GRAIN128AEAD_FPGA_TIMEOUT_FACTOR * predicted + GRAIN128AEAD_FPGA_TIMEOUT_MIN;
+}
 
-	 // Polling
+// The status word has been read without the packet being done: 1 if the packet timed out
+static uint8_t GRAIN128AEAD_FPGA_wait_poll(GRAIN128AEAD_FPGA_WAIT *wait)
+{
+	wait->waited += GRAIN128AEAD_FPGA_CYCLES_POLL;
+	return wait->waited > wait->limit;
+}
 
-	 if(unlock_polling == 0){
-		 polling_semaphore = 0x0000;
-		 FPGA_IPM_write(GRAIN128AEAD_FPGA_CORE, 0x3F, &polling_semaphore);
+// cycles have elapsed without accessing the bus: the next wait doubles, up to GRAIN128AEAD_FPGA_BACKOFF_MAX
+static void GRAIN128AEAD_FPGA_wait_credit(GRAIN128AEAD_FPGA_WAIT *wait, uint32_t cycles)
+{
+	wait->waited += cycles;
+	if( wait->backoff == 0 )
+		wait->backoff = GRAIN128AEAD_FPGA_BACKOFF_MIN;
+	else if( wait->backoff < GRAIN128AEAD_FPGA_BACKOFF_MAX )
+		wait->backoff *= 2;
+	wait->next = wait->backoff;
+}
+
+static void GRAIN128AEAD_FPGA_wait_delay(GRAIN128AEAD_FPGA_WAIT *wait)
+{
+	uint32_t cycles = wait->next;
+
+	delay_cycles(cycles);
+	GRAIN128AEAD_FPGA_wait_credit(wait, cycles);
+}
+
+// Wait for the end of a single-packet transaction predicted to take predicted cycles and clean the polling word.
+// Returns the final status, GRAIN128AEAD_FPGA_STATUS_IDLE if the core timed out.
+static FPGA_IPM_DATA GRAIN128AEAD_FPGA_wait_pack(FPGA_IPM_CORE core, uint32_t predicted)
+{
+	FPGA_IPM_DATA polling_semaphore = 0x0000;
+	FPGA_IPM_DATA status;
+	GRAIN128AEAD_FPGA_WAIT wait;
+
+	FPGA_IPM_read(core, GRAIN128AEAD_FPGA_ADDR_STATUS, &polling_semaphore);
+
+	// Polling
+	if(!GRAIN128AEAD_FPGA_completed(polling_semaphore)){
+		polling_semaphore = GRAIN128AEAD_FPGA_STATUS_IDLE;
+		FPGA_IPM_write(core, GRAIN128AEAD_FPGA_ADDR_STATUS, &polling_semaphore);
+
+		GRAIN128AEAD_FPGA_wait_start(&wait, predicted);
+		while(!GRAIN128AEAD_FPGA_completed(polling_semaphore)) {
+			GRAIN128AEAD_FPGA_wait_delay(&wait);
+			FPGA_IPM_read(core, GRAIN128AEAD_FPGA_ADDR_STATUS, &polling_semaphore);
+			if( !GRAIN128AEAD_FPGA_completed(polling_semaphore) && GRAIN128AEAD_FPGA_wait_poll(&wait) ) {
+				polling_semaphore = GRAIN128AEAD_FPGA_STATUS_IDLE;
+				break;
+			}
+		}
+	}
+	status = polling_semaphore;
 
-		 while(polling_semaphore != (FPGA_IPM_DATA)0xFFFF) {
-			FPGA_IPM_read(GRAIN128AEAD_FPGA_CORE, 0x3F, &polling_semaphore);
-		 }
-	 }
+	//Clean the polling word
+	polling_semaphore = GRAIN128AEAD_FPGA_STATUS_IDLE;
+	FPGA_IPM_write(core, GRAIN128AEAD_FPGA_ADDR_STATUS, &polling_semaphore);
 
+	return status;
+}
 
-	 //Clean the polling word
-	 polling_semaphore = 0x0000;
-	 FPGA_IPM_write(GRAIN128AEAD_FPGA_CORE, 0x3F, &polling_semaphore);
-	 // Printing data buffer
-	 tmp = 0x0;
-	//read out results from data buffer
-	add = GRAIN128AEAD_FPGA_ADDR_MSG_NEXT_PACK;
+// Hand the packet written in the selected bank over to the core (streaming mode).
+// The last packet of the message makes the core close the tag.
+static void GRAIN128AEAD_FPGA_ring_bank(FPGA_IPM_CORE core, uint8_t last)
+{
+	FPGA_IPM_DATA status = last ? GRAIN128AEAD_FPGA_STATUS_LAST : GRAIN128AEAD_FPGA_STATUS_READY;
+	FPGA_IPM_write(core, GRAIN128AEAD_FPGA_ADDR_STATUS, &status);
+}
 
+// Read out the results of a packet from the data buffer and append them to the output, followed by the MAC if mac_out.
+// An odd last byte is in the upper half of its word.
+static uint8_t *GRAIN128AEAD_FPGA_read_pack(FPGA_IPM_CORE core, FPGA_IPM_ADDRESS add, FPGA_IPM_DATA data_bytes,
+											uint8_t *res_hex, uint8_t mac_out)
+{
+	int i;
+	FPGA_IPM_DATA words_res[GRAIN128AEAD_FPGA_AVAILABLE_WORDS_DECR];
 
-//////////NEW INVERSION ///////////////////////////////////////////
-	for(i=0; i < data_bytes/2; i++) {
-		FPGA_IPM_read(GRAIN128AEAD_FPGA_CORE, add, &words_data_res[i]);
+	for(i=0; i < (data_bytes+1)/2; i++) {
+		FPGA_IPM_read(core, add, &words_res[i]);
 		add++;
 	}
+	res_hex = GRAIN128AEAD_FPGA_16_to_hex(words_res, data_bytes, res_hex);
 
-	// Reading MAC only during enryption
-	if( opcode == GRAIN128AEAD_FPGA_OPCODE_ENCR+1) {
+	// Reading MAC only at the end of an encryption
+	if( mac_out ) {
 		add = GRAIN128AEAD_FPGA_ADDR_MAC;
 
 		for(i=0; i < GRAIN128AEAD_FPGA_WORDS_MAC; i++) {
-			FPGA_IPM_read(GRAIN128AEAD_FPGA_CORE, add, &words_mac_res[i]);
+			FPGA_IPM_read(core, add, &words_res[i]);
 			add++;
 		}
-		uint8_t ct_words, mac_words;
-		ct_words = data_bytes/2;
-		mac_words = 4;
-		//MAC invertion
-		for(size_t j=0; j<mac_words ; j++){
-			words_mac_inv[(mac_words-1) - j] =  words_mac_res[j];
-		}
-		//CT invertion
-		for(size_t j=0; j<ct_words ; j++){
-			words_ct_inv[(ct_words - 1) - j] =  words_data_res[j];
-		}
-		for(size_t i=0;i<ct_words;i++, index_res++)
-			res[index_res] = words_ct_inv[i];
-
-		for(size_t i=0;i<mac_words;i++, index_res++)
-			res[index_res] = words_mac_inv[i];
+		res_hex = GRAIN128AEAD_FPGA_16_to_hex(words_res, 2*GRAIN128AEAD_FPGA_WORDS_MAC, res_hex);
+	}
 
-	} else {
+	return res_hex;
+}
 
-		for(size_t j=0; j<data_bytes/2 ; j++){
-			words_ct_inv[((data_bytes/2) - 1) - j] =  words_data_res[j];
-	}
-		for(size_t i=0;i<data_bytes/2;i++, index_res++)
-			res[index_res] = words_ct_inv[i];
-	}
+// Output of a decryption whose tag did not match: the controller has cleared the packet in the data buffer,
+// so it is not read back and the output gets as many zero bytes. Returns the new end of the output.
+static uint8_t *GRAIN128AEAD_FPGA_zero_pack(uint64_t out_bytes, uint8_t *res_hex)
+{
+	memset(res_hex, 0, 2*out_bytes);
+	return res_hex + 2*out_bytes;
+}
 
-	*i_res = index_res;
+// Add the counters of the controller, left in the selected bank by the transaction just completed
+static void GRAIN128AEAD_FPGA_read_hw_counters(FPGA_IPM_CORE core)
+{
+	FPGA_IPM_DATA words[2*GRAIN128AEAD_FPGA_HW_PHASES];
+	int i;
 
-	// close the polling transaction
-	FPGA_IPM_close(GRAIN128AEAD_FPGA_CORE);
+	if( !hw_counters_on )
+		return;
+	for(i=0; i < 2*GRAIN128AEAD_FPGA_HW_PHASES; i++)
+		FPGA_IPM_read(core, GRAIN128AEAD_FPGA_ADDR_PERF + i, &words[i]);
 
+	GRAIN128AEAD_FPGA_telemetry_lock();
+	hw_counters.transactions++;
+	for(i=0; i < GRAIN128AEAD_FPGA_HW_PHASES; i++)
+		hw_counters.cycles[i] += words[2*i] | ( (uint32_t)words[2*i+1] << 16 );
+	GRAIN128AEAD_FPGA_telemetry_unlock();
 }
 
-static GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_CHIPHER(  uint8_t *key,
-															uint8_t *IV,
-															uint8_t *AD, uint8_t ADlen,
-															const uint8_t *dataIN, uint64_t datainLen,
-															uint8_t *res_hex, FPGA_IPM_OPCODE opcode) {
-
-	int i, i_datain;
-	uint8_t i_res = 0;
+static uint8_t *GRAIN128AEAD_FPGA_init_pack(FPGA_IPM_CORE core,
+											FPGA_IPM_DATA *key,
+											FPGA_IPM_DATA *iv,
+											FPGA_IPM_DATA *ad, uint8_t adLen,
+											FPGA_IPM_DATA *msg, uint8_t msgLen,
+											uint8_t *res_hex, FPGA_IPM_OPCODE opcode,
+											GRAIN128AEAD_FPGA_RETURN_CODE *res, GRAIN128AEAD_FPGA_TIMING *timing)
+{
+	uint8_t encrypt = ( opcode == GRAIN128AEAD_FPGA_OPCODE_ENCR );
+	FPGA_IPM_DATA data_bytes, status;
+	uint32_t predicted, overlap;
 
-	uint8_t mac_count = (datainLen/24);
+	data_bytes = GRAIN128AEAD_FPGA_data_bytes(msgLen, !encrypt);
+	// the core initialises from the IV on, while the lengths, the AD and the message are still being written
+	predicted = GRAIN128AEAD_FPGA_predict(1, adLen, data_bytes);
+	overlap = ( 1 + (adLen+1)/2 + (msgLen+1)/2 ) * GRAIN128AEAD_FPGA_CYCLES_WRITE;
+	predicted -= ( overlap < GRAIN128AEAD_FPGA_CYCLES_INIT ) ? overlap : GRAIN128AEAD_FPGA_CYCLES_INIT;
 
-	if( opcode == GRAIN128AEAD_FPGA_OPCODE_ENCR){
-		(datainLen%24)!=0 ? mac_count++ : mac_count;
-	}else{
-		mac_count = 0;
+	// open a polling transaction
+	if( (*res = GRAIN128AEAD_FPGA_open(core, opcode)) != GRAIN128AEAD_FPGA_RES_OK )
+		return res_hex;
+
+	GRAIN128AEAD_FPGA_write_init_pack(core, key, iv, ad, adLen, msg, msgLen, data_bytes);
+	GRAIN128AEAD_FPGA_time_lap(timing, GRAIN128AEAD_FPGA_PHASE_UPLOAD);
+	status = GRAIN128AEAD_FPGA_wait_pack(core, predicted);
+	if( status == GRAIN128AEAD_FPGA_STATUS_FAIL )
+		*res = GRAIN128AEAD_FPGA_RES_AUTH_FAILED;
+	GRAIN128AEAD_FPGA_time_lap(timing, GRAIN128AEAD_FPGA_PHASE_WAIT);
+	if( status == GRAIN128AEAD_FPGA_STATUS_IDLE ) {
+		*res = GRAIN128AEAD_FPGA_RES_TIMEOUT;
+		// no plaintext of an unverified decryption
+		if( !encrypt )
+			res_hex = GRAIN128AEAD_FPGA_zero_pack(data_bytes, res_hex);
+	} else {
+		if( status == GRAIN128AEAD_FPGA_STATUS_FAIL )
+			res_hex = GRAIN128AEAD_FPGA_zero_pack(data_bytes, res_hex);
+		else
+			res_hex = GRAIN128AEAD_FPGA_read_pack(core, GRAIN128AEAD_FPGA_ADDR_MSG_INIT_PACK, data_bytes, res_hex, encrypt);
+		GRAIN128AEAD_FPGA_read_hw_counters(core);
 	}
 
-	uint8_t key_vhdl[32], *pos_key_vhdl = key_vhdl;
-	uint8_t iv_vhdl[24], *pos_iv_vhdl = iv_vhdl;
-	uint8_t datain_vhdl[datainLen*2], *pos_datain_vhdl = datain_vhdl;
-	uint8_t ad_vhdl[ADlen*2], *pos_ad_vhdl = ad_vhdl;
-	uint8_t res_vhdl[(datainLen + mac_count*8)*2];
-	uint8_t dataOUT[(datainLen + mac_count*8)*2];
+	// close the polling transaction
+	FPGA_IPM_close(core);
+	GRAIN128AEAD_FPGA_time_lap(timing, GRAIN128AEAD_FPGA_PHASE_DOWNLOAD);
 
+	return res_hex;
+}
 
+// Convert key, IV and AD in blocks of words ready to be written inside the data buffer
+static void GRAIN128AEAD_FPGA_format(uint8_t *key, uint8_t *IV, uint8_t *AD, uint8_t ADlen,
+									 FPGA_IPM_DATA *keyBlock, FPGA_IPM_DATA *ivBlock, FPGA_IPM_DATA *ADblock)
+{
+	int i;
 
 	FPGA_IPM_DATA key_to_fpga[16];
 	FPGA_IPM_DATA iv_to_fpga[12];
-	FPGA_IPM_DATA datain_to_fpga[datainLen];
-	FPGA_IPM_DATA ad_to_fpga[ADlen];
-
-
-	FPGA_IPM_DATA datainBlock[GRAIN128AEAD_FPGA_WORDS_NEXT_PACK], ADblock[GRAIN128AEAD_FPGA_WORDS_AD_MAX], keyBlock[GRAIN128AEAD_FPGA_WORDS_KEY], ivBlock[GRAIN128AEAD_FPGA_WORDS_IV];
-	uint64_t left, resLen;
-	uint8_t available_dataLen;
-	uint8_t words_init_pack, words_next_pack;
-	uint8_t subdatainLen;
-
-	resLen = datainLen/2 + 1 + mac_count*GRAIN128AEAD_FPGA_WORDS_MAC; // the result length will take into account the MAC and an extra word to manage the odd datainLen size
-	FPGA_IPM_DATA res[resLen];
-
-	if( (key == NULL) || (IV == NULL) || (AD == NULL) )
-		return GRAIN128AEAD_FPGA_RES_INVALID_ARGUMENT;
-	else if( (ADlen > 2*GRAIN128AEAD_FPGA_WORDS_AD_MAX) || (sizeof(key) > 2*GRAIN128AEAD_FPGA_WORDS_KEY) || (sizeof(IV) > 2*GRAIN128AEAD_FPGA_WORDS_IV) )
-		return GRAIN128AEAD_FPGA_RES_INVALID_ARGUMENT;
+	FPGA_IPM_DATA ad_to_fpga[2*GRAIN128AEAD_FPGA_WORDS_AD_MAX];
 
 	// *** Data format - do not modify - BEGIN
 	// **************************************************************
 	// **************************************************************
 	// **************************************************************
 
-	//Swapping data 2 bytes at a time
-	for(size_t i=0;i<32; i+=4){
-		for(size_t j=0; j<4; j++){
-			key_vhdl[31 - (3-j + i)] =  key[i+j];
-		}
-	}
-
-	for(size_t i=0;i<24; i+=4){
-		for(size_t j=0; j<4; j++){
-			iv_vhdl[23 - (3-j + i)] =  IV[i+j];
-		}
-	}
-
-	for(size_t i=0;i<ADlen*2; i+=4){
-		for(size_t j=0; j<4; j++){
-			ad_vhdl[(ADlen*2)-1 - (3-j + i)] =  AD[i+j];
-
-		}
-	}
+	// The controller is driven in natural word order: key, IV and AD are sent as they are
 
 	//2-to-1 byte
 	print_uart("\r\nKEY: ");
 	for (size_t i = 0; i < 16 ; i++) {
-		key_to_fpga[i] = ( to_hex(pos_key_vhdl[2*i]) & 0x0F ) << 4 | ( to_hex(pos_key_vhdl[2*i+1]) & 0x0F );
+		key_to_fpga[i] = GRAIN128AEAD_FPGA_hex_to_8(&key[2*i]);
 		print_uart_8(key_to_fpga[i]);
 	}
 	print_uart("\r\nIV: ");
 	for (size_t i = 0; i < 12 ; i++) {
-		iv_to_fpga[i] = ( to_hex(pos_iv_vhdl[2*i]) & 0x0F ) << 4 | ( to_hex(pos_iv_vhdl[2*i+1]) & 0x0F );
+		iv_to_fpga[i] = GRAIN128AEAD_FPGA_hex_to_8(&IV[2*i]);
 		print_uart_8(iv_to_fpga[i]);
 	}
 
 	print_uart("\r\nAD: ");
 	for (size_t i = 0; i < ADlen ; i++) {
-		ad_to_fpga[i] = ( to_hex(pos_ad_vhdl[2*i]) & 0x0F ) << 4 | ( to_hex(pos_ad_vhdl[2*i+1]) & 0x0F );
+		ad_to_fpga[i] = GRAIN128AEAD_FPGA_hex_to_8(&AD[2*i]);
 		print_uart_8(ad_to_fpga[i]);
 	}
 
-	if( opcode == GRAIN128AEAD_FPGA_OPCODE_ENCR){
-		print_uart("\r\nMSG: ");
-	}else{
-		print_uart("\r\nCT+MAC: ");
-	}
-
-	for (size_t i = 0; i < datainLen ; i++) {
-		datain_to_fpga[i] = ( to_hex(dataIN[2*i]) & 0x0F ) << 4 | ( to_hex(dataIN[2*i+1]) & 0x0F );
-		print_uart_8(datain_to_fpga[i]);
-	}
-
-
-
 	// transform KEY in a block of words ready to be written inside the data buffer
 	for(i = 0; i < GRAIN128AEAD_FPGA_WORDS_KEY ; i++ ){
 		keyBlock[i] = GRAIN128AEAD_FPGA_8_to_16((key_to_fpga[ 2*i ]), (key_to_fpga[ 2*i + 1 ]));
@@ -468,109 +494,453 @@ static GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_CHIPHER(  uint8_t *key,
 		i++;
 	}
 
-	// save number of words created inside ADblock
-	//subADlen = i;
-
 	// **************************************************************
 	// **************************************************************
 	// **************************************************************
 	// *** Data format - do not modify - END
+}
 
-	if (opcode == GRAIN128AEAD_FPGA_OPCODE_ENCR ) {
-		available_dataLen = 2*GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR;
-		words_init_pack = GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR;
-		words_next_pack = GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR;
-	} else {
-		available_dataLen = 2*GRAIN128AEAD_FPGA_AVAILABLE_WORDS_DECR;
-		words_init_pack = GRAIN128AEAD_FPGA_AVAILABLE_WORDS_DECR;
-		words_next_pack = GRAIN128AEAD_FPGA_AVAILABLE_WORDS_DECR;
+// Convert the next chunk bytes of the input (starting at byte *i_datain) in a block of words, followed by
+// the MAC if mac_in, which starts on the word after the last byte of the chunk. Returns the bytes of the block.
+static uint8_t GRAIN128AEAD_FPGA_load_chunk(const uint8_t *dataIN, uint64_t *i_datain, uint8_t chunk, uint8_t mac_in,
+											FPGA_IPM_DATA *datainBlock)
+{
+	int i;
+	uint8_t subdatainLen = chunk;
+	uint8_t data_msb, data_lsb;
+
+	for(i = 0; i < chunk/2 ; i++ ) {
+		data_msb = GRAIN128AEAD_FPGA_hex_to_8(&dataIN[2*(*i_datain)]);
+		data_lsb = GRAIN128AEAD_FPGA_hex_to_8(&dataIN[2*(*i_datain) + 2]);
+		print_uart_8(data_msb);
+		print_uart_8(data_lsb);
+		datainBlock[i] = GRAIN128AEAD_FPGA_8_to_16(data_msb, data_lsb);
+		*i_datain += 2;
 	}
 
-	if (datainLen == 0) {
-		// In there is no msg, send just the data required for the init packet, waiting only for the MAC as result
-		//( 1 tells to the function to save further 4 word starting from address when it is supposed to be the message)
-		GRAIN128AEAD_FPGA_init_pack(keyBlock, ivBlock, ADblock, ADlen, NULL, datainLen, res, &i_res, opcode);
-	} else {
-
-		i_datain = 0;
-		left = datainLen;
-		// This loop is in charge of create packet as soon as the remain bytes is enough to create complete packet of 58 words as message/ciphertext
-		while ( left > available_dataLen ){
-			// Create packet init, just at the beginning
-			if ( i_datain == 0 ) {
-				// INIT PACKET
-				// transform dataIN in a block of words ready to be written inside the data buffer
-				for(i = 0; i < words_init_pack ; i++ ){
-					datainBlock[i] = GRAIN128AEAD_FPGA_8_to_16(datain_to_fpga[i_datain], datain_to_fpga[i_datain + 1] );
-					i_datain += 2;
-				}
-				// save number of words created
-				subdatainLen = 2*words_init_pack;
-				// decrement the remaining datainLen of max msg words size
-				left = left - 2*words_init_pack;
-				// write INIT PACKET inside data buffer without getting MAC data
-				GRAIN128AEAD_FPGA_init_pack(keyBlock, ivBlock, ADblock, ADlen, datainBlock, subdatainLen, res, &i_res, opcode);
-			} else {
-				// NEXT PACKET
-				// transform dataIN in a block of words ready to be written inside the data buffer
-				for(i = 0; i < words_next_pack ; i++ ){
-					datainBlock[i] = GRAIN128AEAD_FPGA_8_to_16(datain_to_fpga[i_datain], datain_to_fpga[i_datain + 1] );
-					i_datain += 2;
-				}
-				// save number of words created
-				subdatainLen = 2*words_next_pack;
-				// decrement the remaining datainLen of max msg words size
-				left = left - 2*words_next_pack;
-				// write NEXT PACKET inside data buffer without getting MAC data
-				GRAIN128AEAD_FPGA_next_pack(datainBlock, subdatainLen, res, &i_res, opcode + 1);
+	if(chunk % 2 == 1) {
+		data_msb = GRAIN128AEAD_FPGA_hex_to_8(&dataIN[2*(*i_datain)]);
+		print_uart_8(data_msb);
+		datainBlock[i] = GRAIN128AEAD_FPGA_8_to_16(data_msb, 0);
+		*i_datain += 1;
+		i++;
+	}
 
-			}
-		}
-		// Packet that does not fit a full init/next packet
-		for(i = 0; i < left/2 ; i++ ) {
-			datainBlock[i] = GRAIN128AEAD_FPGA_8_to_16(datain_to_fpga[i_datain], datain_to_fpga[i_datain + 1] );
-			i_datain += 2;
+	// the MAC to be verified starts on the word after the ciphertext
+	if( mac_in ) {
+		for( ; i < (chunk+1)/2 + GRAIN128AEAD_FPGA_WORDS_MAC; i++ ) {
+			data_msb = GRAIN128AEAD_FPGA_hex_to_8(&dataIN[2*(*i_datain)]);
+			data_lsb = GRAIN128AEAD_FPGA_hex_to_8(&dataIN[2*(*i_datain) + 2]);
+			print_uart_8(data_msb);
+			print_uart_8(data_lsb);
+			datainBlock[i] = GRAIN128AEAD_FPGA_8_to_16(data_msb, data_lsb);
+			*i_datain += 2;
 		}
+		subdatainLen += 2*GRAIN128AEAD_FPGA_WORDS_MAC;
+	}
 
-		subdatainLen = left;
+	return subdatainLen;
+}
 
-		if(left % 2 == 1) {
-			datainBlock[i] = GRAIN128AEAD_FPGA_8_to_16(datain_to_fpga[i_datain], 0);
-			subdatainLen++;
+// Check the arguments of a job
+static GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_FPGA_check(const GRAIN128AEAD_FPGA_JOB *job)
+{
+	if( (job->key == NULL) || (job->IV == NULL) || (job->AD == NULL) || (job->res_hex == NULL) || (job->dataIN == NULL && job->datainLen > 0) )
+		return GRAIN128AEAD_FPGA_RES_INVALID_ARGUMENT;
+	else if( job->ADlen > 2*GRAIN128AEAD_FPGA_WORDS_AD_MAX )
+		return GRAIN128AEAD_FPGA_RES_INVALID_ARGUMENT;
+	else if( !job->encrypt && (job->datainLen < 2*GRAIN128AEAD_FPGA_WORDS_MAC) )
+		return GRAIN128AEAD_FPGA_RES_INVALID_ARGUMENT;
+	return GRAIN128AEAD_FPGA_RES_OK;
+}
+
+// Bytes of the message (encryption) or of the ciphertext (decryption) of a valid job, MAC excluded
+static uint64_t GRAIN128AEAD_FPGA_msg_bytes(const GRAIN128AEAD_FPGA_JOB *job)
+{
+	return job->encrypt ? job->datainLen : job->datainLen - 2*GRAIN128AEAD_FPGA_WORDS_MAC;
+}
+
+// Open a streaming transaction of a job on coreID: the packets are exchanged through the ring of banks
+// of the data buffer, so that the CPU fills/empties the banks while the core is working on another one.
+// The core carries the accumulator from a packet to the next: the whole message gets a single tag.
+// Returns the error of the job if the transaction cannot be opened.
+static GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_FPGA_stream_open(GRAIN128AEAD_FPGA_CONTEXT *ctx, GRAIN128AEAD_FPGA_JOB *job, FPGA_IPM_CORE coreID)
+{
+	ctx->job = job;
+	ctx->core = coreID;
+	ctx->batch = 0;
+	GRAIN128AEAD_FPGA_time_start(&ctx->timing);
+	GRAIN128AEAD_FPGA_format(job->key, job->IV, job->AD, job->ADlen, ctx->keyBlock, ctx->ivBlock, ctx->ADblock);
+	GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_FORMAT);
+
+	ctx->i_datain = 0;
+	ctx->left = GRAIN128AEAD_FPGA_msg_bytes(job);
+	ctx->packets = (ctx->left + 2*GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR - 1) / (2*GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR);
+	// a message (or ciphertext) without bytes still needs a packet for the MAC
+	if( ctx->packets == 0 )
+		ctx->packets = 1;
+	ctx->sent = 0;
+	ctx->collected = 0;
+	ctx->res_hex = job->res_hex;
+
+	job->res = GRAIN128AEAD_FPGA_open(coreID, job->encrypt ? GRAIN128AEAD_FPGA_OPCODE_ENCR_STREAM : GRAIN128AEAD_FPGA_OPCODE_DECR_STREAM);
+	GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_UPLOAD);
+	return job->res;
+}
+
+// The oldest packet not collected yet is the one the core is working on: wait for its predicted completion
+static void GRAIN128AEAD_FPGA_stream_wait_next(GRAIN128AEAD_FPGA_CONTEXT *ctx)
+{
+	if( ctx->collected < ctx->sent )
+		GRAIN128AEAD_FPGA_wait_start(&ctx->wait, GRAIN128AEAD_FPGA_predict(ctx->collected == 0, ctx->job->ADlen,
+																		   ctx->pending[ctx->collected % FPGA_IPM_NUM_BANKS]));
+}
+
+// Leave every used bank idle and the CPU on the first one, as expected by single-packet transactions, then close
+// the transaction
+static void GRAIN128AEAD_FPGA_stream_close(GRAIN128AEAD_FPGA_CONTEXT *ctx)
+{
+	FPGA_IPM_DATA status = GRAIN128AEAD_FPGA_STATUS_IDLE;
+	uint8_t bank;
+
+	// the counters are in the bank of the last packet
+	if( ctx->job->res != GRAIN128AEAD_FPGA_RES_TIMEOUT ) {
+		FPGA_IPM_select_bank(ctx->core, ( ctx->packets - 1 ) % FPGA_IPM_NUM_BANKS);
+		GRAIN128AEAD_FPGA_read_hw_counters(ctx->core);
+	}
+
+	for(bank = ( ctx->packets < FPGA_IPM_NUM_BANKS ) ? ctx->packets : FPGA_IPM_NUM_BANKS; bank > 0; bank--) {
+		FPGA_IPM_select_bank(ctx->core, bank - 1);
+		FPGA_IPM_write(ctx->core, GRAIN128AEAD_FPGA_ADDR_STATUS, &status);
+	}
+
+	FPGA_IPM_close(ctx->core);
+	GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_DOWNLOAD);
+	GRAIN128AEAD_FPGA_time_record(&ctx->timing);
+}
+
+// Make the job of the current core progress without waiting for it: collect the results of the oldest packet
+// if the core is done with it, then hand the next packet over through bank sent % FPGA_IPM_NUM_BANKS if that
+// bank is free. Only the last packet carries the MAC (decryption) or gets it back (encryption).
+// When every packet has been collected, or the core has timed out, the banks are left idle and the transaction
+// is closed. Returns GRAIN128AEAD_FPGA_STEP_DONE in that case, GRAIN128AEAD_FPGA_STEP_WAITING if the step has
+// only read the status word, GRAIN128AEAD_FPGA_STEP_BUSY otherwise.
+static uint8_t GRAIN128AEAD_FPGA_stream_step(GRAIN128AEAD_FPGA_CONTEXT *ctx)
+{
+	GRAIN128AEAD_FPGA_JOB *job = ctx->job;
+	FPGA_IPM_DATA datainBlock[GRAIN128AEAD_FPGA_AVAILABLE_WORDS_DECR];
+	FPGA_IPM_DATA status;
+	uint8_t bank, last, chunk, subdatainLen;
+	uint8_t step = GRAIN128AEAD_FPGA_STEP_WAITING;
+
+	GRAIN128AEAD_FPGA_time_resume(&ctx->timing);
+
+	if( ctx->collected < ctx->sent ) {
+		bank = ctx->collected % FPGA_IPM_NUM_BANKS;
+		last = ( ctx->collected == ctx->packets-1 );
+		FPGA_IPM_select_bank(ctx->core, bank);
+		FPGA_IPM_read(ctx->core, GRAIN128AEAD_FPGA_ADDR_STATUS, &status);
+		GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_WAIT);
+		if( GRAIN128AEAD_FPGA_completed(status) ) {
+			if( status == GRAIN128AEAD_FPGA_STATUS_FAIL ) {
+				// only the last packet gets the verdict: the plaintext of the packets collected before it is
+				// cleared as well
+				job->res = GRAIN128AEAD_FPGA_RES_AUTH_FAILED;
+				ctx->res_hex = GRAIN128AEAD_FPGA_zero_pack(ctx->pending[bank], ctx->res_hex);
+				memset(job->res_hex, 0, ctx->res_hex - job->res_hex);
+			} else
+				ctx->res_hex = GRAIN128AEAD_FPGA_read_pack(ctx->core, ctx->collected == 0 ? GRAIN128AEAD_FPGA_ADDR_MSG_INIT_PACK : GRAIN128AEAD_FPGA_ADDR_MSG_NEXT_PACK,
+														   ctx->pending[bank], ctx->res_hex, job->encrypt && last);
+			ctx->collected++;
+			GRAIN128AEAD_FPGA_stream_wait_next(ctx);
+			step = GRAIN128AEAD_FPGA_STEP_BUSY;
+			GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_DOWNLOAD);
+		} else if( GRAIN128AEAD_FPGA_wait_poll(&ctx->wait) ) {
+			// the core is stuck: give the job up, the packets already collected are kept unless they are the
+			// plaintext of a decryption whose tag will never be checked
+			job->res = GRAIN128AEAD_FPGA_RES_TIMEOUT;
+			if( !job->encrypt )
+				memset(job->res_hex, 0, ctx->res_hex - job->res_hex);
+			ctx->packets = ctx->sent;
+			ctx->collected = ctx->sent;
 		}
+	}
 
-		if ( left == datainLen )
-			GRAIN128AEAD_FPGA_init_pack(keyBlock, ivBlock, ADblock, ADlen, datainBlock, subdatainLen, res, &i_res, opcode);
+	if( ctx->sent < ctx->packets && ctx->sent - ctx->collected < FPGA_IPM_NUM_BANKS ) {
+		bank = ctx->sent % FPGA_IPM_NUM_BANKS;
+		last = ( ctx->sent == ctx->packets-1 );
+		chunk = ( ctx->left > 2*GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR ) ? 2*GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR : ctx->left;
+		subdatainLen = GRAIN128AEAD_FPGA_load_chunk(job->dataIN, &ctx->i_datain, chunk, !job->encrypt && last, datainBlock);
+		ctx->left -= chunk;
+		GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_FORMAT);
+
+		FPGA_IPM_select_bank(ctx->core, bank);
+		ctx->pending[bank] = GRAIN128AEAD_FPGA_data_bytes(subdatainLen, !job->encrypt && last);
+		if( ctx->sent == 0 )
+			GRAIN128AEAD_FPGA_write_init_pack(ctx->core, ctx->keyBlock, ctx->ivBlock, ctx->ADblock, job->ADlen, datainBlock, subdatainLen, ctx->pending[bank]);
 		else
-			GRAIN128AEAD_FPGA_next_pack(datainBlock, subdatainLen, res, &i_res, opcode + 1);
+			GRAIN128AEAD_FPGA_write_next_pack(ctx->core, datainBlock, subdatainLen, ctx->pending[bank]);
+		GRAIN128AEAD_FPGA_ring_bank(ctx->core, last);
+		ctx->sent++;
+		if( ctx->collected == ctx->sent-1 )
+			GRAIN128AEAD_FPGA_stream_wait_next(ctx);
+		step = GRAIN128AEAD_FPGA_STEP_BUSY;
+		GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_UPLOAD);
+	}
+
+	if( ctx->collected < ctx->packets )
+		return step;
+
+	GRAIN128AEAD_FPGA_stream_close(ctx);
+	return GRAIN128AEAD_FPGA_STEP_DONE;
+}
+
+// Open a batch transaction of count jobs of a single packet each, in the same direction, on coreID: every job
+// is a descriptor (key, IV, lengths, AD, message) written in its own bank, and the core processes the banks
+// in order, resetting the accumulator for each one. A single completion covers the whole batch.
+// Returns the error of every job if the transaction cannot be opened.
+static GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_FPGA_batch_open(GRAIN128AEAD_FPGA_CONTEXT *ctx, GRAIN128AEAD_FPGA_JOB *jobs,
+																  uint8_t count, FPGA_IPM_CORE coreID)
+{
+	GRAIN128AEAD_FPGA_RETURN_CODE res;
+	uint8_t i;
+
+	ctx->job = jobs;
+	ctx->core = coreID;
+	ctx->batch = count;
+	GRAIN128AEAD_FPGA_time_start(&ctx->timing);
+	ctx->packets = count;
+	ctx->sent = 0;
+	ctx->collected = 0;
+	ctx->predicted = 0;
+
+	res = GRAIN128AEAD_FPGA_open(coreID, jobs->encrypt ? GRAIN128AEAD_FPGA_OPCODE_ENCR_BATCH : GRAIN128AEAD_FPGA_OPCODE_DECR_BATCH);
+	for(i = 0; i < count && res != GRAIN128AEAD_FPGA_RES_OK; i++)
+		jobs[i].res = res;
+	GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_UPLOAD);
+	return res;
+}
 
+// Make the batch of the current core progress: hand the next descriptor over through bank sent, then, once
+// every descriptor is in its bank, poll the status of the last one only: it completes the whole batch.
+// Each job gets its own verdict from the status of its bank. Same return values as
+// GRAIN128AEAD_FPGA_stream_step.
+static uint8_t GRAIN128AEAD_FPGA_batch_step(GRAIN128AEAD_FPGA_CONTEXT *ctx)
+{
+	GRAIN128AEAD_FPGA_JOB *job;
+	FPGA_IPM_DATA datainBlock[GRAIN128AEAD_FPGA_AVAILABLE_WORDS_DECR];
+	FPGA_IPM_DATA status, verdict;
+	uint64_t i_datain = 0;
+	uint8_t bank, chunk, subdatainLen;
+
+	GRAIN128AEAD_FPGA_time_resume(&ctx->timing);
+
+	if( ctx->sent < ctx->packets ) {
+		bank = ctx->sent;
+		job = &ctx->job[bank];
+		chunk = GRAIN128AEAD_FPGA_msg_bytes(job);
+		GRAIN128AEAD_FPGA_format(job->key, job->IV, job->AD, job->ADlen, ctx->keyBlock, ctx->ivBlock, ctx->ADblock);
+		subdatainLen = GRAIN128AEAD_FPGA_load_chunk(job->dataIN, &i_datain, chunk, !job->encrypt, datainBlock);
+		GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_FORMAT);
+
+		FPGA_IPM_select_bank(ctx->core, bank);
+		ctx->pending[bank] = GRAIN128AEAD_FPGA_data_bytes(subdatainLen, !job->encrypt);
+		GRAIN128AEAD_FPGA_write_init_pack(ctx->core, ctx->keyBlock, ctx->ivBlock, ctx->ADblock, job->ADlen, datainBlock, subdatainLen, ctx->pending[bank]);
+		GRAIN128AEAD_FPGA_ring_bank(ctx->core, bank == ctx->packets-1);
+		ctx->sent++;
+		ctx->predicted += GRAIN128AEAD_FPGA_predict(1, job->ADlen, ctx->pending[bank]);
+		if( ctx->sent == ctx->packets )
+			GRAIN128AEAD_FPGA_wait_start(&ctx->wait, ctx->predicted);
+		GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_UPLOAD);
+		return GRAIN128AEAD_FPGA_STEP_BUSY;
 	}
 
-	// *** Data format - do not modify - BEGIN
-	// **************************************************************
-	// **************************************************************
-	// **************************************************************
+	FPGA_IPM_select_bank(ctx->core, ctx->packets-1);
+	FPGA_IPM_read(ctx->core, GRAIN128AEAD_FPGA_ADDR_STATUS, &status);
+	GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_WAIT);
+	if( GRAIN128AEAD_FPGA_completed(status) ) {
+		GRAIN128AEAD_FPGA_read_hw_counters(ctx->core);
+		// from the last bank down to the first one, each left idle once read out
+		for(bank = ctx->packets; bank > 0; bank--) {
+			job = &ctx->job[bank-1];
+			if( bank != ctx->packets )
+				FPGA_IPM_select_bank(ctx->core, bank-1);
+			// an encryption always ends with GRAIN128AEAD_FPGA_STATUS_DONE
+			verdict = status;
+			if( !job->encrypt && bank != ctx->packets )
+				FPGA_IPM_read(ctx->core, GRAIN128AEAD_FPGA_ADDR_STATUS, &verdict);
+			if( verdict == GRAIN128AEAD_FPGA_STATUS_FAIL ) {
+				job->res = GRAIN128AEAD_FPGA_RES_AUTH_FAILED;
+				GRAIN128AEAD_FPGA_zero_pack(GRAIN128AEAD_FPGA_msg_bytes(job), job->res_hex);
+			} else
+				GRAIN128AEAD_FPGA_read_pack(ctx->core, GRAIN128AEAD_FPGA_ADDR_MSG_INIT_PACK, ctx->pending[bank-1], job->res_hex, job->encrypt);
+			verdict = GRAIN128AEAD_FPGA_STATUS_IDLE;
+			FPGA_IPM_write(ctx->core, GRAIN128AEAD_FPGA_ADDR_STATUS, &verdict);
+		}
+		FPGA_IPM_close(ctx->core);
+		GRAIN128AEAD_FPGA_time_lap(&ctx->timing, GRAIN128AEAD_FPGA_PHASE_DOWNLOAD);
+		GRAIN128AEAD_FPGA_time_record(&ctx->timing);
+	} else if( GRAIN128AEAD_FPGA_wait_poll(&ctx->wait) ) {
+		// the core is stuck: the whole batch is given up, with no output for the decryptions
+		for(bank = 0; bank < ctx->packets; bank++) {
+			ctx->job[bank].res = GRAIN128AEAD_FPGA_RES_TIMEOUT;
+			if( !ctx->job[bank].encrypt )
+				GRAIN128AEAD_FPGA_zero_pack(GRAIN128AEAD_FPGA_msg_bytes(&ctx->job[bank]), ctx->job[bank].res_hex);
+		}
+		GRAIN128AEAD_FPGA_stream_close(ctx);
+	} else {
+		return GRAIN128AEAD_FPGA_STEP_WAITING;
+	}
+
+	ctx->collected = ctx->packets;
+	return GRAIN128AEAD_FPGA_STEP_DONE;
+}
+
+// Jobs from jobs[next] that make a batch: the run of valid single-packet jobs in the direction of jobs[next] (a
+// valid job), shared out between the cores, one job per bank at most
+static uint8_t GRAIN128AEAD_FPGA_batch_size(GRAIN128AEAD_FPGA_JOB *jobs, uint32_t next, uint32_t n)
+{
+	uint32_t run = 0;
+
+	while( next + run < n && run < GRAIN128AEAD_FPGA_NUM_CORES * FPGA_IPM_NUM_BANKS && jobs[next+run].encrypt == jobs[next].encrypt ) {
+		jobs[next+run].res = GRAIN128AEAD_FPGA_check(&jobs[next+run]);
+		if( jobs[next+run].res != GRAIN128AEAD_FPGA_RES_OK || GRAIN128AEAD_FPGA_msg_bytes(&jobs[next+run]) > 2*GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR )
+			break;
+		run++;
+	}
+
+	run = ( run + GRAIN128AEAD_FPGA_NUM_CORES - 1 ) / GRAIN128AEAD_FPGA_NUM_CORES;
+	return ( run < FPGA_IPM_NUM_BANKS ) ? run : FPGA_IPM_NUM_BANKS;
+}
+
+// The message is streamed through a single packet-sized block: memory usage does not depend on datainLen
+static GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_CHIPHER(  uint8_t *key,
+															uint8_t *IV,
+															uint8_t *AD, uint8_t ADlen,
+															const uint8_t *dataIN, uint64_t datainLen,
+															uint8_t *res_hex, FPGA_IPM_OPCODE opcode) {
+
+	GRAIN128AEAD_FPGA_JOB job = { key, IV, AD, ADlen, dataIN, datainLen, res_hex, ( opcode == GRAIN128AEAD_FPGA_OPCODE_ENCR ), GRAIN128AEAD_FPGA_RES_OK };
+	GRAIN128AEAD_FPGA_CONTEXT ctx;
+	FPGA_IPM_DATA datainBlock[GRAIN128AEAD_FPGA_AVAILABLE_WORDS_DECR];
+	uint64_t i_datain = 0;
+	uint8_t subdatainLen, chunk, step;
+
+	if( (job.res = GRAIN128AEAD_FPGA_check(&job)) != GRAIN128AEAD_FPGA_RES_OK )
+		return job.res;
+
+	// Several packets are streamed through the banks of the data buffer within a single transaction
+	if( GRAIN128AEAD_FPGA_msg_bytes(&job) > 2*GRAIN128AEAD_FPGA_AVAILABLE_WORDS_ENCR ) {
+		if( GRAIN128AEAD_FPGA_stream_open(&ctx, &job, GRAIN128AEAD_FPGA_CORE) != GRAIN128AEAD_FPGA_RES_OK )
+			return job.res;
+		// as GRAIN128AEAD_FPGA_run_jobs_idle, the CPU window is left to the other tasks between the steps
+		while( (step = GRAIN128AEAD_FPGA_stream_step(&ctx)) != GRAIN128AEAD_FPGA_STEP_DONE ) {
+			FPGA_IPM_suspend(ctx.core);
+			if( step == GRAIN128AEAD_FPGA_STEP_WAITING )
+				GRAIN128AEAD_FPGA_wait_delay(&ctx.wait);
+			FPGA_IPM_resume_wait(ctx.core);
+		}
+		return job.res;
+	}
+
+	GRAIN128AEAD_FPGA_time_start(&ctx.timing);
+	GRAIN128AEAD_FPGA_format(key, IV, AD, ADlen, ctx.keyBlock, ctx.ivBlock, ctx.ADblock);
 
-	for(i=0; i < i_res; i++) {
-		dataOUT[2*i] = ( res[i] & 0xFF00 ) >> 8;
-		dataOUT[2*i+1] = res[i] & 0x00FF ;
+	if( job.encrypt ){
+		print_uart("\r\nMSG: ");
+	}else{
+		print_uart("\r\nCT+MAC: ");
 	}
 
-	//Byte to hex
-	for (size_t i = 0; i < (datainLen + mac_count*8) ; i++) {
-		res_hex[2*i] = (( dataOUT[i] & 0xF0 ) >> 4);
-		res_hex[2*i+1] = ( dataOUT[i] & 0x0F );
+	if (datainLen == 0) {
+		// In there is no msg, send just the data required for the init packet, waiting only for the MAC as result
+		GRAIN128AEAD_FPGA_time_lap(&ctx.timing, GRAIN128AEAD_FPGA_PHASE_FORMAT);
+		GRAIN128AEAD_FPGA_init_pack(GRAIN128AEAD_FPGA_CORE, ctx.keyBlock, ctx.ivBlock, ctx.ADblock, ADlen, NULL, datainLen, res_hex, opcode, &job.res, &ctx.timing);
+	} else {
+		chunk = job.encrypt ? datainLen : datainLen - 2*GRAIN128AEAD_FPGA_WORDS_MAC;
+		subdatainLen = GRAIN128AEAD_FPGA_load_chunk(dataIN, &i_datain, chunk, !job.encrypt, datainBlock);
+		GRAIN128AEAD_FPGA_time_lap(&ctx.timing, GRAIN128AEAD_FPGA_PHASE_FORMAT);
+		GRAIN128AEAD_FPGA_init_pack(GRAIN128AEAD_FPGA_CORE, ctx.keyBlock, ctx.ivBlock, ctx.ADblock, ADlen, datainBlock, subdatainLen, res_hex, opcode, &job.res, &ctx.timing);
 	}
+	GRAIN128AEAD_FPGA_time_record(&ctx.timing);
 
+	return job.res;
 
+}
 
-	// **************************************************************
-	// **************************************************************
-	// **************************************************************
-	// *** Data format - do not modify - END
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_FPGA_run_jobs(GRAIN128AEAD_FPGA_JOB *jobs, uint32_t n) {
+	return GRAIN128AEAD_FPGA_run_jobs_idle(jobs, n, NULL, NULL);
+}
 
-	return GRAIN128AEAD_FPGA_RES_OK;
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_FPGA_run_jobs_idle(GRAIN128AEAD_FPGA_JOB *jobs, uint32_t n,
+															  GRAIN128AEAD_FPGA_IDLE idle, void *arg) {
+
+	GRAIN128AEAD_FPGA_CONTEXT ctx[GRAIN128AEAD_FPGA_NUM_CORES];
+	GRAIN128AEAD_FPGA_RETURN_CODE res = GRAIN128AEAD_FPGA_RES_OK, opened;
+	uint32_t next = 0, running = 0, cycles;
+	uint8_t c, i, count, step, waiting;
+
+	for(c = 0; c < GRAIN128AEAD_FPGA_NUM_CORES; c++)
+		ctx[c].job = NULL;
+
+	while( next < n || running > 0 ) {
+		waiting = 1;
+		for(c = 0; c < GRAIN128AEAD_FPGA_NUM_CORES; c++) {
+			if( ctx[c].job == NULL ) {
+				// a free core takes the next valid job
+				while( next < n && (jobs[next].res = GRAIN128AEAD_FPGA_check(&jobs[next])) != GRAIN128AEAD_FPGA_RES_OK )
+					res = jobs[next++].res;
+				if( next == n )
+					continue;
+				// small jobs share a transaction: one completion instead of a handshake per job
+				count = GRAIN128AEAD_FPGA_batch_size(jobs, next, n);
+				if( count > 1 )
+					opened = GRAIN128AEAD_FPGA_batch_open(&ctx[c], &jobs[next], count, c + 1);
+				else
+					opened = GRAIN128AEAD_FPGA_stream_open(&ctx[c], &jobs[next], c + 1);
+				next += ( count > 1 ) ? count : 1;
+				if( opened != GRAIN128AEAD_FPGA_RES_OK ) {
+					res = opened;
+					ctx[c].job = NULL;
+					continue;
+				}
+				running++;
+			} else {
+				FPGA_IPM_resume_wait(ctx[c].core);
+			}
 
+			// the core works on its own banks while the CPU serves the other ones
+			step = ctx[c].batch ? GRAIN128AEAD_FPGA_batch_step(&ctx[c]) : GRAIN128AEAD_FPGA_stream_step(&ctx[c]);
+			if( step != GRAIN128AEAD_FPGA_STEP_WAITING )
+				waiting = 0;
+			if( step == GRAIN128AEAD_FPGA_STEP_DONE ) {
+				for(i = 0; i < ( ctx[c].batch ? ctx[c].batch : 1 ); i++)
+					if( ctx[c].job[i].res != GRAIN128AEAD_FPGA_RES_OK )
+						res = ctx[c].job[i].res;
+				ctx[c].job = NULL;
+				running--;
+			} else {
+				FPGA_IPM_suspend(ctx[c].core);
+			}
+		}
+
+		// every core left running is suspended: the CPU is free until the next round
+		if( idle != NULL && running > 0 ) {
+			idle(arg);
+		} else if( waiting && running > 0 ) {
+			// no core is done with its packet: wait for the earliest one, without accessing the bus
+			cycles = UINT32_MAX;
+			for(c = 0; c < GRAIN128AEAD_FPGA_NUM_CORES; c++)
+				if( ctx[c].job != NULL && ctx[c].wait.next < cycles )
+					cycles = ctx[c].wait.next;
+			delay_cycles(cycles);
+			for(c = 0; c < GRAIN128AEAD_FPGA_NUM_CORES; c++)
+				if( ctx[c].job != NULL )
+					GRAIN128AEAD_FPGA_wait_credit(&ctx[c].wait, cycles);
+		}
+	}
+
+	return res;
 }
 
 GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_FPGA_encrypt (
@@ -594,3 +964,134 @@ GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_FPGA_decrypt (
 	return GRAIN128AEAD_CHIPHER(key, IV, AD, ADlen, ciphertext, cipherLen, msg, GRAIN128AEAD_FPGA_OPCODE_DECR);
 
 }
+
+void GRAIN128AEAD_FPGA_set_clock(GRAIN128AEAD_FPGA_CLOCK clock) {
+	clock_ticks = clock;
+}
+
+void GRAIN128AEAD_FPGA_set_delay(GRAIN128AEAD_FPGA_DELAY delay) {
+	delay_cycles = ( delay != NULL ) ? delay : GRAIN128AEAD_FPGA_spin;
+}
+
+// Default delay: the FPGA clock is a fixed fraction of HCLK
+static void GRAIN128AEAD_FPGA_spin(uint32_t cycles) {
+#ifdef DWT
+	uint32_t start = GRAIN128AEAD_FPGA_dwt_clock();
+	while( GRAIN128AEAD_FPGA_dwt_clock() - start < cycles * GRAIN128AEAD_FPGA_HCLK_PER_CYCLE );
+#else
+	for(volatile uint32_t i = 0; i < cycles; i++);
+#endif
+}
+
+#ifdef DWT
+uint32_t GRAIN128AEAD_FPGA_dwt_clock(void) {
+	if( !(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) ) {
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	}
+	return DWT->CYCCNT;
+}
+#endif
+
+void GRAIN128AEAD_FPGA_get_telemetry(GRAIN128AEAD_FPGA_PHASE phase, GRAIN128AEAD_FPGA_HISTOGRAM *hist) {
+	GRAIN128AEAD_FPGA_telemetry_lock();
+	*hist = telemetry[phase];
+	GRAIN128AEAD_FPGA_telemetry_unlock();
+}
+
+void GRAIN128AEAD_FPGA_reset_telemetry(void) {
+	GRAIN128AEAD_FPGA_telemetry_lock();
+	memset(telemetry, 0, sizeof(telemetry));
+	GRAIN128AEAD_FPGA_telemetry_unlock();
+}
+
+void GRAIN128AEAD_FPGA_enable_hw_counters(uint8_t on) {
+	hw_counters_on = on;
+}
+
+void GRAIN128AEAD_FPGA_get_hw_counters(GRAIN128AEAD_FPGA_HW_COUNTERS *counters) {
+	GRAIN128AEAD_FPGA_telemetry_lock();
+	*counters = hw_counters;
+	GRAIN128AEAD_FPGA_telemetry_unlock();
+}
+
+void GRAIN128AEAD_FPGA_reset_hw_counters(void) {
+	GRAIN128AEAD_FPGA_telemetry_lock();
+	memset(&hw_counters, 0, sizeof(hw_counters));
+	GRAIN128AEAD_FPGA_telemetry_unlock();
+}
+
+// Append the decimal digits of num to str. Returns the new end of str.
+static uint8_t *GRAIN128AEAD_FPGA_append_u64(uint8_t *str, uint64_t num) {
+	uint8_t digits[20];
+	uint8_t n = 0;
+
+	do {
+		digits[n++] = '0' + num % 10;
+		num /= 10;
+	} while( num != 0 );
+	while( n > 0 )
+		*str++ = digits[--n];
+	return str;
+}
+
+static uint8_t *GRAIN128AEAD_FPGA_append_str(uint8_t *str, const char *s) {
+	while( *s )
+		*str++ = *s++;
+	return str;
+}
+
+void GRAIN128AEAD_FPGA_print_telemetry(void) {
+	uint8_t line[96], *end;
+	uint8_t phase, bin;
+	GRAIN128AEAD_FPGA_HISTOGRAM hist;
+	GRAIN128AEAD_FPGA_HW_COUNTERS counters;
+
+	print_uart("\r\nphase: count mean min max (ticks)\r\n");
+	for(phase = 0; phase < GRAIN128AEAD_FPGA_PHASES; phase++) {
+		GRAIN128AEAD_FPGA_get_telemetry(phase, &hist);
+		end = GRAIN128AEAD_FPGA_append_str(line, phase_names[phase]);
+		end = GRAIN128AEAD_FPGA_append_str(end, ": ");
+		end = GRAIN128AEAD_FPGA_append_u64(end, hist.count);
+		end = GRAIN128AEAD_FPGA_append_str(end, " ");
+		end = GRAIN128AEAD_FPGA_append_u64(end, hist.count ? hist.sum / hist.count : 0);
+		end = GRAIN128AEAD_FPGA_append_str(end, " ");
+		end = GRAIN128AEAD_FPGA_append_u64(end, hist.min);
+		end = GRAIN128AEAD_FPGA_append_str(end, " ");
+		end = GRAIN128AEAD_FPGA_append_u64(end, hist.max);
+		end = GRAIN128AEAD_FPGA_append_str(end, "\r\n");
+		*end = '\0';
+		print_uart(line);
+
+		// one line per non-empty bin: upper bound of the bin and count
+		for(bin = 0; bin < GRAIN128AEAD_FPGA_TELEMETRY_BINS; bin++) {
+			if( hist.bins[bin] == 0 )
+				continue;
+			end = GRAIN128AEAD_FPGA_append_str(line, "  < ");
+			end = GRAIN128AEAD_FPGA_append_u64(end, (uint64_t)1 << bin);
+			end = GRAIN128AEAD_FPGA_append_str(end, ": ");
+			end = GRAIN128AEAD_FPGA_append_u64(end, hist.bins[bin]);
+			end = GRAIN128AEAD_FPGA_append_str(end, "\r\n");
+			*end = '\0';
+			print_uart(line);
+		}
+	}
+
+	GRAIN128AEAD_FPGA_get_hw_counters(&counters);
+	if( counters.transactions == 0 )
+		return;
+	print_uart("\r\ncontroller: cycles per phase over ");
+	end = GRAIN128AEAD_FPGA_append_u64(line, counters.transactions);
+	end = GRAIN128AEAD_FPGA_append_str(end, " transactions\r\n");
+	*end = '\0';
+	print_uart(line);
+	for(phase = 0; phase < GRAIN128AEAD_FPGA_HW_PHASES; phase++) {
+		end = GRAIN128AEAD_FPGA_append_str(line, hw_phase_names[phase]);
+		end = GRAIN128AEAD_FPGA_append_str(end, ": ");
+		end = GRAIN128AEAD_FPGA_append_u64(end, counters.cycles[phase]);
+		end = GRAIN128AEAD_FPGA_append_str(end, "\r\n");
+		*end = '\0';
+		print_uart(line);
+	}
+}
@@ -0,0 +1,269 @@
+/**
+  ******************************************************************************
+  * File Name          : grain128aead_hybrid.c
+  * Description        : Dispatcher between the GRAIN128AEAD IP cores of the
+                         FPGA and the software implementation of the cipher
+  ******************************************************************************
+  */
+
+#include <grain128aead_hybrid.h>
+#include "grain128aead.h"
+
+#define GRAIN128AEAD_HYBRID_CHUNK 24		// bytes converted at a time by the software path
+#define GRAIN128AEAD_HYBRID_MAC 8
+
+static GRAIN128AEAD_HYBRID_CLOCK clock_ticks;
+static GRAIN128AEAD_HYBRID_COST cost[GRAIN128AEAD_HYBRID_PATHS];
+
+// Software jobs of a batch, run while the cores are busy
+typedef struct {
+	GRAIN128AEAD_FPGA_JOB *jobs[GRAIN128AEAD_HYBRID_MAX_BATCH];
+	uint32_t n;
+	uint32_t next;
+	GRAIN128AEAD_FPGA_RETURN_CODE res;
+} GRAIN128AEAD_HYBRID_SW_JOBS;
+
+static uint8_t GRAIN128AEAD_HYBRID_hex_to_8(const uint8_t *hex) {
+	return ( to_hex(hex[0]) & 0x0F ) << 4 | ( to_hex(hex[1]) & 0x0F );
+}
+
+static void GRAIN128AEAD_HYBRID_hex_to_bytes(const uint8_t *hex, uint64_t bytes, uint8_t *out) {
+	for(uint64_t i = 0; i < bytes; i++)
+		out[i] = GRAIN128AEAD_HYBRID_hex_to_8(&hex[2*i]);
+}
+
+// Same output format as the FPGA driver: one nibble per byte. Returns the new end of the output.
+static uint8_t *GRAIN128AEAD_HYBRID_bytes_to_nibbles(const uint8_t *bytes, uint64_t n, uint8_t *res_hex) {
+	for(uint64_t i = 0; i < n; i++) {
+		*res_hex++ = ( bytes[i] & 0xF0 ) >> 4;
+		*res_hex++ = bytes[i] & 0x0F;
+	}
+	return res_hex;
+}
+
+static uint64_t GRAIN128AEAD_HYBRID_msg_bytes(const GRAIN128AEAD_FPGA_JOB *job) {
+	if( job->encrypt )
+		return job->datainLen;
+	return ( job->datainLen > GRAIN128AEAD_HYBRID_MAC ) ? job->datainLen - GRAIN128AEAD_HYBRID_MAC : 0;
+}
+
+// The software path gives the same results as the FPGA path only on the requests the driver accepts
+static uint8_t GRAIN128AEAD_HYBRID_sw_allowed(const GRAIN128AEAD_FPGA_JOB *job) {
+	if( job->key == NULL || job->IV == NULL || job->AD == NULL || job->res_hex == NULL || (job->dataIN == NULL && job->datainLen > 0) )
+		return 0;
+	if( job->ADlen > 2*GRAIN128AEAD_FPGA_WORDS_AD_MAX )
+		return 0;
+	if( !job->encrypt && job->datainLen < GRAIN128AEAD_HYBRID_MAC )
+		return 0;
+	return 1;
+}
+
+static uint64_t GRAIN128AEAD_HYBRID_predict(GRAIN128AEAD_HYBRID_PATH path, uint64_t bytes) {
+	return cost[path].fixed + ( ( cost[path].per_byte * bytes ) >> 8 );
+}
+
+// Move the model of the path towards a new measurement: short messages correct the fixed cost, the longer
+// ones the cost per byte
+static void GRAIN128AEAD_HYBRID_update(GRAIN128AEAD_HYBRID_PATH path, uint64_t bytes, uint32_t ticks) {
+	GRAIN128AEAD_HYBRID_COST *c = &cost[path];
+	int64_t sample;
+
+	c->requests++;
+	if( bytes < GRAIN128AEAD_HYBRID_CALIB_BYTES ) {
+		sample = (int64_t)ticks - (int64_t)( ( c->per_byte * bytes ) >> 8 );
+		if( sample < 0 )
+			sample = 0;
+		c->fixed += ( sample - (int64_t)c->fixed ) / ( 1 << GRAIN128AEAD_HYBRID_EWMA_SHIFT );
+	} else {
+		sample = ( ( (int64_t)ticks - (int64_t)c->fixed ) * 256 ) / (int64_t)bytes;
+		if( sample < 0 )
+			sample = 0;
+		c->per_byte += ( sample - (int64_t)c->per_byte ) / ( 1 << GRAIN128AEAD_HYBRID_EWMA_SHIFT );
+	}
+}
+
+// Software path: the message is converted and ciphered GRAIN128AEAD_HYBRID_CHUNK bytes at a time
+static GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_HYBRID_sw(const GRAIN128AEAD_FPGA_JOB *job) {
+	uint8_t key[16], iv[12], ad[2*GRAIN128AEAD_FPGA_WORDS_AD_MAX];
+	uint8_t in[GRAIN128AEAD_HYBRID_CHUNK], out[GRAIN128AEAD_HYBRID_CHUNK];
+	uint8_t tag[GRAIN128AEAD_HYBRID_MAC], mac[GRAIN128AEAD_HYBRID_MAC];
+	uint64_t left = GRAIN128AEAD_HYBRID_msg_bytes(job);
+	const uint8_t *hex = job->dataIN;
+	uint8_t *res_hex = job->res_hex;
+	uint8_t chunk;
+
+	GRAIN128AEAD_HYBRID_hex_to_bytes(job->key, sizeof(key), key);
+	GRAIN128AEAD_HYBRID_hex_to_bytes(job->IV, sizeof(iv), iv);
+	GRAIN128AEAD_HYBRID_hex_to_bytes(job->AD, job->ADlen, ad);
+
+	grain_start(key, iv, ad, job->ADlen);
+
+	while( left > 0 ) {
+		chunk = ( left > GRAIN128AEAD_HYBRID_CHUNK ) ? GRAIN128AEAD_HYBRID_CHUNK : left;
+		GRAIN128AEAD_HYBRID_hex_to_bytes(hex, chunk, in);
+		if( job->encrypt )
+			grain_encrypt_bytes(in, out, chunk);
+		else
+			grain_decrypt_bytes(in, out, chunk);
+		res_hex = GRAIN128AEAD_HYBRID_bytes_to_nibbles(out, chunk, res_hex);
+		hex += 2*chunk;
+		left -= chunk;
+	}
+
+	grain_tag(tag);
+
+	if( job->encrypt ) {
+		GRAIN128AEAD_HYBRID_bytes_to_nibbles(tag, sizeof(tag), res_hex);
+		return GRAIN128AEAD_FPGA_RES_OK;
+	}
+
+	GRAIN128AEAD_HYBRID_hex_to_bytes(hex, sizeof(mac), mac);
+	if( memcmp(tag, mac, sizeof(mac)) != 0 ) {
+		// no plaintext out of a message that is not authentic, as from the FPGA
+		memset(job->res_hex, 0, res_hex - job->res_hex);
+		return GRAIN128AEAD_FPGA_RES_AUTH_FAILED;
+	}
+	return GRAIN128AEAD_FPGA_RES_OK;
+}
+
+// Run a request on a path and measure it
+static GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_HYBRID_run(GRAIN128AEAD_FPGA_JOB *job, GRAIN128AEAD_HYBRID_PATH path) {
+	uint32_t start = clock_ticks();
+
+	if( path == GRAIN128AEAD_HYBRID_SW )
+		job->res = GRAIN128AEAD_HYBRID_sw(job);
+	else if( job->encrypt )
+		job->res = GRAIN128AEAD_FPGA_encrypt(job->key, job->IV, job->AD, job->ADlen, job->dataIN, job->datainLen, job->res_hex);
+	else
+		job->res = GRAIN128AEAD_FPGA_decrypt(job->key, job->IV, job->AD, job->ADlen, job->dataIN, job->datainLen, job->res_hex);
+
+	if( job->res != GRAIN128AEAD_FPGA_RES_INVALID_ARGUMENT )
+		GRAIN128AEAD_HYBRID_update(path, GRAIN128AEAD_HYBRID_msg_bytes(job), clock_ticks() - start);
+
+	return job->res;
+}
+
+// Idle hook of the FPGA batch: one software job per round over the cores
+static void GRAIN128AEAD_HYBRID_sw_step(void *arg) {
+	GRAIN128AEAD_HYBRID_SW_JOBS *sw = arg;
+
+	if( sw->next < sw->n && GRAIN128AEAD_HYBRID_run(sw->jobs[sw->next++], GRAIN128AEAD_HYBRID_SW) != GRAIN128AEAD_FPGA_RES_OK )
+		sw->res = sw->jobs[sw->next-1]->res;
+}
+
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_HYBRID_init(GRAIN128AEAD_HYBRID_CLOCK clock) {
+	static uint8_t zeros[2*GRAIN128AEAD_HYBRID_CALIB_BYTES];
+	static uint8_t res_hex[2*(GRAIN128AEAD_HYBRID_CALIB_BYTES + GRAIN128AEAD_HYBRID_MAC)];
+	GRAIN128AEAD_FPGA_JOB job = { zeros, zeros, zeros, 0, zeros, 0, res_hex, 1, GRAIN128AEAD_FPGA_RES_OK };
+	uint32_t t0, t1;
+	uint8_t path;
+
+	clock_ticks = clock;
+	memset(zeros, '0', sizeof(zeros));
+
+	for(path = 0; path < GRAIN128AEAD_HYBRID_PATHS; path++) {
+		job.datainLen = 0;
+		t0 = clock_ticks();
+		if( GRAIN128AEAD_HYBRID_run(&job, path) != GRAIN128AEAD_FPGA_RES_OK )
+			return job.res;
+		t0 = clock_ticks() - t0;
+
+		job.datainLen = GRAIN128AEAD_HYBRID_CALIB_BYTES;
+		t1 = clock_ticks();
+		if( GRAIN128AEAD_HYBRID_run(&job, path) != GRAIN128AEAD_FPGA_RES_OK )
+			return job.res;
+		t1 = clock_ticks() - t1;
+
+		cost[path].fixed = t0;
+		cost[path].per_byte = ( t1 > t0 ) ? ( ( t1 - t0 ) << 8 ) / GRAIN128AEAD_HYBRID_CALIB_BYTES : 0;
+		cost[path].requests = 0;
+	}
+
+	return GRAIN128AEAD_FPGA_RES_OK;
+}
+
+GRAIN128AEAD_HYBRID_PATH GRAIN128AEAD_HYBRID_route(const GRAIN128AEAD_FPGA_JOB *job) {
+	uint64_t bytes = GRAIN128AEAD_HYBRID_msg_bytes(job);
+
+	if( !GRAIN128AEAD_HYBRID_sw_allowed(job) )
+		return GRAIN128AEAD_HYBRID_FPGA;
+	return GRAIN128AEAD_HYBRID_predict(GRAIN128AEAD_HYBRID_SW, bytes) < GRAIN128AEAD_HYBRID_predict(GRAIN128AEAD_HYBRID_FPGA, bytes) ?
+		   GRAIN128AEAD_HYBRID_SW : GRAIN128AEAD_HYBRID_FPGA;
+}
+
+void GRAIN128AEAD_HYBRID_get_cost(GRAIN128AEAD_HYBRID_PATH path, GRAIN128AEAD_HYBRID_COST *c) {
+	*c = cost[path];
+}
+
+void GRAIN128AEAD_HYBRID_set_cost(GRAIN128AEAD_HYBRID_PATH path, const GRAIN128AEAD_HYBRID_COST *c) {
+	cost[path].fixed = c->fixed;
+	cost[path].per_byte = c->per_byte;
+}
+
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_HYBRID_encrypt (
+												uint8_t *key,
+												uint8_t *IV,
+												uint8_t *AD, uint8_t ADlen,
+												const uint8_t *msg, uint64_t msgLen,
+												uint8_t *ciphertext) {
+	GRAIN128AEAD_FPGA_JOB job = { key, IV, AD, ADlen, msg, msgLen, ciphertext, 1, GRAIN128AEAD_FPGA_RES_OK };
+	return GRAIN128AEAD_HYBRID_run(&job, GRAIN128AEAD_HYBRID_route(&job));
+}
+
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_HYBRID_decrypt (
+												uint8_t *key,
+												uint8_t *IV,
+												uint8_t *AD, uint8_t ADlen,
+												const uint8_t *ciphertext, uint64_t cipherLen,
+												uint8_t *msg) {
+	GRAIN128AEAD_FPGA_JOB job = { key, IV, AD, ADlen, ciphertext, cipherLen, msg, 0, GRAIN128AEAD_FPGA_RES_OK };
+	return GRAIN128AEAD_HYBRID_run(&job, GRAIN128AEAD_HYBRID_route(&job));
+}
+
+GRAIN128AEAD_FPGA_RETURN_CODE GRAIN128AEAD_HYBRID_run_jobs(GRAIN128AEAD_FPGA_JOB *jobs, uint32_t n) {
+	GRAIN128AEAD_FPGA_JOB fpga[GRAIN128AEAD_HYBRID_MAX_BATCH];
+	GRAIN128AEAD_FPGA_JOB *fpga_src[GRAIN128AEAD_HYBRID_MAX_BATCH];
+	GRAIN128AEAD_HYBRID_SW_JOBS sw;
+	GRAIN128AEAD_FPGA_RETURN_CODE res = GRAIN128AEAD_FPGA_RES_OK, fpga_res;
+	uint64_t fpga_load, sw_load, bytes, fpga_cost, sw_cost;
+	uint32_t base, i, n_fpga;
+
+	for(base = 0; base < n; base += GRAIN128AEAD_HYBRID_MAX_BATCH) {
+		n_fpga = 0;
+		sw.n = 0;
+		sw.next = 0;
+		sw.res = GRAIN128AEAD_FPGA_RES_OK;
+		fpga_load = 0;
+		sw_load = 0;
+
+		// the cores work side by side, the software jobs one after the other
+		for(i = base; i < n && i < base + GRAIN128AEAD_HYBRID_MAX_BATCH; i++) {
+			bytes = GRAIN128AEAD_HYBRID_msg_bytes(&jobs[i]);
+			fpga_cost = GRAIN128AEAD_HYBRID_predict(GRAIN128AEAD_HYBRID_FPGA, bytes) / GRAIN128AEAD_FPGA_NUM_CORES;
+			sw_cost = GRAIN128AEAD_HYBRID_predict(GRAIN128AEAD_HYBRID_SW, bytes);
+			if( GRAIN128AEAD_HYBRID_sw_allowed(&jobs[i]) && sw_load + sw_cost < fpga_load + fpga_cost ) {
+				sw.jobs[sw.n++] = &jobs[i];
+				sw_load += sw_cost;
+			} else {
+				fpga_src[n_fpga] = &jobs[i];
+				fpga[n_fpga++] = jobs[i];
+				fpga_load += fpga_cost;
+			}
+		}
+
+		fpga_res = GRAIN128AEAD_FPGA_run_jobs_idle(fpga, n_fpga, GRAIN128AEAD_HYBRID_sw_step, &sw);
+		if( fpga_res != GRAIN128AEAD_FPGA_RES_OK )
+			res = fpga_res;
+		for(i = 0; i < n_fpga; i++)
+			fpga_src[i]->res = fpga[i].res;
+		cost[GRAIN128AEAD_HYBRID_FPGA].requests += n_fpga;
+
+		// software jobs left when the cores are done
+		while( sw.next < sw.n )
+			GRAIN128AEAD_HYBRID_sw_step(&sw);
+		if( sw.res != GRAIN128AEAD_FPGA_RES_OK )
+			res = sw.res;
+	}
+
+	return res;
+}
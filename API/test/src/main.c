@@ -157,10 +157,12 @@ int main(void)
 
 	print_uart("\r\n\r\n");
 	print_uart("Lauching FPGA programming");
-	B5_FPGA_Programming();
-	for(i=0; i < 3; i++) {
-		print_uart("..");
-		HAL_Delay(1000);
+	// the device keeps its configuration across resets: no need to wait for a bitstream it already runs
+	if(B5_FPGA_Programming() != B5_FPGA_ALREADY_PROGRAMMED) {
+		for(i=0; i < 3; i++) {
+			print_uart("..");
+			HAL_Delay(1000);
+		}
 	}
 	print_uart("[DONE]");
 
@@ -199,6 +201,14 @@ int main(void)
 	test_grain128aead(4,10);
 	print_uart("\r\n\r\n");
 
+	// timings of the transactions of the driver, per phase
+	print_uart("Type 'p' to print the timings of the driver : ");
+	HAL_UART_Receive(&huart1, &cmd, 1, HAL_MAX_DELAY);
+	if (cmd == 'p') {
+		GRAIN128AEAD_FPGA_print_telemetry();
+		print_uart("\r\n\r\n");
+	}
+
 	/* USER CODE END  */
 
 	return 0;
@@ -245,11 +255,9 @@ void SystemClock_Config(void)
 
 /* USER CODE BEGIN 4 */
 int test_grain128aead(uint8_t adLen, uint64_t msgLen) {
-	uint8_t mac_count = (msgLen/24);
-	(msgLen%24)!=0 ? mac_count++ : mac_count;
-
-	uint8_t res_vhdl[(msgLen + mac_count*8)*2];
-	uint64_t resLen = (msgLen + mac_count*8);
+	// the whole message gets a single 8-byte tag
+	uint8_t res_vhdl[(msgLen + 8)*2];
+	uint64_t resLen = (msgLen + 8);
 
 	const char *key_string = "0123456789abcdef123456789abcdef0";
 	const char *iv_string = "0123456789abcdef12345678";
@@ -264,13 +272,13 @@ int test_grain128aead(uint8_t adLen, uint64_t msgLen) {
 	print_uart("\r\n");
 	print_uart("\r\n");
 	print_uart("ctx = ");
-	for(size_t i=0;i<(msgLen + mac_count*8)*2;i++){
+	for(size_t i=0;i<resLen*2;i++){
 		print_uart_hex(res_vhdl[i]);
 	}
 
 	HAL_Delay(1000);
 
-	uint8_t msg_decrypted[(msgLen + mac_count*8)];
+	uint8_t msg_decrypted[msgLen*2];
 
 //	print_uart("\r\n");
 //	print_uart("\r\n");
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""Pack the VME algorithm and data files of the FPGA bitstream for API/src/FPGA.c.
+
+    vme_pack.py ALGO DATA > API/inc/TEST_FPGA.h
+
+ALGO and DATA are the .vme files of the Diamond Deployment Tool, or its
+"Embedded Algo/Data File" .c outputs. Each file is cut in blocks of
+FPGA_VME_BLOCK bytes compressed on their own, so that GetByte() can
+unpack any block in a small window without the rest of the file:
+
+    token t < 0x80   t+1 literal bytes follow
+    token t >= 0x80  copy (t & 0x7F) + 4 bytes from offset o back in the
+                     block, o on the next two bytes (little endian)
+
+The blocks of a file are concatenated, __fpga_<name>_blocks[k] being the
+offset of block k (one more entry marks the end).
+"""
+
+import re
+import sys
+
+BLOCK = 1024
+MIN_MATCH = 4
+MAX_MATCH = 0x7F + MIN_MATCH
+MAX_LITERALS = 0x80
+
+
+def read_vme(path):
+    data = open(path, 'rb').read()
+    if path.endswith('.c') or path.endswith('.h'):
+        text = data.decode('latin-1')
+        body = text[text.index('{', text.index('[')):text.index('};')]
+        data = bytes(int(x, 16) for x in re.findall(r'0x([0-9A-Fa-f]{2})', body))
+    return data
+
+
+def pack_block(block):
+    out = bytearray()
+    literals = bytearray()
+    chains = {}
+    i = 0
+
+    def flush():
+        nonlocal literals
+        while literals:
+            run = literals[:MAX_LITERALS]
+            out.append(len(run) - 1)
+            out.extend(run)
+            literals = literals[MAX_LITERALS:]
+
+    while i < len(block):
+        best, offset = 0, 0
+        for j in reversed(chains.get(bytes(block[i:i + MIN_MATCH]), [])):
+            n = 0
+            while i + n < len(block) and n < MAX_MATCH and block[j + n] == block[i + n]:
+                n += 1
+            if n > best:
+                best, offset = n, i - j
+                if n == MAX_MATCH:
+                    break
+        end = i + best if best >= MIN_MATCH else i + 1
+        for k in range(i, end):
+            chains.setdefault(bytes(block[k:k + MIN_MATCH]), []).append(k)
+        if best >= MIN_MATCH:
+            flush()
+            out.append(0x80 | (best - MIN_MATCH))
+            out.extend((offset & 0xFF, offset >> 8))
+        else:
+            literals.append(block[i])
+        i = end
+    flush()
+    return bytes(out)
+
+
+def unpack_block(packed, size):
+    out = bytearray()
+    i = 0
+    while len(out) < size:
+        t = packed[i]
+        i += 1
+        if t < 0x80:
+            out.extend(packed[i:i + t + 1])
+            i += t + 1
+        else:
+            offset = packed[i] | packed[i + 1] << 8
+            i += 2
+            for _ in range((t & 0x7F) + MIN_MATCH):
+                out.append(out[-offset])
+    return bytes(out)
+
+
+def pack(data):
+    packed = bytearray()
+    blocks = []
+    for k in range(0, len(data), BLOCK):
+        block = pack_block(data[k:k + BLOCK])
+        assert unpack_block(block, len(data[k:k + BLOCK])) == data[k:k + BLOCK]
+        blocks.append(len(packed))
+        packed.extend(block)
+    blocks.append(len(packed))
+    return bytes(packed), blocks
+
+
+def c_array(ctype, name, values, fmt, per_line):
+    lines = []
+    for k in range(0, len(values), per_line):
+        lines.append(', '.join(fmt % v for v in values[k:k + per_line]))
+    return 'const %s %s[] = {\n  %s\n};\n' % (ctype, name, ', \n  '.join(lines))
+
+
+HEADER = """/**
+  ******************************************************************************
+  * File Name          : TEST_FPGA.c
+  * Description        : FPGA bitstream
+  						 contains the bitstream arrays for the FPGA package 
+  						 containing: Data Buffer, IP Manager and grain128-AEAD IP Core
+  						 Generated by API/tools/vme_pack.py: VME files in blocks of
+  						 FPGA_VME_BLOCK bytes, each one compressed on its own
+  ******************************************************************************
+  *
+  * Copyright \ufffd 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#include <stdint.h>
+
+"""
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    out = [HEADER, '#define FPGA_VME_BLOCK %d\n\n' % BLOCK]
+    for name, path in (('alg', sys.argv[1]), ('data', sys.argv[2])):
+        data = read_vme(path)
+        packed, blocks = pack(data)
+        sys.stderr.write('%s: %d bytes packed in %d (+%d of index)\n' % (path, len(data), len(packed), 4 * len(blocks)))
+        out.append('const uint32_t __fpga_%s_size = %d;\n' % (name, len(data)))
+        out.append(c_array('uint8_t', '__fpga_%s' % name, packed, '0x%02X', 15))
+        out.append(c_array('uint32_t', '__fpga_%s_blocks' % name, blocks, '%d', 12))
+        out.append('\n\n')
+    text = ''.join(out).rstrip('\n') + '\n'
+    sys.stdout.buffer.write(text.replace('\n', '\r\n').encode('utf-8'))
+
+
+if __name__ == '__main__':
+    main()
@@ -187,262 +187,149 @@ int my_grain_init(const unsigned char *key_in, const unsigned char *iv_in){
     //End of the initialization
     grain_round = NORMAL;
 
-
+    return 0;
 }
 
-void encrypt_message(unsigned char *key, unsigned char *iv, 
-    unsigned char *message, unsigned char *associated_data,
-    unsigned char *ciphertext){
+//grain_start: initializes the cipher with (key,iv) and accumulates the tag for the associated data.
+//The message can then be processed in any number of pieces by grain_encrypt_bytes/grain_decrypt_bytes.
+void grain_start(const unsigned char *key, const unsigned char *iv,
+    const unsigned char *associated_data, unsigned long long ad_len){
 
 	//Swapped arrays
     unsigned char key_swb[16] = {0};
     unsigned char iv_swb[12] = {0};
-    unsigned char msg_swb[MSG_SIZE] = {0};
-    unsigned char ad_swb[AD_SIZE] = {0};
 
-    unsigned char message_bit[(8*MSG_SIZE) + 1] = {0};
-    unsigned long long message_bit_len = (8*MSG_SIZE) + 1 ;
-
-    unsigned char final_associated_data[AD_SIZE + 1] = {0};
+    //DER encoding of the AD length: 1 byte if <128, otherwise 0x80|n followed by n bytes
+    unsigned char ad_len_der[1 + sizeof(ad_len)] = {0};
+    unsigned long long ad_len_der_size = 1;
+    unsigned long long ad_bytes = 0;
 
     //Swap the bytes
     for (i = 0; i < 16; i++) {
-		key_swb[i] = swapsb(key[i]);	
+		key_swb[i] = swapsb(key[i]);
 	}
 	for (i = 0; i < 12; i++) {
 		iv_swb[i] = swapsb(iv[i]);
 	}
-	for (i = 0; i < AD_SIZE; i++) {
-		ad_swb[i] = swapsb(associated_data[i]);
-	}
 
     //Initialize the cipher
     my_grain_init(key_swb, iv_swb);
 
-    //Encoding of AD_SIZE (if <128 always 1 byte)
-    unsigned char associated_data_length_encoded = swapsb((unsigned char)AD_SIZE); 
-
-    //enc(AD_SIZE) || AD
-    final_associated_data[0] = associated_data_length_encoded;
-	for(k = 1; k<AD_SIZE+1; k++){
-		final_associated_data[k] = ad_swb[k-1];	
-	}
-
-    //accumulate tag for associated data only 
-	//printf("----- ACCUMULATING TAG FOR AD ONLY-----\n");
-    unsigned long long ad_cnt = 0;
-	unsigned char adval = 0;
-	unsigned int counter = 0, acc_counter = 0;
-    for ( k = 0; k < (1 + AD_SIZE); k++) {
-		/* every second bit(odd) is used for keystream, the others(even) for MAC */
-		for ( j = 0; j < 16; j++) {
-			unsigned char z_next = next_z(0);
-			if (j % 2 == 0) {
-				// do not accumulate
-			} else {
-				adval = final_associated_data[ad_cnt / 8] & (1 << (7 - (ad_cnt % 8)));
-				if (adval) {
-					accumulate();
-					acc_counter++;
-				}
-				auth_shift(z_next);
-				ad_cnt++;
-			}
+	if (ad_len < 128) {
+		ad_len_der[0] = (unsigned char)ad_len;
+	} else {
+		for (ad_bytes = ad_len; ad_bytes > 0; ad_bytes >>= 8) {
+			ad_len_der_size++;
 		}
-	}
-		
-	memset(msg_swb, 0, sizeof(msg_swb));
-	memset(message_bit, 0, sizeof(message_bit));
-	memset(ciphertext, 0, MSG_SIZE+8);
-
-	for (i = 0; i < MSG_SIZE; i++) {
-		msg_swb[i] = swapsb(message[i]);
-		//printf("%02x ", msg_swb[i]);
-	}
-	
-
-	//Byte => bits
-	for ( k = 0; k < MSG_SIZE; k++) {
-		for ( l = 0; l < 8; l++) {
-			message_bit[8 * k + l ] = (msg_swb[k] & (1 << (7-l))) >> (7-l);
+		ad_len_der[0] = 0x80 | (ad_len_der_size - 1);
+		for (i = 1; i < ad_len_der_size; i++) {
+			ad_len_der[i] = (unsigned char)(ad_len >> (8 * (ad_len_der_size - 1 - i)));
 		}
 	}
-	//Last bit should be 1
-	message_bit[message_bit_len-1] = 1;
-
-	//Encrypt the message
-	//printf("----- ENCRYPTION -----\n");
-	unsigned long long ac_cnt = 0;
-	unsigned long long m_cnt = 0;
-	unsigned long long c_cnt = 0;
-	unsigned char cc = 0;
 
-	for (k = 0; k < MSG_SIZE; k++) {
-		// every second bit is used for keystream, the others for MAC
-		cc = 0;
+    //accumulate tag for enc(ad_len) || AD: every second bit(odd) is used for the MAC
+    unsigned char adval = 0;
+    for (k = 0; k < ad_len_der_size + ad_len; k++) {
+		unsigned char adbyte = (k < ad_len_der_size) ? ad_len_der[k] : associated_data[k - ad_len_der_size];
 		for (j = 0; j < 16; j++) {
 			unsigned char z_next = next_z(0);
-			if (j % 2 == 0) {
-				//generate_keystream
-				// transform it back to 8 bits per byte
-				cc |= (message_bit[m_cnt] ^ z_next) << (7 - (c_cnt % 8));
-				//printf("msg_bit[%d]: %d\n", m_cnt, message_bit[m_cnt]);
-				m_cnt++;
-				c_cnt++;
-			} else {
-				if (message_bit[ac_cnt] == 1) {
+			if (j % 2 == 1) {
+				adval = (adbyte >> (j / 2)) & 1;
+				if (adval) {
 					accumulate();
 				}
-				ac_cnt ++;
 				auth_shift(z_next);
 			}
 		}
-		//printf("\n");
-		ciphertext[k] = swapsb(cc);
-		
 	}
-
-	// generate unused keystream bit
-	next_z(0);
-	// the 1 in the padding means accumulation
-	accumulate();
-
-	// append MAC to ciphertext 
-	unsigned long long acc_idx = 0;
-
-	for (i = MSG_SIZE; i < MSG_SIZE + 8; i++) {
-		unsigned char acc = 0;
-		// transform back to 8 bits per byte
-		for (j = 0; j < 8; j++) {
-			acc |= grain.auth_acc[8 * acc_idx + j] << (7 - j);
-		}
-		ciphertext[i] = swapsb(acc);
-		acc_idx++;
-	}
-
 }
 
-int decrypt_message(unsigned char *key, unsigned char *iv, 
-    unsigned char *ciphertext, unsigned char *associated_data,
-    unsigned char *message){
-	
-	//Swapped arrays
-	unsigned char key_swb[16] = {0};
-    unsigned char iv_swb[12] = {0};
-    unsigned char ct_swb[MSG_SIZE+8] = {0};
-    unsigned char ad_swb[AD_SIZE] = {0};
-
-    unsigned char ciphertext_bit[(8*(MSG_SIZE+8)) + 1] = {0};
-    unsigned long long ciphertext_bit_len = (8*(MSG_SIZE+8)) + 1 ;
-
-    unsigned char final_associated_data[AD_SIZE + 1] = {0};
-
-    //Swap the bytes
-    for (i = 0; i < 16; i++) {
-		key_swb[i] = swapsb(key[i]);	
-	}
-	for (i = 0; i < 12; i++) {
-		iv_swb[i] = swapsb(iv[i]);
-	}
-    for (i = 0; i < MSG_SIZE+8; i++) {
-		ct_swb[i] = swapsb(ciphertext[i]);	
-	}
-	for (i = 0; i < AD_SIZE; i++) {
-		ad_swb[i] = swapsb(associated_data[i]);
-	}
-
-    //Initialize the cipher
-    my_grain_init(key_swb, iv_swb);
-
-    //Byte => bits
-    for ( k = 0; k < (MSG_SIZE+8); k++) {
-		for ( l = 0; l < 8; l++) {
-			ciphertext_bit[8 * k + l] = (ct_swb[k] & (1 << (7-l))) >> (7-l);
-		}
-	}
-	ciphertext_bit[ciphertext_bit_len - 1] = 1;
-
-	//Encoding of AD_SIZE (if <128 always 1 byte)
-    unsigned char associated_data_length_encoded = swapsb((unsigned char)AD_SIZE);
-
-    //enc(AD_SIZE) || AD
-    final_associated_data[0] = associated_data_length_encoded;
-	for(k = 1; k<AD_SIZE+1; k++){
-		final_associated_data[k] = ad_swb[k-1];	
-	}
-
-	unsigned long long ad_cnt = 0;
-	unsigned char adval = 0;
+//grain_encrypt_bytes: encrypts the next len bytes of the message
+void grain_encrypt_bytes(const unsigned char *message, unsigned char *ciphertext, unsigned long long len){
+	unsigned char msgbit = 0;
+	unsigned char cc = 0;
 
-	//printf("----- ACCUMULATING TAG FOR AD ONLY-----\n");
-	/* accumulate tag for associated data only */
-	for ( k = 0; k < (AD_SIZE + 1); k++) {
-		/* every second bit is used for keystream, the others for MAC */
-		for (j = 0; j < 16; j++) {
+	for (k = 0; k < len; k++) {
+		cc = 0;
+		for (l = 0; l < 8; l++) {
+			msgbit = (message[k] >> l) & 1;
+			// keystream bit
+			cc |= (msgbit ^ next_z(0)) << l;
+			// accumulator bit
 			unsigned char z_next = next_z(0);
-			if (j % 2 == 0) {
-				// do not encrypt
-			} else {
-				adval = final_associated_data[ad_cnt / 8] & (1 << (7 - (ad_cnt % 8)));
-				if (adval) {
-					accumulate();
-				}
-				auth_shift(z_next);
-				ad_cnt++;
+			if (msgbit == 1) {
+				accumulate();
 			}
+			auth_shift(z_next);
 		}
+		ciphertext[k] = cc;
 	}
+}
 
-
-	//Decrypt the message
-	//printf("----- DECRYPTION -----\n");
-	unsigned long long ac_cnt = 0;
-	unsigned long long c_cnt = 0;
-	unsigned char msgbyte = 0;
+//grain_decrypt_bytes: decrypts the next len bytes of the ciphertext
+void grain_decrypt_bytes(const unsigned char *ciphertext, unsigned char *message, unsigned long long len){
 	unsigned char msgbit = 0;
+	unsigned char msgbyte = 0;
 
-	// generate keystream for message, skipping tag
-	for ( k = 0; k < MSG_SIZE; k++) {
-		// every second bit is used for keystream, the others for MAC
+	for (k = 0; k < len; k++) {
 		msgbyte = 0;
-		for (j = 0; j < 8; j++) {
-			unsigned char z_next = next_z(0);
+		for (l = 0; l < 8; l++) {
 			// decrypt ciphertext
-			msgbit = ciphertext_bit[c_cnt] ^ z_next;
-			// transform it back to 8 bits per byte
-			msgbyte |= msgbit << (7 - (c_cnt % 8));
-
-			// generate accumulator bit
-			z_next = next_z(0);
+			msgbit = ((ciphertext[k] >> l) & 1) ^ next_z(0);
+			msgbyte |= msgbit << l;
 			// use the decrypted message bit to control accumulator
+			unsigned char z_next = next_z(0);
 			if (msgbit == 1) {
 				accumulate();
 			}
 			auth_shift(z_next);
-
-			c_cnt++;
-			ac_cnt++;
 		}
-		message[k] = swapsb(msgbyte);
+		message[k] = msgbyte;
 	}
+}
 
-
+//grain_tag: closes the message with the padding bit and returns the 8 bytes of the MAC
+void grain_tag(unsigned char *tag){
 	// generate unused keystream bit
 	next_z(0);
 	// the 1 in the padding means accumulation
 	accumulate();
-	unsigned int equal = 1;
+
+	for (i = 0; i < 8; i++) {
+		tag[i] = 0;
+		for (j = 0; j < 8; j++) {
+			tag[i] |= grain.auth_acc[8 * i + j] << j;
+		}
+	}
+}
+
+void encrypt_message(unsigned char *key, unsigned char *iv, 
+    unsigned char *message, unsigned char *associated_data,
+    unsigned char *ciphertext){
+
+	grain_start(key, iv, associated_data, AD_SIZE);
+	grain_encrypt_bytes(message, ciphertext, MSG_SIZE);
+	// append MAC to ciphertext
+	grain_tag(&ciphertext[MSG_SIZE]);
+}
+
+int decrypt_message(unsigned char *key, unsigned char *iv, 
+    unsigned char *ciphertext, unsigned char *associated_data,
+    unsigned char *message){
+
+	unsigned char tag[8];
+
+	grain_start(key, iv, associated_data, AD_SIZE);
+	grain_decrypt_bytes(ciphertext, message, MSG_SIZE);
+	grain_tag(tag);
+
 	printf("----- AUTHENTICATION PHASE-----\n");
 	// check MAC
-	for(k=0; k<64; k++){
-		if(grain.auth_acc[k] != ciphertext_bit[8*(MSG_SIZE) + k]){
-			printf("NOT AUTHENTICATED!\n");
-			equal = 0;
-			memset(message, 0, MSG_SIZE);
-			return -1;
-		}
+	if (memcmp(tag, &ciphertext[MSG_SIZE], 8) != 0) {
+		printf("NOT AUTHENTICATED!\n");
+		memset(message, 0, MSG_SIZE);
+		return -1;
 	}
-	if(equal)
-		printf("AUTHENTICATED!\n");
+	printf("AUTHENTICATED!\n");
 	return 0;
 }
@@ -38,6 +38,12 @@ void accumulate();
 unsigned char next_z(unsigned char keybit);
 
 
+void grain_start(const unsigned char *key, const unsigned char *iv,
+    const unsigned char *associated_data, unsigned long long ad_len);
+void grain_encrypt_bytes(const unsigned char *message, unsigned char *ciphertext, unsigned long long len);
+void grain_decrypt_bytes(const unsigned char *ciphertext, unsigned char *message, unsigned long long len);
+void grain_tag(unsigned char *tag);
+
 void encrypt_message(unsigned char *key, unsigned char *iv, 
     unsigned char *message, unsigned char *associated_data,
     unsigned char *ciphertext);
@@ -2,20 +2,34 @@ library IEEE;
 use IEEE.STD_LOGIC_1164.ALL;
 use ieee.numeric_std.all;
 
+--PARALLEL keystream bits are computed per NEXT_Z: the taps of Grain-128AEAD stop at bit 96 of the registers,
+--so up to 32 clocks of the cipher only depend on the current state and unroll into a single level of logic.
+--Between two operations, stream_en processes a 16-bit word of the message per clock without going through the FSM,
+--bit 15 first (only the upper byte if stream_half is 1): the core runs two clocks of the cipher per bit,
+--stream_data_out is the word ciphered with the first keystream bit of each pair, the authenticator takes the second,
+--accumulating the whole word (the output one when stream_decrypt is 1) in the same clock
 entity grain128_core is
+    generic(
+            PARALLEL        : integer := 1     --1, 8, 16 or 32
+        );
     port(
             clk             : in std_logic;
             rst             : in std_logic;
             data_16_in      : in std_logic_vector(15 downto 0);
             data_16_addr_in : in std_logic_vector(2 downto 0);
-            serial_data_in  : in std_logic;
+            serial_data_in  : in std_logic_vector(PARALLEL-1 downto 0);
             start           : in std_logic;
             operation       : in std_logic_vector(2 downto 0);
             grain_round     : in std_logic_vector(1 downto 0);
             data_16_out     : out std_logic_vector(15 downto 0);
-            serial_data_out : out std_logic;
+            serial_data_out : out std_logic_vector(PARALLEL-1 downto 0);
             completed       : out std_logic;
-            busy            : out std_logic
+            busy            : out std_logic;
+            stream_en       : in std_logic;
+            stream_half     : in std_logic;
+            stream_decrypt  : in std_logic;
+            stream_data_in  : in std_logic_vector(15 downto 0);
+            stream_data_out : out std_logic_vector(15 downto 0)
         );
 end grain128_core;
 
@@ -48,6 +62,59 @@ begin
     return (nfsr(127-2) xor nfsr(127-15) xor nfsr(127-36) xor nfsr(127-45) xor nfsr(127-64) xor nfsr(127-73) xor nfsr(127-89));
 end nfsr_tmp;
 
+--One clock of the cipher on the registers l and n, y is its output
+procedure clock_cipher(round : in std_logic_vector(1 downto 0); key_bit : in std_logic;
+                       l, n : inout std_logic_vector(127 downto 0); y : out std_logic) is
+variable z, out_i, lfsr_fb, nfsr_fb : std_logic;
+begin
+    z := (next_h(l, n) xor l(127-93) xor nfsr_tmp(n));
+    out_i := l(127);
+    case round is
+        when "00" => --INIT
+                     lfsr_fb := next_lfsr_fb(l) xor z;
+                     nfsr_fb := next_nfsr_fb(n) xor out_i xor z;
+        when "01" => --ADDKEY
+                     lfsr_fb := next_lfsr_fb(l) xor key_bit;
+                     nfsr_fb := next_nfsr_fb(n) xor out_i;
+        when others => --NORMAL
+                     lfsr_fb := next_lfsr_fb(l);
+                     nfsr_fb := next_nfsr_fb(n) xor out_i;
+    end case;
+    l := l(126 downto 0) & lfsr_fb;
+    n := n(126 downto 0) & nfsr_fb;
+    y := z;
+end clock_cipher;
+
+--Keystream of a word of the stream: 32 clocks of the cipher in the NORMAL round, the first bit in 31
+function stream_keystream(lfsr, nfsr : std_logic_vector(127 downto 0)) return std_logic_vector is
+variable l, n : std_logic_vector(127 downto 0);
+variable z : std_logic_vector(31 downto 0);
+variable y : std_logic;
+begin
+    l := lfsr;
+    n := nfsr;
+    for k in 31 downto 0 loop
+        clock_cipher("10", '0', l, n, y);
+        z(k) := y;
+    end loop;
+    return z;
+end stream_keystream;
+
+--Authenticator: the bits of m from 15 down (from 15 to 8 if half is 1), each one accumulating the shift register
+--before the bit of z in the same position is shifted in
+procedure authenticate(m, z : in std_logic_vector(15 downto 0); half : in std_logic;
+                       acc, sr : inout std_logic_vector(63 downto 0)) is
+begin
+    for j in 15 downto 0 loop
+        if(half = '0' or j >= 8) then
+            if(m(j) = '1') then
+                acc := acc xor sr;
+            end if;
+            sr := sr(62 downto 0) & z(j);
+        end if;
+    end loop;
+end authenticate;
+
 signal lfsr, nfsr : std_logic_vector(127 downto 0);
 signal auth_sr, auth_acc : std_logic_vector(63 downto 0);
 
@@ -55,16 +122,31 @@ signal data_16_in_i : std_logic_vector(15 downto 0);
 signal data_16_addr_in_i : std_logic_vector(2 downto 0);
 signal operation_i : std_logic_vector(2 downto 0);
 signal grain_round_i : std_logic_vector(1 downto 0);
-signal serial_data_in_i : std_logic;
+signal serial_data_in_i : std_logic_vector(PARALLEL-1 downto 0);
 
 type Statetype is (OFF, SELECT_OP, LOAD_KEY, LOAD_IV, NEXT_Z, LOAD_AUTH_ACC, LOAD_AUTH_SR, ACCUMULATE, READ_AUTH_ACC, DONE);
 signal state : Statetype;
 
+signal stream_z : std_logic_vector(31 downto 0);
+
 
 begin
 
+assert PARALLEL = 1 or PARALLEL = 8 or PARALLEL = 16 or PARALLEL = 32
+    report "grain128_core: PARALLEL must be 1, 8, 16 or 32" severity failure;
+
+--keystream of the word of the stream: the first clock of each pair ciphers the message, the second feeds the authenticator
+stream_z <= stream_keystream(lfsr, nfsr);
+stream_out: for j in 0 to 15 generate
+    stream_data_out(j) <= stream_data_in(j) xor stream_z(2*j+1);
+end generate;
+
 process(clk)
-variable y, out_i : std_logic;
+variable y : std_logic;
+variable lfsr_v, nfsr_v : std_logic_vector(127 downto 0);
+variable z_v : std_logic_vector(PARALLEL-1 downto 0);
+variable acc_v, sr_v : std_logic_vector(63 downto 0);
+variable msg_word, auth_word : std_logic_vector(15 downto 0);
 --variable out_i_vector, shift_lfsr_vector, shift_nfsr_vector : std_logic_vector(0 downto 0); 
 
 begin
@@ -79,7 +161,7 @@ begin
     elsif(rising_edge(clk)) then
         case state is
             when OFF =>
-                        serial_data_out <= '0';
+                        serial_data_out <= (others=>'0');
                         completed <= '1';
                         busy <= '0';
                         if(start = '1')then
@@ -89,6 +171,27 @@ begin
                             grain_round_i <= grain_round;
                             serial_data_in_i <= serial_data_in;
                             state <= SELECT_OP;
+                        elsif(stream_en = '1') then
+                            --a word of the message, its keystream is stream_z
+                            lfsr_v := lfsr;
+                            nfsr_v := nfsr;
+                            for k in 31 downto 0 loop
+                                if(stream_half = '0' or k >= 16) then
+                                    clock_cipher("10", '0', lfsr_v, nfsr_v, y);
+                                end if;
+                            end loop;
+                            lfsr <= lfsr_v;
+                            nfsr <= nfsr_v;
+                            for j in 0 to 15 loop
+                                msg_word(j) := stream_data_in(j) xor (stream_decrypt and stream_z(2*j+1));
+                                auth_word(j) := stream_z(2*j);
+                            end loop;
+                            acc_v := auth_acc;
+                            sr_v := auth_sr;
+                            authenticate(msg_word, auth_word, stream_half, acc_v, sr_v);
+                            auth_acc <= acc_v;
+                            auth_sr <= sr_v;
+                            state <= OFF;
                         else
                             state <= OFF;
                         end if;
@@ -104,67 +207,71 @@ begin
                             when "110" => state <= READ_AUTH_ACC;
                             when others => state <= OFF;                  
                         end case;
-                        serial_data_out <= '0'; 
+                        serial_data_out <= (others=>'0'); 
                         completed <= '0';
             when LOAD_IV =>
                         busy <= '1';
-                        serial_data_out <= '0'; 
+                        serial_data_out <= (others=>'0'); 
                         completed <= '0';
                         lfsr(15+(16*to_integer(unsigned(data_16_addr_in_i))) downto (16*to_integer(unsigned(data_16_addr_in_i)))) <= data_16_in_i;
                         state <= DONE;
                         
             when LOAD_KEY => 
                         busy <= '1';
-                        serial_data_out <= '0'; 
+                        serial_data_out <= (others=>'0'); 
                         completed <= '0';
                         nfsr(15+(16*to_integer(unsigned(data_16_addr_in_i))) downto (16*to_integer(unsigned(data_16_addr_in_i)))) <= data_16_in_i;
                         state <= DONE;
             when NEXT_Z =>
                         busy <= '1';
-                        y := (next_h(lfsr, nfsr) xor lfsr(127-93) xor nfsr_tmp(nfsr));
-                        case grain_round_i is
-                            when "00" => --INIT
-                                         out_i := lfsr(127); 
-                                         lfsr <= lfsr(126 downto 0) & (next_lfsr_fb(lfsr) xor y);
-                                         nfsr <= nfsr(126 downto 0) & (next_nfsr_fb(nfsr) xor out_i xor y);
-                                         
-                            when "01" => --ADDKEY
-                                         out_i := lfsr(127);           
-                                         lfsr <= lfsr(126 downto 0) & (next_lfsr_fb(lfsr) xor serial_data_in_i);
-                                         nfsr <= nfsr(126 downto 0) & (next_nfsr_fb(nfsr) xor out_i);
-                            when "10" => --NORMAL
-                                         out_i := lfsr(127);           
-                                         lfsr <= lfsr(126 downto 0) & (next_lfsr_fb(lfsr));
-                                         nfsr <= nfsr(126 downto 0) & (next_nfsr_fb(nfsr) xor out_i);
-                            when others => 
-                            
-                        end case;   
-                        serial_data_out <= y;
+                        --PARALLEL clocks of the cipher, the first one gives the bit PARALLEL-1 of the output and
+                        --takes the bit PARALLEL-1 of the key
+                        lfsr_v := lfsr;
+                        nfsr_v := nfsr;
+                        for k in PARALLEL-1 downto 0 loop
+                            clock_cipher(grain_round_i, serial_data_in_i(k), lfsr_v, nfsr_v, y);
+                            z_v(k) := y;
+                        end loop;
+                        if(grain_round_i /= "11") then
+                            lfsr <= lfsr_v;
+                            nfsr <= nfsr_v;
+                        end if;
+                        serial_data_out <= z_v;
                         completed <= '0';
                         state <= DONE;
             when LOAD_AUTH_ACC => busy <= '1';
-                                  auth_acc <= auth_acc(62 downto 0) & serial_data_in_i;
-                                  serial_data_out <= '0';
+                                  --the keystream of the initialisation comes PARALLEL bits at a time, one bit per message bit otherwise
+                                  if(grain_round_i = "01") then
+                                      auth_acc <= auth_acc(63-PARALLEL downto 0) & serial_data_in_i;
+                                  else
+                                      auth_acc <= auth_acc(62 downto 0) & serial_data_in_i(PARALLEL-1);
+                                  end if;
+                                  serial_data_out <= (others=>'0');
                                   completed <= '0';
                                   state <= DONE;
                                     
             when LOAD_AUTH_SR =>  busy <= '1';
-                                  auth_sr <= auth_sr(62 downto 0) & serial_data_in_i;
-                                  serial_data_out <= '0';
+                                  --the keystream of the initialisation comes PARALLEL bits at a time, one bit per message bit otherwise
+                                  if(grain_round_i = "01") then
+                                      auth_sr <= auth_sr(63-PARALLEL downto 0) & serial_data_in_i;
+                                  else
+                                      auth_sr <= auth_sr(62 downto 0) & serial_data_in_i(PARALLEL-1);
+                                  end if;
+                                  serial_data_out <= (others=>'0');
                                   completed <= '0';
                                   state <= DONE;
                                   
             when ACCUMULATE   =>  busy <= '1';
                                   --report "Auth_acc: " & to_hstring(auth_acc) & "\n Auth_sr: " & to_hstring(auth_sr);
                                   auth_acc <= auth_acc xor auth_sr;
-                                  serial_data_out <= '0';
+                                  serial_data_out <= (others=>'0');
                                   completed <= '0';
                                   state <= DONE;
            
             when READ_AUTH_ACC => --report "ACC_MAC: " & integer'image(to_integer(unsigned(auth_acc))) & " - " & to_hstring(auth_acc) & "h";
                                   busy <= '1';
                                   data_16_out <= auth_acc(15+(16*to_integer(unsigned(data_16_addr_in_i))) downto (16*to_integer(unsigned(data_16_addr_in_i))));
-                                  serial_data_out <= '0';
+                                  serial_data_out <= (others=>'0');
                                   completed <= '0';
                                   state <= DONE;                                                                      
             when DONE =>
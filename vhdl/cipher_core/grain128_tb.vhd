@@ -21,19 +21,27 @@ begin
 end swapsb;
 
 component grain128_core is
+    generic(
+            PARALLEL        : integer := 1
+        );
     port(
             clk             : in std_logic;
             rst             : in std_logic;
             data_16_in      : in std_logic_vector(15 downto 0);
             data_16_addr_in : in std_logic_vector(2 downto 0);
-            serial_data_in  : in std_logic;
+            serial_data_in  : in std_logic_vector(PARALLEL-1 downto 0);
             start           : in std_logic;
             operation       : in std_logic_vector(2 downto 0);
             grain_round     : in std_logic_vector(1 downto 0);
             data_16_out     : out std_logic_vector(15 downto 0);
-            serial_data_out : out std_logic;
+            serial_data_out : out std_logic_vector(PARALLEL-1 downto 0);
             completed       : out std_logic;
-            busy            : out std_logic
+            busy            : out std_logic;
+            stream_en       : in std_logic;
+            stream_half     : in std_logic;
+            stream_decrypt  : in std_logic;
+            stream_data_in  : in std_logic_vector(15 downto 0);
+            stream_data_out : out std_logic_vector(15 downto 0)
         );
 end component;
 
@@ -41,12 +49,12 @@ signal clk_s             : std_logic := '0';
 signal rst_s             : std_logic;
 signal data_16_in_s     : std_logic_vector(15 downto 0);
 signal data_16_addr_in   : std_logic_vector(2 downto 0);
-signal serial_data_in_s  : std_logic;
+signal serial_data_in_s  : std_logic_vector(0 downto 0);  --bit-serial core, PARALLEL = 1
 signal start_s           : std_logic;
 signal operation_s       : std_logic_vector(2 downto 0);
 signal grain_round_s     : std_logic_vector(1 downto 0);
 signal data_16_out_s     : std_logic_vector(15 downto 0);
-signal serial_data_out_s : std_logic;
+signal serial_data_out_s : std_logic_vector(0 downto 0);
 signal completed_S       : std_logic;
 signal busy_s            : std_logic;
 
@@ -62,7 +70,7 @@ signal tag_swapped : std_logic_vector(63 downto 0) := (others=>'0');
 signal final_ct : std_logic_vector(127 downto 0) := (others=>'0');
 begin
 
-DUT: grain128_core port map (clk_s, rst_s, data_16_in_s, data_16_addr_in, serial_data_in_s, start_s, operation_s, grain_round_s, data_16_out_s, serial_data_out_s, completed_S, busy_s);
+DUT: grain128_core port map (clk_s, rst_s, data_16_in_s, data_16_addr_in, serial_data_in_s, start_s, operation_s, grain_round_s, data_16_out_s, serial_data_out_s, completed_S, busy_s, '0', '0', '0', x"0000", open);
 
 ClkProc:process(clk_s)
 begin
@@ -80,7 +88,7 @@ variable adval, compare_value : std_logic_vector(7 downto 0) := (others=>'0');
 variable adval_bit : std_logic := '0';
 begin
     --RESET
-    data_16_in_s <= (others=>'0'); data_16_addr_in <= (others =>'0'); serial_data_in_s <= '0'; start_s <= '0'; operation_s <= "000"; grain_round_s <= "00";
+    data_16_in_s <= (others=>'0'); data_16_addr_in <= (others =>'0'); serial_data_in_s(0) <= '0'; start_s <= '0'; operation_s <= "000"; grain_round_s <= "00";
     rst_s <= '1';
     
     wait until rising_edge(clk_s);
@@ -140,20 +148,20 @@ begin
         -- First generate the next_s value 
         operation_s <= "010"; -- next_z
         grain_round_s <= "01"; -- ADDKEY
-        serial_data_in_s <= key(k);
+        serial_data_in_s(0) <= key(k);
         start_s <= '1';
         wait until busy_s = '1' and busy_s'event; 
         start_s <= '0';
         
         wait until completed_s = '1' and completed_s'event; 
-        next_z_output := serial_data_out_s;
+        next_z_output := serial_data_out_s(0);
         
         wait for 10 ns;
         
         --Then Load the auth_acc
-        serial_data_in_s <= next_z_output;
+        serial_data_in_s(0) <= next_z_output;
         operation_s <= "011"; -- load_auth_acc
-        serial_data_in_s <= next_z_output;
+        serial_data_in_s(0) <= next_z_output;
         
         start_s <= '1';
         wait until busy_s = '1' and busy_s'event; 
@@ -168,20 +176,20 @@ begin
         -- First generate the next_s value 
         operation_s <= "010"; -- next_z
         grain_round_s <= "01"; -- ADDKEY
-        serial_data_in_s <= key(k);
+        serial_data_in_s(0) <= key(k);
         start_s <= '1';
         wait until busy_s = '1' and busy_s'event; 
         start_s <= '0';
         
         wait until completed_s = '1' and completed_s'event; 
-        next_z_output := serial_data_out_s;
+        next_z_output := serial_data_out_s(0);
         
         wait for 10 ns;
         
         --Then Load the auth_sr
-        serial_data_in_s <= next_z_output;
+        serial_data_in_s(0) <= next_z_output;
         operation_s <= "100"; -- load_auth_sr
-        serial_data_in_s <= next_z_output;
+        serial_data_in_s(0) <= next_z_output;
         
         start_s <= '1';
         wait until busy_s = '1' and busy_s'event; 
@@ -197,13 +205,13 @@ begin
         -- First generate the next_s value 
             operation_s <= "010"; -- next_z
             grain_round_s <= "10"; -- NORMAL
-            serial_data_in_s <= '0';
+            serial_data_in_s(0) <= '0';
             start_s <= '1';
             wait until busy_s = '1' and busy_s'event; 
             start_s <= '0';
             
             wait until completed_s = '1' and completed_s'event; 
-            next_z_output := serial_data_out_s;
+            next_z_output := serial_data_out_s(0);
             --next_z_output_vector(0) := next_z_output;
             --report "k: " & integer'image(k) & " next_z: " & integer'image(to_integer(unsigned(next_z_output_vector)));
             
@@ -225,7 +233,7 @@ begin
                 end if;
                 --Shift in the z_next vvalue in the auth_sr
                 operation_s <= "100"; -- load_sr
-                serial_data_in_s <= next_z_output;
+                serial_data_in_s(0) <= next_z_output;
                 start_s <= '1';
                 wait until busy_s = '1' and busy_s'event; 
                 start_s <= '0';
@@ -245,13 +253,13 @@ begin
         -- First generate the next_s value 
         operation_s <= "010"; -- next_z
         grain_round_s <= "10"; -- NORMAL
-        serial_data_in_s <= '0';
+        serial_data_in_s(0) <= '0';
         start_s <= '1';
         wait until busy_s = '1' and busy_s'event; 
         start_s <= '0';
         
         wait until completed_s = '1' and completed_s'event; 
-        next_z_output := serial_data_out_s;
+        next_z_output := serial_data_out_s(0);
         next_z_output_vector(0) := next_z_output;
         --report "Encrypt: k: " & integer'image(k) & " next_z: " & integer'image(to_integer(unsigned(next_z_output_vector)));
         
@@ -276,7 +284,7 @@ begin
              ac_cnt := ac_cnt + 1;
             --Shift in the z_next vvalue in the auth_sr
             operation_s <= "100"; -- load_sr
-            serial_data_in_s <= next_z_output;
+            serial_data_in_s(0) <= next_z_output;
             start_s <= '1';
             wait until busy_s = '1' and busy_s'event; 
             start_s <= '0';
@@ -293,7 +301,7 @@ begin
     --Generate unused keystream bit next_z
     operation_s <= "010"; -- next_z
     grain_round_s <= "10"; -- NORMAL
-    serial_data_in_s <= '0';
+    serial_data_in_s(0) <= '0';
     start_s <= '1';
     wait until busy_s = '1' and busy_s'event; 
     start_s <= '0';
@@ -32,18 +32,41 @@ package CONSTANTS is
 	constant OPCODE_SIZE : integer := 6;
 	constant MEM_SIZE	 : integer := 64;
 	constant IPADDR_SIZE : integer := 7;
+	constant BANK_WIDTH  : integer := 4;
+	constant NUM_BANKS   : integer := 2**BANK_WIDTH;	-- 64-word pages of the data buffer, stored in the EBR
  	
-	constant NUM_IPS : integer := 1;
+	-- Grain controller+cipher pairs, each one with its own NUM_BANKS banks (2 EBR)
+	constant NUM_IPS : integer := 4;
 		
 	-- TYPES
 	type data_array   is array (NUM_IPS-1 downto 0) of std_logic_vector(DATA_WIDTH-1 downto 0);
 	type addr_array	  is array (NUM_IPS-1 downto 0) of std_logic_vector(ADD_WIDTH-1 downto 0);
 	type opcode_array is array (NUM_IPS-1 downto 0) of std_logic_vector(OPCODE_SIZE-1 downto 0);
+	type bank_array   is array (NUM_IPS-1 downto 0) of std_logic_vector(BANK_WIDTH-1 downto 0);
 	
+	-- GRAIN CORE
+	constant GRAIN_PARALLEL : integer := 32;	-- keystream bits computed by a NEXT_Z of the cipher core: 1, 8, 16 or 32
+		
 	-- CONTROL WORD FIELDS
 	constant I_P_POS    : integer := 9;
 	constant ACK_POS	: integer := 8;	
 	constant B_E_POS    : integer := 7;
 	constant IPADDR_POS : integer := 6; -- downto 0
 	
+	-- BANKED DATA BUFFER
+	-- row 0 and the bank select word are shared by all the banks, every other word is replicated per bank
+	constant BANK_SEL_ADDR    : integer := 62;
+	constant BANK_STATUS_ADDR : integer := 63;
+	-- values of the status word of a bank (handshake between CPU and IP in streaming mode)
+	constant BANK_IDLE  : std_logic_vector(DATA_WIDTH-1 downto 0) := x"0000";
+	constant BANK_READY : std_logic_vector(DATA_WIDTH-1 downto 0) := x"0001";
+	constant BANK_LAST  : std_logic_vector(DATA_WIDTH-1 downto 0) := x"0002";	-- ready, and closing the message: the tag is computed/verified
+	constant BANK_DONE  : std_logic_vector(DATA_WIDTH-1 downto 0) := x"FFFF";
+	constant BANK_FAIL  : std_logic_vector(DATA_WIDTH-1 downto 0) := x"FFFE";	-- done, but the tag of a decryption did not match
+
+	-- PERFORMANCE COUNTERS
+	-- clocks of each phase of a transaction, 32 bits per phase (low word first) from PERF_ADDR, written before its last status word
+	constant PERF_ADDR   : integer := 44;
+	constant PERF_PHASES : integer := 7;	-- key/IV load, INIT, ADDKEY, AD, message, MAC, waiting for the CPU
+	
 end package CONSTANTS;
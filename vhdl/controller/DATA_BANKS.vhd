@@ -0,0 +1,62 @@
+--  ******************************************************************************
+--  * File Name          : DATA_BANKS.vhd
+--  * Description        : True dual port memory holding the banks of the Data Buffer
+--  ******************************************************************************
+--  *
+--  * The description follows the dual port RAM inference template, so that the
+--  * banks are mapped onto the EBR blocks of the MachXO2 instead of the slices.
+--  * Both ports have a synchronous read: the data is available one clock after
+--  * the address.
+--  *
+--  ******************************************************************************
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.CONSTANTS.all;
+
+entity DATA_BANKS is
+	port(
+		clock	: in std_logic;
+		-- PORT A (CPU SIDE)
+		we_a	: in std_logic;
+		addr_a	: in std_logic_vector(BANK_WIDTH+ADD_WIDTH-1 downto 0);
+		din_a	: in std_logic_vector(DATA_WIDTH-1 downto 0);
+		dout_a	: out std_logic_vector(DATA_WIDTH-1 downto 0);
+		-- PORT B (IP MANAGER SIDE)
+		we_b	: in std_logic;
+		addr_b	: in std_logic_vector(BANK_WIDTH+ADD_WIDTH-1 downto 0);
+		din_b	: in std_logic_vector(DATA_WIDTH-1 downto 0);
+		dout_b	: out std_logic_vector(DATA_WIDTH-1 downto 0)
+		);
+end entity DATA_BANKS;
+
+architecture BEHAVIOURAL of DATA_BANKS is
+
+	-- NUM_BANKS x 64 x 16 memory
+	type mem_type is array (0 to NUM_BANKS*MEM_SIZE-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
+	shared variable mem : mem_type := (others => (others => '0'));
+
+begin
+
+	port_a: process(clock)
+	begin
+		if(rising_edge(clock)) then
+			if(we_a = '1') then
+				mem(to_integer(unsigned(addr_a))) := din_a;
+			end if;
+			dout_a <= mem(to_integer(unsigned(addr_a)));
+		end if;
+	end process;
+
+	port_b: process(clock)
+	begin
+		if(rising_edge(clock)) then
+			if(we_b = '1') then
+				mem(to_integer(unsigned(addr_b))) := din_b;
+			end if;
+			dout_b <= mem(to_integer(unsigned(addr_b)));
+		end if;
+	end process;
+
+end architecture BEHAVIOURAL;
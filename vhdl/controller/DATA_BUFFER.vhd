@@ -1,6 +1,7 @@
 --  ******************************************************************************
 --  * File Name          : DATA_BUFFER.vhd
---  * Description        : 64x16bit Data Buffer for the IP Manager architecture
+--  * Description        : Banked 64x16bit Data Buffer (EBR based) for the IP Manager architecture,
+--  *                      with a separate set of banks for each IP core
 --  ******************************************************************************
 --  *
 --  * Copyright ? 2016-present Blu5 Group <https://www.blu5group.com>
@@ -40,12 +41,18 @@ entity DATA_BUFFER is
 		cpu_noe    			: in std_logic;	
 		cpu_nwe    			: in std_logic;		
 		cpu_ne1    			: in std_logic;	
-		-- IP MANAGER INTERFACE
+		-- IP MANAGER INTERFACE (writes only, on the banks seen by the CPU)
 		ipm_data_in	  		: in std_logic_vector(DATA_WIDTH-1 downto 0);
-		ipm_data_out		: out std_logic_vector(DATA_WIDTH-1 downto 0);
 		ipm_addr     		: in std_logic_vector(ADD_WIDTH-1 downto 0);
 		ipm_rw 				: in std_logic;
 		ipm_enable  		: in std_logic;
+		-- IP INTERFACE (every IP works on its own banks, concurrently with the others)
+		ip_data_in	  		: in data_array;
+		ip_data_out			: out data_array;
+		ip_addr     		: in addr_array;
+		ip_bank     		: in bank_array;
+		ip_rw 				: in std_logic_vector(NUM_IPS-1 downto 0);
+		ip_enable  			: in std_logic_vector(NUM_IPS-1 downto 0);
 		cpu_read_completed 	: out std_logic;
 		cpu_write_completed : out std_logic
 		);
@@ -53,9 +60,17 @@ end entity DATA_BUFFER;
 
 architecture BEHAVIOURAL of DATA_BUFFER is
 
-	-- 64 x 16 buffer
-	type mem_type is array (0 to MEM_SIZE-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
-	signal mem : mem_type := (others => (others => '0'));
+	-- Row 0 and the bank select word are common to all the banks and are kept in registers,
+	-- the other words of the NUM_BANKS x 64 x 16 buffer of each IP are stored in the EBR (see DATA_BANKS).
+	-- The CPU sees the banks of the IP addressed by row 0.
+	signal row_0_reg	: std_logic_vector(DATA_WIDTH-1 downto 0);
+	signal bank_sel_reg	: std_logic_vector(DATA_WIDTH-1 downto 0);
+
+	-- true if the address refers to one of the common words
+	function is_common(addr : std_logic_vector(ADD_WIDTH-1 downto 0)) return boolean is
+	begin
+		return to_integer(unsigned(addr)) = 0 or to_integer(unsigned(addr)) = BANK_SEL_ADDR;
+	end is_common;
 
 	-- STATES OF THE FSM OF THE BUFFER
 	type data_buffer_state_type is (IDLE, WAIT_ADDSET, MEMORY_OPERATION, WAIT_DATAST_WR, WAIT_DATAST_RD);
@@ -67,20 +82,91 @@ architecture BEHAVIOURAL of DATA_BUFFER is
 	--  INTERNAL SIGNAL TO TEMPORARY STORE THE ADDRESS COMING FROM THE CPU
 	signal address : std_logic_vector(ADD_WIDTH-1 downto 0);
 
+	--  BANK SEEN BY THE CPU, held in the common bank select word, and IP owning it
+	signal cpu_bank : std_logic_vector(BANK_WIDTH-1 downto 0);
+	signal cpu_ip	: integer range 0 to NUM_IPS-1;
+
+	--  PORTS OF THE BANKS: port A is shared by the CPU and the IP manager, port B belongs to the IP
+	signal cpu_we		: std_logic;
+	signal ipm_we		: std_logic;
+	signal cpu_we_ip	: std_logic_vector(NUM_IPS-1 downto 0);
+	signal cpu_ram_addr	: std_logic_vector(BANK_WIDTH+ADD_WIDTH-1 downto 0);
+	signal cpu_ram_din	: std_logic_vector(DATA_WIDTH-1 downto 0);
+	signal cpu_ram_q	: data_array;
+	signal ip_we		: std_logic_vector(NUM_IPS-1 downto 0);
+	signal ip_ram_q		: data_array;
+	signal ip_common	: data_array;
+	signal ip_read		: std_logic_vector(NUM_IPS-1 downto 0);
+	signal ip_is_common	: std_logic_vector(NUM_IPS-1 downto 0);
+
 begin
 
+	ip_banks: for i in 0 to NUM_IPS-1 generate
+		banks: entity work.DATA_BANKS
+			port map(
+				clock  => clock,
+				we_a   => cpu_we_ip(i),
+				addr_a => cpu_ram_addr,
+				din_a  => cpu_ram_din,
+				dout_a => cpu_ram_q(i),
+				we_b   => ip_we(i),
+				addr_b => ip_bank(i) & ip_addr(i),
+				din_b  => ip_data_in(i),
+				dout_b => ip_ram_q(i)
+			);
+
+		cpu_we_ip(i) <= (cpu_we or ipm_we) when cpu_ip = i else '0';
+		ip_we(i) <= '1' when (ip_enable(i) = '1' and ip_rw(i) = '1' and not is_common(ip_addr(i))) else '0';
+		-- READING ASSIGNMENTS: the IPs get the word one clock after the address, as from the EBR
+		ip_data_out(i) <= (others => 'Z') when ip_read(i) = '0' else
+						  ip_common(i) when ip_is_common(i) = '1' else
+						  ip_ram_q(i);
+	end generate;
+
+	-- the CPU keeps the address stable for the whole access: the banks are read with it
+	-- during WAIT_ADDSET, so that the word is ready in MEMORY_OPERATION.
+	-- The rare writes of the IP manager (error signaling) take the port for a clock.
+	cpu_ram_addr <= cpu_bank & ipm_addr when ipm_we = '1' else
+					cpu_bank & address when data_buffer_state = WAIT_DATAST_WR else
+					cpu_bank & cpu_addr;
+	cpu_ram_din	 <= ipm_data_in when ipm_we = '1' else cpu_data;
+	cpu_we		 <= '1' when (data_buffer_state = WAIT_DATAST_WR and cnt >= DATAST-1 and cpu_ne1 = '1' and not is_common(address)) else '0';
+	ipm_we		 <= '1' when (ipm_enable = '1' and ipm_rw = '1' and not is_common(ipm_addr)) else '0';
+
 	process(clock) 
 	begin
 		if(reset = '1') then
-			mem 			  <= (others => (others => '0'));
+			row_0_reg		  <= (others => '0');
+			bank_sel_reg	  <= (others => '0');
 			data_buffer_state <= IDLE;
 			cnt				  <= 0;
 			address			  <= (others => '0');
+			ip_common		  <= (others => (others => '0'));
+			ip_read			  <= (others => '0');
+			ip_is_common	  <= (others => '0');
 		elsif(rising_edge(clock)) then
-			-- possible writing from any IP
+			-- possible writing from the IP manager (the IPs do not write the common words)
 			if (ipm_enable = '1' and ipm_rw = '1') then
-				mem(to_integer(unsigned(ipm_addr))) <= ipm_data_in;
+				if(to_integer(unsigned(ipm_addr)) = 0) then
+					row_0_reg <= ipm_data_in;
+				elsif(to_integer(unsigned(ipm_addr)) = BANK_SEL_ADDR) then
+					bank_sel_reg <= ipm_data_in;
+				end if;
 			end if;
+			-- reading of the IPs, aligned with the synchronous read of the banks
+			for i in 0 to NUM_IPS-1 loop
+				ip_read(i) <= ip_enable(i) and not ip_rw(i);
+				if(is_common(ip_addr(i))) then
+					ip_is_common(i) <= '1';
+				else
+					ip_is_common(i) <= '0';
+				end if;
+				if(to_integer(unsigned(ip_addr(i))) = 0) then
+					ip_common(i) <= row_0_reg;
+				else
+					ip_common(i) <= bank_sel_reg;
+				end if;
+			end loop;
 			-- FSM behavior
 			case(data_buffer_state) is
 			
@@ -106,16 +192,27 @@ begin
 					if(cpu_nwe = '0') then
 						data_buffer_state <= WAIT_DATAST_WR;
 					else
-						cpu_data          <= mem(to_integer(unsigned(address)));
+						if(to_integer(unsigned(address)) = 0) then
+							cpu_data <= row_0_reg;
+						elsif(to_integer(unsigned(address)) = BANK_SEL_ADDR) then
+							cpu_data <= bank_sel_reg;
+						else
+							cpu_data <= cpu_ram_q(cpu_ip);
+						end if;
 						data_buffer_state <= WAIT_DATAST_RD;
 					end if;
 
 				when WAIT_DATAST_WR =>
 					if(cnt >= DATAST-1 and cpu_ne1 = '1') then
-						cnt 	    	  				   <= 0;
-						mem(to_integer(unsigned(address))) <= cpu_data;
-						cpu_write_completed				   <= '1';
-						data_buffer_state 				   <= IDLE;
+						cnt 	    	  	<= 0;
+						-- the banked words are written by the port A of DATA_BANKS (see cpu_we)
+						if(to_integer(unsigned(address)) = 0) then
+							row_0_reg <= cpu_data;
+						elsif(to_integer(unsigned(address)) = BANK_SEL_ADDR) then
+							bank_sel_reg <= cpu_data;
+						end if;
+						cpu_write_completed <= '1';
+						data_buffer_state 	<= IDLE;
 					else
 						cnt 			  <= cnt + 1;
 						data_buffer_state <= WAIT_DATAST_WR;
@@ -136,8 +233,11 @@ begin
 	end process; 
 
 	-- row_0 is always assigned to the first word of the buffer  
-	row_0 	 	 <= mem(0);
-	-- READING ASSIGNMENTS
-	ipm_data_out <= mem(to_integer(unsigned(ipm_addr))) when (ipm_enable = '1' and ipm_rw = '0') else (others => 'Z');
+	row_0 	 	 <= row_0_reg;
+	-- the CPU selects its bank writing the bank select word, and the IP writing row 0
+	cpu_bank	 <= bank_sel_reg(BANK_WIDTH-1 downto 0);
+	cpu_ip		 <= to_integer(unsigned(row_0_reg(IPADDR_POS downto 0))) - 1
+					when to_integer(unsigned(row_0_reg(IPADDR_POS downto 0))) > 0 and to_integer(unsigned(row_0_reg(IPADDR_POS downto 0))) <= NUM_IPS
+					else 0;
 
 end architecture BEHAVIOURAL;
\ No newline at end of file
@@ -31,9 +31,8 @@ entity IP_MANAGER is
             reset          			: in std_logic;
             ne1						: in std_logic;
             interrupt       		: out std_logic;
-            -- BUFFER INTERFACE		
+            -- BUFFER INTERFACE (the IPs access their own banks directly, see DATA_BUFFER)
             buf_data_out    		: out std_logic_vector(DATA_WIDTH-1 downto 0);
-            buf_data_in     		: in std_logic_vector(DATA_WIDTH-1 downto 0);            
             buf_addr        		: out std_logic_vector(ADD_WIDTH-1 downto 0);
             buf_rw          		: out std_logic;
             buf_enable      		: out std_logic;
@@ -41,13 +40,8 @@ entity IP_MANAGER is
             cpu_read_completed  	: in std_logic; 
             cpu_write_completed 	: in std_logic; 
             -- IP INTERFACE
-            addr_ip         	   : in addr_array;
-            data_in_ip      	   : in data_array; 
-            data_out_ip     	   : out data_array;                                         
             opcode_ip			   : out opcode_array;
             int_pol_ip			   : out std_logic_vector(NUM_IPS-1 downto 0);
-            rw_ip		    	   : in std_logic_vector(NUM_IPS-1 downto 0);    
-            buf_enable_ip   	   : in std_logic_vector(NUM_IPS-1 downto 0);    
             enable_ip      		   : out std_logic_vector(NUM_IPS-1 downto 0);
             ack_ip 	        	   : out std_logic_vector(NUM_IPS-1 downto 0);    
             interrupt_ip 		   : in std_logic_vector(NUM_IPS-1 downto 0);
@@ -68,10 +62,11 @@ architecture BEHAVIOURAL of IP_MANAGER is
 	);
 	signal state : ip_manager_state_type;
 	
-	-- INTERNAL REGISTER OF THE ACTIVE IP (0 IF THE MANAGER ITSELF)
+	-- INTERNAL REGISTER OF THE ACTIVE IP, the one the CPU is talking to (0 IF THE MANAGER ITSELF)
+	-- the other enabled IPs keep on working on their own banks until their transaction is closed
 	signal active_ip : integer; 	
 	
-	-- OUTPUTS TO BUFFER when controlled directly by the manager (see assignment out of the process)
+	-- OUTPUTS TO BUFFER, controlled by the manager only (see assignment out of the process)
 	signal buf_data_out_man : std_logic_vector(DATA_WIDTH-1 downto 0);
     signal buf_addr_man     : std_logic_vector(ADD_WIDTH-1 downto 0);
 	signal buf_rw_man       : std_logic;
@@ -140,14 +135,12 @@ begin
 						--		accepting the CPU request of open transaction
 						-- elsif statement was used to mutually exclude cases
 						-- when none of these cases, remains in IDLE state
-						-- IDLE state is characterized by the fact that all is in a "quiescent state": no valid values for any signal
+						-- IDLE state is characterized by the fact that all is in a "quiescent state": no valid values for any signal,
+						-- except for the IPs left working by the CPU (enable_ip, opcode_ip and int_pol_ip are kept)
 						buf_data_out_man 		<= (others => '0');
 						buf_addr_man     		<= (others => '0');
 						buf_enable_man   		<= '0';				
 						buf_rw_man       		<= '0';                    
-						opcode_ip		 		<= (others => (others => '0'));
-						int_pol_ip		 		<= (others => '0');
-						enable_ip 		 		<= (others => '0');  
 						ack_ip 	         		<= (others => '0');
 						active_ip        		<= 0;
 						state			 		<= IDLE; 
@@ -244,12 +237,15 @@ begin
 						-- and no transactions are currently active and no interrupt requests are served, then it can be opened
 						elsif(row_0(B_E_POS) = '1' and row_0(ACK_POS) = '0' and active_ip = 0) then
 							-- if the address is referred to an existing IP core, then enable that IP
+							-- (if it is already enabled, the CPU is just coming back to it)
 							ipaddress := to_integer(unsigned(row_0(IPADDR_POS downto 0)));
 							if(ipaddress > 0 and ipaddress <= NUM_IPS) then
-								enable_ip(ipaddress-1)  <= '1';
+								if(enable_ip(ipaddress-1) = '0') then
+									enable_ip(ipaddress-1)  <= '1';
+									opcode_ip(ipaddress-1)  <= row_0(DATA_WIDTH-1 downto DATA_WIDTH-6);
+									int_pol_ip(ipaddress-1) <= row_0(I_P_POS);
+								end if;
 								active_ip 			    <= ipaddress;
-								opcode_ip(ipaddress-1)  <= row_0(DATA_WIDTH-1 downto DATA_WIDTH-6);
-								int_pol_ip(ipaddress-1) <= row_0(I_P_POS);
 								state					<= MULTIPLEXING;
 							-- else, address is out of range so do nothing
 							else null; 	
@@ -268,9 +264,15 @@ begin
 							buf_addr_man     <= (others => '0');
 							buf_enable_man   <= '0';				
 							buf_rw_man       <= '0';                       
-							opcode_ip		 <= (others => (others => '0'));
-							int_pol_ip		 <= (others => '0');
-							enable_ip 		 <= (others => '0');  
+							opcode_ip(active_ip-1)  <= (others => '0');
+							int_pol_ip(active_ip-1) <= '0';
+							enable_ip(active_ip-1)  <= '0';
+							ack_ip 	         <= (others => '0');
+							state 			 <= IDLE;
+						elsif(to_integer(unsigned(row_0(IPADDR_POS downto 0))) /= active_ip) then
+							-- the CPU has moved to another IP without closing this transaction:
+							-- the IP keeps on working, the new one is served from IDLE
+							active_ip		 <= 0;
 							ack_ip 	         <= (others => '0');
 							state 			 <= IDLE;
 						else
@@ -316,19 +318,18 @@ begin
 		end if;
 	end process;
 	
-	-- MULTIPLEXING INTERFACE BETWEEN IP AND BUFFER (DEPENDING ON active_ip VALUE) 
-	buf_data_out <= data_in_ip(active_ip-1)    when active_ip > 0 else buf_data_out_man;
-	buf_addr 	 <= addr_ip(active_ip-1) 	   when active_ip > 0 else buf_addr_man;
-	buf_rw 		 <= rw_ip(active_ip-1) 		   when active_ip > 0 else buf_rw_man;
-	buf_enable 	 <= buf_enable_ip(active_ip-1) when active_ip > 0 else buf_enable_man;
+	-- INTERFACE BETWEEN MANAGER AND BUFFER
+	buf_data_out <= buf_data_out_man;
+	buf_addr 	 <= buf_addr_man;
+	buf_rw 		 <= buf_rw_man;
+	buf_enable 	 <= buf_enable_man;
 
-	process(active_ip, buf_data_in, cpu_read_completed, cpu_write_completed)
+	-- the accesses of the CPU are notified to the active IP only
+	process(active_ip, cpu_read_completed, cpu_write_completed)
 	begin
-		data_out_ip 	       <= (others => (others => '0'));
 		cpu_read_completed_ip  <= (others => '0');
 		cpu_write_completed_ip <= (others => '0');
 		if(active_ip > 0) then
-			data_out_ip(active_ip-1) 		    <= buf_data_in;
 			cpu_read_completed_ip(active_ip-1)  <= cpu_read_completed; 
 			cpu_write_completed_ip(active_ip-1) <= cpu_write_completed; 
 		end if;
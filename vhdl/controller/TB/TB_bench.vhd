@@ -0,0 +1,316 @@
+----------------------------------------------------------------------------------
+-- Module Name: TB_bench
+-- Project Name: Lightweight cipher
+-- Additional Comments: Cycle-count benchmark of the controller: a matrix of message
+--                      and AD lengths, encrypted and then decrypted through TOP_ENTITY
+--                      the way the driver does it (a single packet up to 24 bytes,
+--                      the ring of banks of a streaming transaction above). The clocks
+--                      from the first write of the status word (0x3F) to the completion
+--                      of the last packet go to RESULTS, a CSV file
+----------------------------------------------------------------------------------
+--  Columns of RESULTS:
+--    decrypt, ad_bytes, msg_bytes, packets,
+--    clocks      FPGA clocks from the first write of the status word to the end of the last packet
+--    total       FPGA clocks from the control word opening the transaction to the same point
+--    clocks_per_byte, status (of the last packet)
+--  A decryption takes the ciphertext and the tag of the encryption before it: its MAC matches.
+----------------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use std.textio.all;
+use work.CONSTANTS.all;
+use work.TB_FMC.all;
+
+entity TB_bench is
+	generic (
+		RESULTS : string := "bench.csv"
+	);
+end TB_bench;
+
+architecture test of TB_bench is
+
+	type length_array is array (natural range <>) of natural;
+	constant MSG_LENGTHS : length_array := (0, 16, 24, 64, 128, 256, 512, 1024, 1500);
+	constant AD_LENGTHS  : length_array := (0, 4, 9, 20);
+
+	-- ADDRESSES OF THE PACKETS
+	constant ADDR_KEY       : integer := 1;
+	constant ADDR_IV        : integer := 9;
+	constant ADDR_LENGTH    : integer := 17;
+	constant ADDR_AD        : integer := 18;
+	constant ADDR_MSG       : integer := 28;
+	constant ADDR_NEXT_LEN  : integer := 1;
+	constant ADDR_NEXT_MSG  : integer := 2;
+	constant ADDR_MAC       : integer := 40;
+	constant PACKET_BYTES   : integer := 24;	-- message bytes of a packet
+	constant MAX_MSG_WORDS  : integer := 750;
+
+	type word_array is array (natural range <>) of std_logic_vector(DATA_WIDTH-1 downto 0);
+
+	-- FPGA INTERFACE SIGNALS
+	signal fpga_clk  : std_logic := '0';
+	signal reset     : std_logic := '0';
+	signal data      : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => 'Z');
+	signal address   : std_logic_vector(ADD_WIDTH-1 downto 0)  := (others => 'Z');
+	signal noe		 : std_logic := '0';
+	signal nwe		 : std_logic := '1';
+	signal ne1		 : std_logic := '1';
+	signal interrupt : std_logic;
+
+	signal clocks    : natural := 0;	-- FPGA clocks since the start of the simulation
+
+begin
+
+	UUT: entity work.TOP_ENTITY
+		generic map(
+			ADDSET => ADDRESS_SETUP_TIME/PRESCALER,
+			DATAST => DATA_SETUP_TIME/PRESCALER
+		)
+		port map(
+			cpu_fpga_bus_a   => address,
+			cpu_fpga_bus_d   => data,
+			cpu_fpga_bus_noe => noe,
+			cpu_fpga_bus_nwe => nwe,
+			cpu_fpga_bus_ne1 => ne1,
+			cpu_fpga_clk     => fpga_clk,
+			cpu_fpga_int_n   => interrupt,
+			cpu_fpga_rst     => reset
+		);
+
+	fpga_osc : process
+	begin
+		fpga_clk <= '1';
+		wait for FPGA_CLK_PERIOD/2;
+		fpga_clk <= '0';
+		wait for FPGA_CLK_PERIOD/2;
+	end process;
+
+	clock_count : process (fpga_clk)
+	begin
+		if(rising_edge(fpga_clk)) then
+			clocks <= clocks + 1;
+		end if;
+	end process;
+
+	reset <= '0', '1' after HCLK_PERIOD*2*PRESCALER, '0' after HCLK_PERIOD*4*PRESCALER;
+
+	stimuli: process
+		file res_file : text open write_mode is RESULTS;
+		variable res : line;
+		variable result : std_logic_vector(DATA_WIDTH-1 downto 0);
+		variable opcode : std_logic_vector(OPCODE_SIZE-1 downto 0);
+		variable msg, ct : word_array(0 to MAX_MSG_WORDS-1);	-- message of the encryption, its ciphertext
+		variable tag : word_array(0 to 3);
+		variable pending : length_array(0 to NUM_BANKS-1);		-- message bytes of the packet of each bank
+		variable ad_bytes, msg_bytes, packets, sent, collected, bank, start, opened : natural;
+		variable measured, total : natural;		-- clocks of the last run, from the status word and from the opening
+		variable status : std_logic_vector(DATA_WIDTH-1 downto 0);
+		variable last, timing : boolean;
+
+		procedure write_word(w_addr : in integer; w_data : in std_logic_vector(DATA_WIDTH-1 downto 0)) is
+		begin
+			fmc_write(ne1, noe, nwe, address, data, w_addr, w_data);
+		end write_word;
+
+		procedure read_word(r_addr : in integer) is
+		begin
+			fmc_read(ne1, noe, nwe, address, data, r_addr, result);
+		end read_word;
+
+		-- the first write of the status word starts the count
+		procedure write_status(w_data : in std_logic_vector(DATA_WIDTH-1 downto 0)) is
+		begin
+			if(not timing) then
+				start := clocks;
+				timing := true;
+			end if;
+			write_word(BANK_STATUS_ADDR, w_data);
+		end write_status;
+
+		-- packet p of the message in the selected bank, followed by the MAC if decrypting its last packet
+		procedure write_packet(p : in natural; decrypt : in boolean) is
+			variable first_word, words, msg_addr : natural;
+		begin
+			first_word := p*PACKET_BYTES/2;
+			words := pending(p mod NUM_BANKS)/2;
+			if(p = 0) then
+				for i in 0 to 7 loop
+					write_word(ADDR_KEY + i, std_logic_vector(to_unsigned(16#0F00# + 16#1111#*i, DATA_WIDTH)));
+				end loop;
+				for i in 0 to 5 loop
+					write_word(ADDR_IV + i, std_logic_vector(to_unsigned(16#A050# + 16#0203#*i, DATA_WIDTH)));
+				end loop;
+				write_word(ADDR_LENGTH, std_logic_vector(to_unsigned(pending(0), 8)) & std_logic_vector(to_unsigned(ad_bytes, 8)));
+				for i in 0 to (ad_bytes+1)/2 - 1 loop
+					write_word(ADDR_AD + i, std_logic_vector(to_unsigned(16#5A00# + i, DATA_WIDTH)));
+				end loop;
+				msg_addr := ADDR_MSG;
+			else
+				write_word(ADDR_NEXT_LEN, std_logic_vector(to_unsigned(pending(p mod NUM_BANKS), 8)) & x"00");
+				msg_addr := ADDR_NEXT_MSG;
+			end if;
+			for i in 0 to words-1 loop
+				if(decrypt) then
+					write_word(msg_addr + i, ct(first_word + i));
+				else
+					write_word(msg_addr + i, msg(first_word + i));
+				end if;
+			end loop;
+			if(decrypt and p = packets-1) then
+				for i in 0 to 3 loop
+					write_word(msg_addr + words + i, tag(i));
+				end loop;
+			end if;
+		end write_packet;
+
+		-- output of packet p back from the selected bank, and the tag after the last one
+		procedure read_packet(p : in natural; decrypt : in boolean) is
+			variable first_word, msg_addr : natural;
+		begin
+			first_word := p*PACKET_BYTES/2;
+			if(p = 0) then
+				msg_addr := ADDR_MSG;
+			else
+				msg_addr := ADDR_NEXT_MSG;
+			end if;
+			for i in 0 to pending(p mod NUM_BANKS)/2 - 1 loop
+				read_word(msg_addr + i);
+				if(not decrypt) then
+					ct(first_word + i) := result;
+				end if;
+			end loop;
+			if(p = packets-1) then
+				for i in 0 to 3 loop
+					read_word(ADDR_MAC + i);
+					if(not decrypt) then
+						tag(i) := result;
+					end if;
+				end loop;
+			end if;
+		end read_packet;
+
+		procedure run(decrypt : in boolean) is
+		begin
+			timing := false;
+			packets := (msg_bytes + PACKET_BYTES - 1)/PACKET_BYTES;
+			if(packets = 0) then
+				packets := 1;
+			end if;
+
+			opened := clocks;
+			if(packets = 1) then
+				-- single packet, read by the controller while it is being written
+				if(decrypt) then
+					opcode := OPCODE_INIT_DECRYPT or OPCODE_NATURAL_ORDER;
+				else
+					opcode := OPCODE_INIT_ENCRYPT or OPCODE_NATURAL_ORDER;
+				end if;
+				write_word(0, opcode & CONF_OPEN_TRANSACTION_POLMODE & CORE_1);
+				pending(0) := msg_bytes;
+				write_packet(0, decrypt);
+				write_status(BANK_IDLE);
+				read_word(BANK_STATUS_ADDR);
+				while result /= BANK_DONE and result /= BANK_FAIL loop
+					read_word(BANK_STATUS_ADDR);
+				end loop;
+				status := result;
+				measured := clocks - start;
+				total := clocks - opened;
+				read_packet(0, decrypt);
+				write_word(BANK_STATUS_ADDR, BANK_IDLE);
+			else
+				-- streaming: the packets go round the ring of banks, the oldest one is collected
+				-- as soon as the core is done with it and its bank filled again
+				if(decrypt) then
+					opcode := OPCODE_STREAM_DECRYPT or OPCODE_NATURAL_ORDER;
+				else
+					opcode := OPCODE_STREAM_ENCRYPT or OPCODE_NATURAL_ORDER;
+				end if;
+				write_word(0, opcode & CONF_OPEN_TRANSACTION_POLMODE & CORE_1);
+				sent := 0;
+				collected := 0;
+				while collected < packets loop
+					if(collected < sent) then
+						bank := collected mod NUM_BANKS;
+						write_word(BANK_SEL_ADDR, std_logic_vector(to_unsigned(bank, DATA_WIDTH)));
+						read_word(BANK_STATUS_ADDR);
+						if(result = BANK_DONE or result = BANK_FAIL) then
+							status := result;
+							if(collected = packets-1) then
+								measured := clocks - start;
+								total := clocks - opened;
+							end if;
+							read_packet(collected, decrypt);
+							collected := collected + 1;
+						end if;
+					end if;
+					if(sent < packets and sent - collected < NUM_BANKS) then
+						bank := sent mod NUM_BANKS;
+						last := (sent = packets-1);
+						pending(bank) := msg_bytes - sent*PACKET_BYTES;
+						if(pending(bank) > PACKET_BYTES) then
+							pending(bank) := PACKET_BYTES;
+						end if;
+						write_word(BANK_SEL_ADDR, std_logic_vector(to_unsigned(bank, DATA_WIDTH)));
+						write_packet(sent, decrypt);
+						if(last) then
+							write_status(BANK_LAST);
+						else
+							write_status(BANK_READY);
+						end if;
+						sent := sent + 1;
+					end if;
+				end loop;
+				-- every used bank idle, the CPU back on the first one
+				for b in NUM_BANKS-1 downto 0 loop
+					if(b < packets) then
+						write_word(BANK_SEL_ADDR, std_logic_vector(to_unsigned(b, DATA_WIDTH)));
+						write_word(BANK_STATUS_ADDR, BANK_IDLE);
+					end if;
+				end loop;
+			end if;
+			write_word(0, OPCODE_VOID & CONF_CLOSE_TRANSACTION_POLMODE & CORE_1);
+		end run;
+
+	begin
+
+		for i in 0 to MAX_MSG_WORDS-1 loop
+			msg(i) := std_logic_vector(to_unsigned((16#3D07# * i + 16#0101#) mod 2**DATA_WIDTH, DATA_WIDTH));
+		end loop;
+
+		wait until reset = '1';
+		wait until reset = '0';
+		wait for HCLK_PERIOD*24;
+
+		write(res, string'("decrypt,ad_bytes,msg_bytes,packets,clocks,total,clocks_per_byte,status"));
+		writeline(res_file, res);
+
+		for a in AD_LENGTHS'range loop
+			for m in MSG_LENGTHS'range loop
+				ad_bytes := AD_LENGTHS(a);
+				msg_bytes := MSG_LENGTHS(m);
+				for decrypt in 0 to 1 loop
+					run(decrypt = 1);
+					write(res, integer'image(decrypt) & "," & integer'image(ad_bytes) & "," & integer'image(msg_bytes) & "," &
+					           integer'image(packets) & "," & integer'image(measured) & "," & integer'image(total));
+					if(msg_bytes > 0) then
+						write(res, "," & to_string(real(measured)/real(msg_bytes), 2));
+					else
+						write(res, string'(","));
+					end if;
+					write(res, "," & to_hstring(status));
+					writeline(res_file, res);
+					if(status /= BANK_DONE) then
+						report "decrypt " & integer'image(decrypt) & ", AD " & integer'image(ad_bytes) & " bytes, message " &
+						       integer'image(msg_bytes) & " bytes: status " & to_hstring(status) severity error;
+					end if;
+				end loop;
+			end loop;
+		end loop;
+
+		std.env.finish;
+	end process stimuli;
+
+end test;
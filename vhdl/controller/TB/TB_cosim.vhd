@@ -0,0 +1,242 @@
+----------------------------------------------------------------------------------
+-- Module Name: TB_cosim
+-- Project Name: Lightweight cipher
+-- Additional Comments: Self-checking co-simulation against the C reference model
+--                      (vhdl/sim/gen_vectors.c): each line of VECTORS is a single-packet
+--                      transaction, run through TOP_ENTITY by the CPU side of the FMC
+--                      bus. Output words, tag and status are compared with the model;
+--                      the clocks of each vector and the performance counters of the
+--                      controller go to RESULTS, a CSV file. With INTERRUPT_MODE the CPU
+--                      closes each transaction once the packet is written and waits for
+--                      the interrupt of the core instead of polling the status word
+----------------------------------------------------------------------------------
+--  Line of VECTORS (integers in decimal, words in hex, packet words in memory order):
+--    decrypt status ad_bytes msg_bytes  key(8) iv(6) ad((ad_bytes+1)/2) in((msg_bytes+1)/2)
+--    [mac(4) if decrypt]  out((msg_bytes+1)/2) tag(4)
+----------------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use std.textio.all;
+use work.CONSTANTS.all;
+use work.TB_FMC.all;
+
+entity TB_cosim is
+	generic (
+		VECTORS : string := "vectors.txt";
+		RESULTS : string := "cosim.csv";
+		INTERRUPT_MODE : boolean := false
+	);
+end TB_cosim;
+
+architecture test of TB_cosim is
+
+	-- ADDRESSES OF AN INIT PACKET
+	constant ADDR_KEY     : integer := 1;
+	constant ADDR_IV      : integer := 9;
+	constant ADDR_LENGTH  : integer := 17;
+	constant ADDR_AD      : integer := 18;
+	constant ADDR_MSG     : integer := 28;
+	constant ADDR_MAC     : integer := 40;
+
+	-- FPGA INTERFACE SIGNALS
+	signal fpga_clk  : std_logic := '0';
+	signal reset     : std_logic := '0';
+	signal data      : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => 'Z');
+	signal address   : std_logic_vector(ADD_WIDTH-1 downto 0)  := (others => 'Z');
+	signal noe		 : std_logic := '0';
+	signal nwe		 : std_logic := '1';
+	signal ne1		 : std_logic := '1';
+	signal interrupt : std_logic;
+
+	signal clocks    : natural := 0;	-- FPGA clocks since the start of the simulation
+
+begin
+
+	UUT: entity work.TOP_ENTITY
+		generic map(
+			ADDSET => ADDRESS_SETUP_TIME/PRESCALER,
+			DATAST => DATA_SETUP_TIME/PRESCALER
+		)
+		port map(
+			cpu_fpga_bus_a   => address,
+			cpu_fpga_bus_d   => data,
+			cpu_fpga_bus_noe => noe,
+			cpu_fpga_bus_nwe => nwe,
+			cpu_fpga_bus_ne1 => ne1,
+			cpu_fpga_clk     => fpga_clk,
+			cpu_fpga_int_n   => interrupt,
+			cpu_fpga_rst     => reset
+		);
+
+	fpga_osc : process
+	begin
+		fpga_clk <= '1';
+		wait for FPGA_CLK_PERIOD/2;
+		fpga_clk <= '0';
+		wait for FPGA_CLK_PERIOD/2;
+	end process;
+
+	clock_count : process (fpga_clk)
+	begin
+		if(rising_edge(fpga_clk)) then
+			clocks <= clocks + 1;
+		end if;
+	end process;
+
+	reset <= '0', '1' after HCLK_PERIOD*2*PRESCALER, '0' after HCLK_PERIOD*4*PRESCALER;
+
+	stimuli: process
+		file vec_file : text open read_mode is VECTORS;
+		file res_file : text open write_mode is RESULTS;
+		variable vec, res : line;
+		variable decrypt, ad_bytes, msg_bytes : integer;
+		variable word, result, status : std_logic_vector(DATA_WIDTH-1 downto 0);
+		variable opcode : std_logic_vector(OPCODE_SIZE-1 downto 0);
+		variable conf : std_logic_vector(2 downto 0);
+		variable perf_low : std_logic_vector(DATA_WIDTH-1 downto 0);
+		variable start, vector, failures : natural := 0;
+		variable ok : boolean;
+
+		procedure write_word(w_addr : in integer; w_data : in std_logic_vector(DATA_WIDTH-1 downto 0)) is
+		begin
+			fmc_write(ne1, noe, nwe, address, data, w_addr, w_data);
+		end write_word;
+
+		procedure read_word(r_addr : in integer) is
+		begin
+			fmc_read(ne1, noe, nwe, address, data, r_addr, result);
+		end read_word;
+
+		-- next word of the vector to the data buffer
+		procedure upload(w_addr : in integer) is
+		begin
+			hread(vec, word);
+			write_word(w_addr, word);
+		end upload;
+
+		-- word of the data buffer against the next word of the vector
+		procedure check(r_addr : in integer; what : in string) is
+		begin
+			hread(vec, word);
+			read_word(r_addr);
+			if(result /= word) then
+				report "vector " & integer'image(vector) & ": " & what & " word " & integer'image(r_addr) &
+				       " is " & to_hstring(result) & ", expected " & to_hstring(word) severity error;
+				ok := false;
+			end if;
+		end check;
+
+	begin
+
+		wait until reset = '1';
+		wait until reset = '0';
+		wait for HCLK_PERIOD*24;
+
+		write(res, string'("vector,decrypt,ad_bytes,msg_bytes,clocks,load,init,addkey,ad,msg,mac,idle,result"));
+		writeline(res_file, res);
+
+		while not endfile(vec_file) loop
+			readline(vec_file, vec);
+			next when vec'length = 0;
+			read(vec, decrypt);
+			hread(vec, status);
+			read(vec, ad_bytes);
+			read(vec, msg_bytes);
+			ok := true;
+
+			if(decrypt = 1) then
+				opcode := OPCODE_INIT_DECRYPT or OPCODE_NATURAL_ORDER;
+			else
+				opcode := OPCODE_INIT_ENCRYPT or OPCODE_NATURAL_ORDER;
+			end if;
+			if(INTERRUPT_MODE) then
+				conf := CONF_OPEN_TRANSACTION_INTMODE;
+			else
+				conf := CONF_OPEN_TRANSACTION_POLMODE;
+			end if;
+			start := clocks;
+			write_word(0, opcode & conf & CORE_1);
+
+			for i in 0 to 7 loop
+				upload(ADDR_KEY + i);
+			end loop;
+			for i in 0 to 5 loop
+				upload(ADDR_IV + i);
+			end loop;
+			write_word(ADDR_LENGTH, std_logic_vector(to_unsigned(msg_bytes, 8)) & std_logic_vector(to_unsigned(ad_bytes, 8)));
+			for i in 0 to (ad_bytes+1)/2 - 1 loop
+				upload(ADDR_AD + i);
+			end loop;
+			for i in 0 to (msg_bytes+1)/2 - 1 loop
+				upload(ADDR_MSG + i);
+			end loop;
+			if(decrypt = 1) then
+				for i in 0 to 3 loop
+					upload(ADDR_MSG + (msg_bytes+1)/2 + i);
+				end loop;
+			end if;
+
+			if(INTERRUPT_MODE) then
+				--Interrupt: the IP manager writes the ID of the core in row 0, the CPU acknowledges it
+				write_word(0, OPCODE_VOID & CONF_CLOSE_TRANSACTION_POLMODE & CORE_1);
+				if(interrupt /= '1') then
+					wait until interrupt = '1';
+				end if;
+				read_word(0);
+				if(result /= "000000000" & CORE_1) then
+					report "vector " & integer'image(vector) & ": interrupt of " & to_hstring(result) severity error;
+					ok := false;
+				end if;
+				write_word(0, OPCODE_VOID & CONF_ACK_TRANSACTION_INTMODE & CORE_1);
+				read_word(BANK_STATUS_ADDR);
+			else
+				--Polling word
+				write_word(BANK_STATUS_ADDR, BANK_IDLE);
+				read_word(BANK_STATUS_ADDR);
+				while result /= BANK_DONE and result /= BANK_FAIL loop
+					read_word(BANK_STATUS_ADDR);
+				end loop;
+			end if;
+			write(res, integer'image(vector) & "," & integer'image(decrypt) & "," & integer'image(ad_bytes) & "," &
+			           integer'image(msg_bytes) & "," & integer'image(clocks - start));
+			if(result /= status) then
+				report "vector " & integer'image(vector) & ": status " & to_hstring(result) & ", expected " & to_hstring(status) severity error;
+				ok := false;
+			end if;
+
+			for i in 0 to (msg_bytes+1)/2 - 1 loop
+				check(ADDR_MSG + i, "output");
+			end loop;
+			for i in 0 to 3 loop
+				check(ADDR_MAC + i, "tag");
+			end loop;
+			for p in 0 to PERF_PHASES-1 loop
+				read_word(PERF_ADDR + 2*p);
+				perf_low := result;
+				read_word(PERF_ADDR + 2*p + 1);
+				write(res, "," & integer'image(to_integer(unsigned(result(14 downto 0)) & unsigned(perf_low))));
+			end loop;
+			if(ok) then
+				write(res, string'(",ok"));
+			else
+				write(res, string'(",mismatch"));
+				failures := failures + 1;
+			end if;
+			writeline(res_file, res);
+
+			write_word(BANK_STATUS_ADDR, BANK_IDLE);
+			write_word(0, OPCODE_VOID & CONF_CLOSE_TRANSACTION_POLMODE & CORE_1);
+			vector := vector + 1;
+		end loop;
+
+		if(failures = 0) then
+			report "PASSED: " & integer'image(vector) & " vectors";
+		else
+			report "FAILED: " & integer'image(failures) & " of " & integer'image(vector) & " vectors" severity failure;
+		end if;
+		std.env.finish;
+	end process stimuli;
+
+end test;
@@ -0,0 +1,94 @@
+----------------------------------------------------------------------------------
+-- Module Name: TB_FMC
+-- Project Name: Lightweight cipher
+-- Additional Comments: FMC bus of the CPU for the self-checking testbenches: timing
+--                      of the SECube settings, read and write of a word of the data
+--                      buffer, control words of a transaction
+----------------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.CONSTANTS.all;
+
+package TB_FMC is
+
+	-- TIME CONSTANTS (COMING FROM SETTINGS OF SOFTWARE)
+	constant HCLK_PERIOD 		 : time    := 5555 ps; -- 180 MHz
+	constant PRESCALER			 : integer := 3;
+	constant FPGA_CLK_PERIOD	 : time    := HCLK_PERIOD*PRESCALER;
+	constant ADDRESS_SETUP_TIME	 : integer := 6;
+	constant DATA_SETUP_TIME	 : integer := 6;
+
+	-- CONSTANTS FOR BETTER DEFINING CONTROL WORD TO BE WRITTEN IN ROW_0
+	constant OPCODE_VOID    			    : std_logic_vector(OPCODE_SIZE-1 downto 0) := "000000";
+	constant OPCODE_INIT_ENCRYPT		    : std_logic_vector(OPCODE_SIZE-1 downto 0) := "100000";
+	constant OPCODE_INIT_DECRYPT		    : std_logic_vector(OPCODE_SIZE-1 downto 0) := "100010";
+	constant OPCODE_STREAM_ENCRYPT		    : std_logic_vector(OPCODE_SIZE-1 downto 0) := "100100";
+	constant OPCODE_STREAM_DECRYPT		    : std_logic_vector(OPCODE_SIZE-1 downto 0) := "100110";
+	constant OPCODE_NATURAL_ORDER		    : std_logic_vector(OPCODE_SIZE-1 downto 0) := "001000";	-- key, IV, AD, message and MAC in memory order
+	constant CONF_OPEN_TRANSACTION_POLMODE  : std_logic_vector(2 downto 0) := "001";
+	constant CONF_CLOSE_TRANSACTION_POLMODE : std_logic_vector(2 downto 0) := "000";
+	constant CONF_OPEN_TRANSACTION_INTMODE  : std_logic_vector(2 downto 0) := "101";
+	constant CONF_ACK_TRANSACTION_INTMODE   : std_logic_vector(2 downto 0) := "111";	-- reopened to serve the interrupt of the core
+	constant CORE_1							: std_logic_vector(IPADDR_SIZE-1 downto 0) := "0000001";
+
+	-- R/W PROCEDURES EXECUTED BY THE MASTER (CPU THROUGH FMC), address and data given as integers
+	procedure fmc_write(signal ne1, noe, nwe : out std_logic;
+						signal address : out std_logic_vector(ADD_WIDTH-1 downto 0);
+						signal data : inout std_logic_vector(DATA_WIDTH-1 downto 0);
+						w_addr : in integer;
+						w_data : in std_logic_vector(DATA_WIDTH-1 downto 0));
+
+	procedure fmc_read(signal ne1, noe, nwe : out std_logic;
+					   signal address : out std_logic_vector(ADD_WIDTH-1 downto 0);
+					   signal data : inout std_logic_vector(DATA_WIDTH-1 downto 0);
+					   r_addr : in integer;
+					   result : out std_logic_vector(DATA_WIDTH-1 downto 0));
+
+end package TB_FMC;
+
+package body TB_FMC is
+
+	procedure fmc_write(signal ne1, noe, nwe : out std_logic;
+						signal address : out std_logic_vector(ADD_WIDTH-1 downto 0);
+						signal data : inout std_logic_vector(DATA_WIDTH-1 downto 0);
+						w_addr : in integer;
+						w_data : in std_logic_vector(DATA_WIDTH-1 downto 0)) is
+	begin
+		wait for 15*HCLK_PERIOD;
+		ne1 <= '0';
+		noe <= '1';
+		nwe <= '1';
+		address <= std_logic_vector(to_unsigned(w_addr, ADD_WIDTH));
+		wait for ADDRESS_SETUP_TIME*HCLK_PERIOD;
+		nwe <= '0';
+		data <= w_data;
+		wait for DATA_SETUP_TIME*HCLK_PERIOD;
+		nwe <= '1';
+		wait for HCLK_PERIOD;
+		ne1 <= '1';
+		noe <= '0';
+	end fmc_write;
+
+	procedure fmc_read(signal ne1, noe, nwe : out std_logic;
+					   signal address : out std_logic_vector(ADD_WIDTH-1 downto 0);
+					   signal data : inout std_logic_vector(DATA_WIDTH-1 downto 0);
+					   r_addr : in integer;
+					   result : out std_logic_vector(DATA_WIDTH-1 downto 0)) is
+	begin
+		wait for 15*HCLK_PERIOD;
+		ne1 <= '0';
+		noe <= '1';
+		nwe <= '1';
+		data <= (others => 'Z');
+		address <= std_logic_vector(to_unsigned(r_addr, ADD_WIDTH));
+		wait for ADDRESS_SETUP_TIME*HCLK_PERIOD;
+		noe <= '0';
+		wait for DATA_SETUP_TIME*HCLK_PERIOD;
+		ne1 <= '1';
+		noe <= '1';
+		result := data;
+	end fmc_read;
+
+end package body TB_FMC;
@@ -5,6 +5,12 @@
 -- Project Name: Lightweight cipher
 -- Version: 1.1
 -- Additional Comments: FSM-based controller to execute the encryp/decrypt APIs 
+--                      The end of a transaction is signalled in the status word of the
+--                      bank (polling mode) and, if the I/P bit of the control word is set
+--                      (interrupt mode, interrupt_polling = '1'), also by an interrupt
+--                      request held until the CPU acknowledges it. Stream and batch
+--                      transactions are polling only: their opcodes are refused in
+--                      interrupt mode
 ----------------------------------------------------------------------------------
 --Pulito telegram
 library IEEE;
@@ -24,6 +30,7 @@ entity grain_controller is
 			data_out 				: out std_logic_vector(DATA_WIDTH-1 downto 0);
 			buffer_enable 			: out std_logic;
 			address 				: out std_logic_vector(ADD_WIDTH-1 downto 0);
+			bank 					: out std_logic_vector(BANK_WIDTH-1 downto 0);
 			rw 						: out std_logic;
 			interrupt  				: out std_logic;
 			error 					: out std_logic;
@@ -44,6 +51,20 @@ begin
     return return_vector;
 end swapsb;
 
+--Position of the i-th of n words: in natural order the words come from the CPU in memory order,
+--while the internal registers keep the reversed order of the legacy packets
+function ordered(natural_order : std_logic; i : integer; n : integer) return integer is
+begin
+    if(natural_order = '1') then
+        return n-1-i;
+    else
+        return i;
+    end if;
+end ordered;
+
+--Bit of the opcode asking for the natural word order (key, IV, AD, message and MAC)
+constant NATURAL_ORDER_BIT : integer := 3;
+
 type statetype is (OFF,
 				   
 				   WAIT_CW,
@@ -52,6 +73,10 @@ type statetype is (OFF,
 				   
 				   DECODE_OPCODE,
 				   
+				   WAIT_BANK,
+				   ADDR_BANK,
+				   READ_BANK,
+				   
 				   WAIT_KEY,
 				   ADDR_KEY,
 				   READ_KEY,
@@ -68,10 +93,6 @@ type statetype is (OFF,
 				   ADDR_AD,
 				   READ_AD,
 
-				   WAIT_MSG,
-				   ADDR_MSG,
-				   READ_MSG,
-				   
 				   WAIT_MAC_DECRYPTION,
 				   ADDR_MAC_DECRYPTION,
 				   READ_MAC_DECRYPTION,
@@ -106,64 +127,12 @@ type statetype is (OFF,
 				   OP_INIT_CORE_SR_LOAD,
 				   WAIT_CORE_SR_LOAD,
 				   
-				   TAG_NEXT_Z,
-				   OP_TAG_NEXT_Z,
-				   WAIT_LATCH_TAG_NEXT_Z,
-				   WAIT_TAG_NEXT_Z,
-				   
-				   TAG_ACCUMULATE,
-				   OP_TAG_ACCUMULATE,
-				   WAIT_TAG_ACCUMULATE,
-				   
-				   TAG_LOAD_SR,
-				   OP_TAG_LOAD_SR,
-				   WAIT_TAG_LOAD_SR,
-				   
-				   CIPHER_NEXT_Z,
-				   OP_CIPHER_NEXT_Z,
-				   WAIT_CIPHER_NEXT_Z,
-				   WAIT_LATCH_CIPHER_NEXT_Z,
-				   WAIT_LATCH_RAM_ENCRYPT,
-				   
-				   CIPHER_ACCUMULATE,
-				   OP_CIPHER_ACCUMULATE,
-				   WAIT_CIPHER_ACCUMULATE,
-				   
-				   
-				   CIPHER_LOAD_SR,
-				   OP_CIPHER_LOAD_SR,
-				   WAIT_CIPHER_LOAD_SR,
-				   
-				   
-				   CIPHER_NEXT_Z_1_DECRYPT,
-				   OP_CIPHER_NEXT_Z_1_DECRYPT,
-				   WAIT_LATCH_CIPHER_NEXT_Z_1_DECRYPT,
-				   WAIT_CIPHER_NEXT_Z_1_DECRYPT,
-				   WAIT_LATCH_RAM_DECRYPT,
-				   
-				   
-				   CIPHER_NEXT_Z_2_DECRYPT,
-				   OP_CIPHER_NEXT_Z_2_DECRYPT,
-				   WAIT_LATCH_CIPHER_NEXT_Z_2_DECRYPT,
-				   WAIT_CIPHER_NEXT_Z_2_DECRYPT,
-				   
-				   
-				   CIPHER_ACCUMULATE_DECRYPT,
-				   OP_CIPHER_ACCUMULATE_DECRYPT,
-				   WAIT_CIPHER_ACCUMULATE_DECRYPT,
-				   
+				   TAG_STREAM,
 				   
-				   CIPHER_LOAD_SR_DECRYPT,
-				   OP_CIPHER_LOAD_SR_DECRYPT,
-				   WAIT_CIPHER_LOAD_SR_DECRYPT,
+				   MSG_PIPE,
 				   
-				   GENERATE_USELESS_NEXT_Z,
-				   OP_USELESS_NEXT_Z,
-				   WAIT_USELESS_NEXT_Z,
-				   
-				   USELESS_ACCUMULATE,
-				   OP_USELESS_ACCUMULATE,
-				   WAIT_USELESS_ACCUMULATE,
+				   PAD_STREAM,
+				   PAD_STREAM_END,
 				   
 				   GET_MAC,
 				   OP_GET_MAC,
@@ -171,24 +140,69 @@ type statetype is (OFF,
 				   WAIT_LATCH_GET_MAC,
 				   
 				   COMPARE_MAC,
+				   ZERO_OUTPUT,
 				   
 				   UPDATE_STATE,
 				   
-				   LOAD_CT_RAM,
-				   WAIT_LOAD_CT_RAM,
 				   WRITE_MAC,
 				   OP_WRITE_MAC,
 				   WAIT_WRITE_MAC,
 
-				   WRITE_CT,
-				   OP_WRITE_CT,
-				   WAIT_WRITE_CT,
+				   WRITE_PERF,
+
+				   WAIT_ACK,
 
            		   CLEAR_ALL,
                    DONE);
 
 signal state: statetype; 
 
+--PERFORMANCE COUNTERS, indexes of the phases
+constant PERF_LOAD   : integer := 0;	--control word, key, IV, lengths, AD, message and MAC read from the data buffer
+constant PERF_INIT   : integer := 1;	--key and IV loaded in the core, pre-output clocks
+constant PERF_ADDKEY : integer := 2;	--accumulator and shift register from the key
+constant PERF_AD     : integer := 3;	--TAG_STREAM
+constant PERF_MSG    : integer := 4;	--message read, through the stream of the core and written back to the data buffer
+constant PERF_MAC    : integer := 5;	--MAC read from the core, compared and written to the data buffer
+constant PERF_IDLE   : integer := 6;	--waiting for the CPU: words not written yet, status word of the bank polled
+
+--Phase of a state, PERF_PHASES if it is not counted; a WAIT_x state of PERF_LOAD which does not move is PERF_IDLE
+function perf_phase(s : statetype) return integer is
+begin
+	case s is
+		when WAIT_CW | ADDR_CW | READ_CW | DECODE_OPCODE |
+		     WAIT_KEY | ADDR_KEY | READ_KEY | WAIT_IV | ADDR_IV | READ_IV | WAIT_LENGTH | ADDR_LENGTH | READ_LENGTH |
+		     WAIT_AD | ADDR_AD | READ_AD |
+		     WAIT_MAC_DECRYPTION | ADDR_MAC_DECRYPTION | READ_MAC_DECRYPTION =>
+			return PERF_LOAD;
+		when WAIT_BANK | ADDR_BANK | READ_BANK =>
+			return PERF_IDLE;
+		when INIT_CORE_IV | OP_INIT_CORE_IV | WAIT_CORE_IV | INIT_CORE_KEY | OP_INIT_CORE_KEY | WAIT_CORE_KEY |
+		     INIT_CORE_PRE_OUTPUT | OP_INIT_CORE_PRE_OUTPUT | WAIT_CORE_PRE_OUTPUT =>
+			return PERF_INIT;
+		when INIT_CORE_ACC_NEXT_Z | OP_INIT_CORE_ACC_NEXT_Z | WAIT_LATCH_CORE_ACC_NEXT_Z | WAIT_CORE_ACC_NEXT_Z |
+		     INIT_CORE_ACC_LOAD | OP_INIT_CORE_ACC_LOAD | WAIT_CORE_ACC_LOAD |
+		     INIT_CORE_SR_NEXT_Z | OP_INIT_CORE_SR_NEXT_Z | WAIT_LATCH_CORE_SR_NEXT_Z | WAIT_CORE_SR_NEXT_Z |
+		     INIT_CORE_SR_LOAD | OP_INIT_CORE_SR_LOAD | WAIT_CORE_SR_LOAD =>
+			return PERF_ADDKEY;
+		when TAG_STREAM =>
+			return PERF_AD;
+		when MSG_PIPE | PAD_STREAM | PAD_STREAM_END =>
+			return PERF_MSG;
+		when GET_MAC | OP_GET_MAC | WAIT_GET_MAC | WAIT_LATCH_GET_MAC | COMPARE_MAC | ZERO_OUTPUT |
+		     WRITE_MAC | OP_WRITE_MAC | WAIT_WRITE_MAC =>
+			return PERF_MAC;
+		when others =>
+			return PERF_PHASES;
+	end case;
+end perf_phase;
+
+type perf_array is array (PERF_PHASES-1 downto 0) of unsigned(31 downto 0);
+
+--MESSAGE PIPELINE: words read ahead of the core, and its output words waiting for the data buffer
+constant PIPE_DEPTH : integer := 4;
+type pipe_fifo is array (PIPE_DEPTH-1 downto 0) of std_logic_vector(15 downto 0);
+
 --GRAIN ROUND MODE
 constant INIT   	: std_logic_vector(1 downto 0) := "00";
 constant ADD_KEY    : std_logic_vector(1 downto 0) := "01";
@@ -204,69 +218,71 @@ constant ACCUMULATE		: std_logic_vector(2 downto 0) := "101";
 constant READ_AUTH_ACC	: std_logic_vector(2 downto 0) := "110";
 
 component grain128_core
+    generic(
+            PARALLEL        : integer := 1
+        );
     port(
             clk             : in std_logic;
             rst             : in std_logic;
             data_16_in      : in std_logic_vector(15 downto 0);
             data_16_addr_in : in std_logic_vector(2 downto 0);
-            serial_data_in  : in std_logic;
+            serial_data_in  : in std_logic_vector(PARALLEL-1 downto 0);
             start           : in std_logic;
             operation       : in std_logic_vector(2 downto 0);
             grain_round     : in std_logic_vector(1 downto 0);
             data_16_out     : out std_logic_vector(15 downto 0);
-            serial_data_out : out std_logic;
+            serial_data_out : out std_logic_vector(PARALLEL-1 downto 0);
             completed       : out std_logic;
-            busy            : out std_logic
+            busy            : out std_logic;
+            stream_en       : in std_logic;
+            stream_half     : in std_logic;
+            stream_decrypt  : in std_logic;
+            stream_data_in  : in std_logic_vector(15 downto 0);
+            stream_data_out : out std_logic_vector(15 downto 0)
         );
 end component;
 
---RAM
-component ram_16x16 is
-    port (
-        Clock: in  std_logic; 
-        ClockEn: in  std_logic; 
-        Reset: in  std_logic; 
-        WE: in  std_logic; 
-        Address: in  std_logic_vector(3 downto 0); 
-        Data: in  std_logic_vector(15 downto 0); 
-        Q: out  std_logic_vector(15 downto 0));
-end component;
-
---SIGNALS FOR MSG_RAM
-signal Address_s:   std_logic_vector(3 downto 0); 
-signal Data_s:   std_logic_vector(15 downto 0); 
-signal WE_s:   std_logic; 
-signal Q_s:   std_logic_vector(15 downto 0);
-
---SIGNALS FOR CT_RAM
-signal reset_ct  :  std_logic;
-signal Address_ct:	std_logic_vector(3 downto 0);
-signal Data_ct:		std_logic_vector(15 downto 0);
-signal WE_ct: 		std_logic;
-signal Q_ct:		std_logic_vector(15 downto 0);
-
-signal serial_data_ct: std_logic_vector(15 downto 0);
+--MESSAGE PIPELINE
+signal msg_fifo			 :  pipe_fifo;								--Prefetch FIFO: words of the message read from the data buffer
+signal ct_fifo			 :  pipe_fifo;								--Write-back FIFO: output words of the core
+signal fetch_pending	 :  std_logic_vector(1 downto 0);			--Reads of the prefetch FIFO on their way from the data buffer
 
 --INTERCONNECTION WITH IP_CORE
 signal data_16_in_c      :  std_logic_vector(15 downto 0);
 signal data_16_addr_in_c :  std_logic_vector(2 downto 0);
-signal serial_data_in_c  :  std_logic;
+signal serial_data_in_c  :  std_logic_vector(GRAIN_PARALLEL-1 downto 0);
 signal start_c           :  std_logic;
 signal operation_c       :  std_logic_vector(2 downto 0);
 signal grain_round_c     :  std_logic_vector(1 downto 0);
 signal data_16_out_c     :  std_logic_vector(15 downto 0);
-signal serial_data_out_c :  std_logic;
+signal serial_data_out_c :  std_logic_vector(GRAIN_PARALLEL-1 downto 0);
 signal completed_c       :  std_logic;
 signal busy_c            :  std_logic;
 signal rst_c             :  std_logic;
 
 signal set_init_core     :  std_logic;
-signal NEXT_Z_reg		 :  std_logic;
+signal z_buffer			 :  std_logic_vector(GRAIN_PARALLEL-1 downto 0);	--Keystream of the last NEXT_Z, loaded in the authenticator
+--stream of the core: a word of the message per clock
+signal stream_en_c		 :  std_logic;
+signal stream_half_c	 :  std_logic;
+signal stream_decrypt_c	 :  std_logic;
+signal stream_data_in_c	 :  std_logic_vector(15 downto 0);
+signal stream_data_out_c :  std_logic_vector(15 downto 0);
 
 --Memories
 type memory_128 is array (7 downto 0) of std_logic_vector(15 downto 0);
 type memory_64 is array (3 downto 0) of std_logic_vector(15 downto 0);
-type memory_ad is array (9 downto 0) of std_logic_vector(7 downto 0);
+type memory_ad is array (20 downto 0) of std_logic_vector(7 downto 0);	--the 10 AD words of an init packet and the DER length
+
+--GRAIN_PARALLEL bits of the key from the bit high down, in the order the core takes them in the ADD_KEY round
+function key_bits(key : memory_128; high : integer) return std_logic_vector is
+variable return_vector : std_logic_vector(GRAIN_PARALLEL-1 downto 0);
+begin
+    for k in 0 to GRAIN_PARALLEL-1 loop
+        return_vector(GRAIN_PARALLEL-1-k) := key((high-k)/16)((high-k) mod 16);
+    end loop;
+    return return_vector;
+end key_bits;
 --type memory_msg is array (31 downto 0) of std_logic_vector(7 downto 0);
 --REGS
 signal CW      		 	: std_logic_vector(15  downto 0);
@@ -287,19 +303,39 @@ signal TAG 				: std_logic_vector(63 downto 0);
 signal MAC_from_message: std_logic_vector(63 downto 0);
 signal wc_count 		: std_logic_vector(7   downto 0);
 
+--STREAMING MODE
+signal stream_mode		: std_logic;								--1 if the packets are exchanged through the banks of the data buffer
+signal cur_bank 		: unsigned(BANK_WIDTH-1 downto 0);			--Bank of the data buffer currently processed
+signal last_packet		: std_logic;								--1 if the packet closes the message (tag computed/verified), always 1 outside streaming mode
+signal auth_fail		: std_logic;								--1 if the tag of the decrypted message did not match
+
+--BATCH MODE
+signal batch_mode		: std_logic;								--1 if each bank of the ring is a descriptor: a whole message with its own key, IV and tag
+signal batch_last		: std_logic;								--1 if the descriptor being processed closes the batch
+
+--WORD ORDER
+signal natural_order	: std_logic;								--1 if the packets are in memory order, 0 if reversed by the CPU
+
+--COMPLETION MODE
+signal irq_mode			: std_logic;								--1 if the end of the transaction is also signalled by an interrupt
+
+--PERFORMANCE COUNTERS
+signal perf				: perf_array;								--clocks of each phase since the beginning of the transaction
+signal perf_state		: statetype;								--state of the previous clock, counted once its next state is known
+
 begin
 
---RAM for MSG
-ram_msg : ram_16x16 port map(clock, '1', reset, WE_s, Address_s, Data_s, Q_s);
-ram_ct  : ram_16x16 port map(clock, '1', reset, WE_ct, Address_ct, Data_ct, Q_ct);
 -- Cipher core instantiation
-core: grain128_core port map (clock, rst_c, data_16_in_c, data_16_addr_in_c, serial_data_in_c, start_c,
+core: grain128_core generic map (GRAIN_PARALLEL)
+                    port map (clock, rst_c, data_16_in_c, data_16_addr_in_c, serial_data_in_c, start_c,
                               operation_c, grain_round_c, data_16_out_c, serial_data_out_c,
-	                          completed_c, busy_c);
+	                          completed_c, busy_c, stream_en_c, stream_half_c, stream_decrypt_c, stream_data_in_c, stream_data_out_c);
 
 ------------------------------------------------------------------------
 
 -- Syncr. process to count the write_completed signal's rising edge
+-- Cleared between transactions only: in interrupt mode the CPU may close the transaction as soon as the
+-- packet is written, before the FSM has read all of it (no write is notified to a core left working)
 process (clock, reset)
 begin
     if(reset = '1') then
@@ -308,33 +344,60 @@ begin
         if(write_completed = '1') then
             wc_count <= std_logic_vector(to_unsigned(1, 8) + unsigned(wc_count));
         end if;
-        if(enable = '0') then
+        if(state = OFF) then
             wc_count <= std_logic_vector(to_unsigned(1, 8));
         end if;
     end if;
 end process;
 
+-- Performance counters, cleared in OFF
+process (clock, reset)
+variable phase : integer range 0 to PERF_PHASES;
+begin
+    if(reset = '1') then
+        perf <= (others => (others => '0'));
+        perf_state <= OFF;
+    elsif(rising_edge(clock)) then
+        perf_state <= state;
+        if(state = OFF) then
+            perf <= (others => (others => '0'));
+        else
+            phase := perf_phase(perf_state);
+            if(phase = PERF_LOAD and state = perf_state) then
+                phase := PERF_IDLE;
+            end if;
+            if(phase < PERF_PHASES) then
+                perf(phase) <= perf(phase) + 1;
+            end if;
+        end if;
+    end if;
+end process;
+
 -- FSM process
 process (clock, reset)
 
 variable key_count   		  : std_logic_vector(7 downto 0) := (others=>'0');	--Iterator for the key 
 variable iv_count    		  : std_logic_vector(7 downto 0) := (others=>'0');	--Iterator for the iv
 variable ad_count    		  : std_logic_vector(9 downto 0) := (others=>'0');	--Iterator for the AD
-variable msg_count   	      : std_logic_vector(9 downto 0) := (others=>'0');	--Iterator for the MSG
 variable msg_address_decode   : std_logic_vector(7 downto 0) := (others=>'0'); 	--Variable used to address message based on init packet or message packet.
 variable lenght_adress_decode : std_logic_vector(7 downto 0) := (others=>'0');	--Variable used to address lenght of message on init packet or messagge packet.
 variable pre_output_count     : std_logic_vector(8 downto 0) := (others=>'0'); 	--Iterator for the pre-output initial free-run
 variable acc_count			  : std_logic_vector(9 downto 0) := std_logic_vector(to_unsigned(127, 10)); 			--Iterator for the key when initial loading of ACC and SR
 variable tag_count			  : std_logic_vector(9 downto 0) := (others=>'0');	--Iterator for the TAG accumulation
-variable crypt_count		  : std_logic_vector(9 downto 0) := (others=>'0');	--Iterator for the encrypt/decrypt
-variable ac_count			  : std_logic_vector(9 downto 0) := (others=>'0'); 	--Iterator 
+variable fetch_count		  : integer range 0 to 255 := 0;						--Words of the message read from the data buffer
+variable fetched_count		  : integer range 0 to 255 := 0;						--Words of the message in the prefetch FIFO so far
+variable cipher_count		  : integer range 0 to 255 := 0;						--Words of the message through the stream of the core
+variable ct_count			  : integer range 0 to 255 := 0;						--Output words in the write-back FIFO so far
+variable write_count		  : integer range 0 to 255 := 0;						--Output words written to the data buffer
+variable msg_words			  : integer range 0 to 255;							--Words of the message, the trailing byte of an odd packet included
+variable fetch_issue		  : std_logic;										--1 if a read of the prefetch FIFO goes to the data buffer in this clock
 variable mac_count			  : std_logic_vector(7 downto 0) := (others=>'0'); 	--Iterator for the MAC
+variable perf_count			  : std_logic_vector(7 downto 0) := (others=>'0'); 	--Iterator for the words of the performance counters
 variable wc_to_wait_length    : std_logic_vector(7 downto 0) := (others=>'0');	--# of write_completed before reading the lenght word
 variable wc_to_wait_msg       : std_logic_vector(7 downto 0) := (others=>'0');	--# of write_completed before reading the msg words
 variable encrypt_decrypt      : std_logic := '0';								--0 if encrypt, 1 if decrypt
-variable next_z_addressing    : std_logic_vector(9 downto 0);
-variable ct_ram_addressing	  : std_logic_vector(9 downto 0); 					--remove it if not used
-variable start_mac_address 	  : std_logic_vector(9 downto 0);
+variable packet_type          : std_logic_vector(OPCODE_SIZE-1 downto 0);		--Opcode without the word order bit
+variable word_index           : integer;										--Position in the data buffer of the message word being read
 
 variable debug : std_logic_vector(0 downto 0);
 begin
@@ -347,7 +410,7 @@ begin
 		rst_c				<= '1';
 		data_16_in_c 		<= (others => '0');
 		data_16_addr_in_c 	<= (others => '0');
-		serial_data_in_c 	<= '0';
+		serial_data_in_c 	<= (others => '0');
 		start_c			    <= '0';
 		operation_c 		<= (others => '0');
 		grain_round_c 		<= (others => '0');
@@ -363,40 +426,56 @@ begin
 		--CT 		      		<= (others => (others => '0'));
 		TAG 		  		<= (others => '0');
 		mac_from_message 	<= (others => '0');
-		serial_data_ct      <= (others => '0');
 		key_count 			:= (others => '0');
 		iv_count 			:= (others => '0');
 		ad_count 			:= (others => '0');
-		msg_count 			:= (others => '0');
 		msg_address_decode 	:= (others => '0');
 		lenght_adress_decode:= (others => '0');
 		pre_output_count 	:= (others => '0');
 		acc_count 			:= std_logic_vector(to_unsigned(127, 10));
 		tag_count 			:= (others => '0');
-		crypt_count 		:= (others => '0');
-		ac_count 			:= (others => '0');
+		fetch_count			:= 0;
+		fetched_count		:= 0;
+		cipher_count		:= 0;
+		ct_count			:= 0;
+		write_count			:= 0;
 		mac_count			:= (others => '0');
+		perf_count			:= (others => '0');
 		wc_to_wait_length	:= (others => '0');
 		wc_to_wait_msg		:= (others => '0');
-		reset_ct 			<= '1';
+		fetch_pending		<= (others => '0');
+		stream_mode			<= '0';
+		cur_bank			<= (others => '0');
+		last_packet			<= '1';
+		auth_fail			<= '0';
+		batch_mode			<= '0';
+		batch_last			<= '1';
+		natural_order		<= '0';
+		irq_mode			<= '0';
 		
 		encrypt_decrypt		:= '0';
+		stream_en_c			<= '0';
+		stream_half_c		<= '0';
+		stream_decrypt_c	<= '0';
+		stream_data_in_c	<= (others => '0');
 	elsif(rising_edge(clock)) then
-		WE_s <= '0';
-		WE_ct <= '0';
 		case (state) is
 ----------------OFF STATE------------------------------------------------------------------------------
 			when OFF =>
 				--CORE SIGNALS
 				rst_c <= '0';
-				reset_ct <= '0';
+				fetch_pending <= (others => '0');
 				data_16_in_c <= (others => '0');
 				data_16_addr_in_c <= (others => '0');
-				serial_data_in_c <= '0';
+				serial_data_in_c <= (others => '0');
 				start_c <= '0';
 				operation_c <= (others => '0');
 				grain_round_c <= (others => '0');
-				NEXT_Z_reg <= '0';
+				z_buffer <= (others => '0');
+				stream_en_c <= '0';
+				stream_half_c <= '0';
+				stream_decrypt_c <= '0';
+				stream_data_in_c <= (others => '0');
 				----------------------------
 				data_out <=  (others => '0');
 				buffer_enable <= '0';
@@ -414,21 +493,31 @@ begin
 				AD 		      		<= (others => (others => '0'));
 				TAG 		  		<= (others => '0');
 				mac_from_message 	<= (others => '0');
-				serial_data_ct      <= (others => '0');
 				key_count 			:= (others => '0');
 				iv_count 			:= (others => '0');
 				ad_count 			:= (others => '0');
-				msg_count 			:= (others => '0');
-				msg_address_decode 	:= (others => '0');
+						msg_address_decode 	:= (others => '0');
 				lenght_adress_decode:= (others => '0');
 				pre_output_count 	:= (others => '0');
 				acc_count 			:= std_logic_vector(to_unsigned(127, 10));
 				tag_count 			:= (others => '0');
-				crypt_count 		:= (others => '0');
-				ac_count 			:= (others => '0');
+				fetch_count			:= 0;
+				fetched_count		:= 0;
+				cipher_count		:= 0;
+				ct_count			:= 0;
+				write_count			:= 0;
 				mac_count			:= (others => '0');
+				perf_count			:= (others => '0');
 				wc_to_wait_length	:= (others => '0');
 				wc_to_wait_msg		:= (others => '0');
+				stream_mode			<= '0';
+				cur_bank			<= (others => '0');
+				last_packet			<= '1';
+				auth_fail			<= '0';
+				batch_mode			<= '0';
+				batch_last			<= '1';
+				natural_order		<= '0';
+				irq_mode			<= '0';
 				
                 ----------------------------------
 			    if(enable = '1') then
@@ -464,7 +553,11 @@ begin
 				state <= DECODE_OPCODE;
 ---------------------EVALUATE PACKET TYPE------------------------------------------------------------------------
 			WHEN DECODE_OPCODE =>
-				case CW(15 downto 10) is
+				natural_order <= CW(10+NATURAL_ORDER_BIT);
+				irq_mode <= interrupt_polling;
+				packet_type := CW(15 downto 10);
+				packet_type(NATURAL_ORDER_BIT) := '0';
+				case packet_type is
 					when "100000" => --init encrypt
 						state <= WAIT_KEY;
 						msg_address_decode := std_logic_vector(to_unsigned(28, 8));
@@ -507,12 +600,103 @@ begin
 						encrypt_decrypt := '1';			--Decrypt
 						set_init_core <= '0';			--Not init
 						rst_c <= '0';
+					when "100100" => --stream encrypt
+						state <= WAIT_BANK;
+						msg_address_decode := std_logic_vector(to_unsigned(28, 8));
+						lenght_adress_decode := std_logic_vector(to_unsigned(17, 8));
+						
+						encrypt_decrypt := '0';			--Encrypt
+						set_init_core <= '1';			--Init on the first bank
+						rst_c <= '1';					--Clear the cipher
+						stream_mode <= '1';
+					when "100110" => --stream decrypt
+						state <= WAIT_BANK;
+						msg_address_decode := std_logic_vector(to_unsigned(28, 8));
+						lenght_adress_decode := std_logic_vector(to_unsigned(17, 8));
+						
+						encrypt_decrypt := '1';			--Decrypt
+						set_init_core <= '1';			--Init on the first bank
+						rst_c <= '1';					--Clear the cipher
+						stream_mode <= '1';
+					when "110000" => --batch encrypt
+						state <= WAIT_BANK;
+						msg_address_decode := std_logic_vector(to_unsigned(28, 8));
+						lenght_adress_decode := std_logic_vector(to_unsigned(17, 8));
+						
+						encrypt_decrypt := '0';			--Encrypt
+						set_init_core <= '1';			--Init on every bank
+						rst_c <= '1';					--Clear the cipher
+						stream_mode <= '1';
+						batch_mode <= '1';
+					when "110010" => --batch decrypt
+						state <= WAIT_BANK;
+						msg_address_decode := std_logic_vector(to_unsigned(28, 8));
+						lenght_adress_decode := std_logic_vector(to_unsigned(17, 8));
+						
+						encrypt_decrypt := '1';			--Decrypt
+						set_init_core <= '1';			--Init on every bank
+						rst_c <= '1';					--Clear the cipher
+						stream_mode <= '1';
+						batch_mode <= '1';
 					when OTHERS =>
 						state <= OFF;
 				end case;
+				--the banks of a stream or a batch are handed over within the transaction, which the CPU closes
+				--as soon as the packet is written in interrupt mode: refused as an unknown opcode
+				if(interrupt_polling = '1' and (packet_type = "100100" or packet_type = "100110" or
+				                                packet_type = "110000" or packet_type = "110010")) then
+					state <= OFF;
+				end if;
+-------------------WAIT FOR A BANK FILLED BY THE CPU (STREAMING MODE)----------------------------------
+			when WAIT_BANK =>
+				if(enable = '0') then
+					state <= OFF;
+				else
+					buffer_enable <= '1';
+					address <= std_logic_vector(to_unsigned(BANK_STATUS_ADDR, ADD_WIDTH));
+					data_out <= (others => '0');
+					rw <= '0';
+					interrupt <= '0';
+					error <= '0';
+					state <= ADDR_BANK;
+				end if;
+
+			when ADDR_BANK =>
+				state <= READ_BANK;
+
+			when READ_BANK =>
+				buffer_enable <= '0';
+				address <= (others => '0');
+				if(data_in = BANK_READY or data_in = BANK_LAST) then
+					if(batch_mode = '1') then
+						-- every descriptor is a whole message: the cipher starts again from its key and IV,
+						-- and the CPU marks the last descriptor of the batch
+						last_packet <= '1';
+						if(data_in = BANK_LAST) then
+							batch_last <= '1';
+						else
+							batch_last <= '0';
+						end if;
+						rst_c <= '1';
+						auth_fail <= '0';
+						acc_count := std_logic_vector(to_unsigned(127, 10));
+					-- the accumulator is carried over to the next bank until the CPU marks the last one
+					elsif(data_in = BANK_LAST) then
+						last_packet <= '1';
+					else
+						last_packet <= '0';
+					end if;
+					if(set_init_core = '1') then
+						state <= WAIT_KEY;
+					else
+						state <= WAIT_LENGTH;
+					end if;
+				else
+					state <= WAIT_BANK;
+				end if;
 --------------------READING KEY-------------------------------------------------------------------------
 		    when WAIT_KEY =>
-		    	if(to_integer(unsigned(wc_count)) >(1+to_integer(unsigned(key_count)))) then
+		    	if(stream_mode = '1' or to_integer(unsigned(wc_count)) >(1+to_integer(unsigned(key_count)))) then
 					buffer_enable <= '1';
 					address <= std_logic_vector(to_unsigned(to_integer(unsigned(key_count))+1, ADD_WIDTH));
 					data_out <= (others => '0'); 
@@ -529,7 +713,7 @@ begin
 
 		    WHEN READ_KEY =>
 		    	--key((15+(16*key_count)) downto (16*key_count)) <= swapsb(data_in(15 downto 8)) & swapsb(data_in(7 downto 0));
-				key(to_integer(unsigned(key_count))) <= swapsb(data_in(15 downto 8)) & swapsb(data_in(7 downto 0));
+				key(ordered(natural_order, to_integer(unsigned(key_count)), 8)) <= swapsb(data_in(15 downto 8)) & swapsb(data_in(7 downto 0));
 		    	data_out <= (others => '0');
 		    	buffer_enable <= '0';
 		    	address <= (others => '0');
@@ -547,7 +731,7 @@ begin
 			    end if;
 -------------------READING INITIALIZTION VECTOR-----------------------------------------------------------------------
 		    WHEN WAIT_IV =>
-		    	if(to_integer(unsigned(wc_count))>(1+8+to_integer(unsigned(IV_count)))) then
+		    	if(stream_mode = '1' or to_integer(unsigned(wc_count))>(1+8+to_integer(unsigned(IV_count)))) then
 					buffer_enable <= '1';
 					address <= std_logic_vector(to_unsigned(to_integer(unsigned(IV_count))+1+8, ADD_WIDTH));
 					data_out <= (others => '0'); 
@@ -564,7 +748,7 @@ begin
 
 			WHEN READ_IV =>
 				--IV((15+(16*(iv_count+2))) downto (16*(iv_count+2))) <= swapsb(data_in(15 downto 8)) & swapsb(data_in(7 downto 0));
-				iv(to_integer(unsigned(iv_count)) + 2) <= swapsb(data_in(15 downto 8)) & swapsb(data_in(7 downto 0));
+				iv(ordered(natural_order, to_integer(unsigned(iv_count)), 6) + 2) <= swapsb(data_in(15 downto 8)) & swapsb(data_in(7 downto 0));
 		    	data_out <= (others => '0');
 		    	buffer_enable <= '0';
 		    	address <= (others => '0');
@@ -576,11 +760,12 @@ begin
 					state <= WAIT_IV;
 			    else
 			    	iv_count := std_logic_vector(to_unsigned(0, 8));
-			    	state <= WAIT_LENGTH;
+			    	--the core needs nothing else to initialise: it runs while the CPU is still writing the rest of the packet
+			    	state <= INIT_CORE_IV;
 			    end if;
 --------------READING LENGHT OF ASSOCIATED DATA AND MESSAGE----------------------------------------------------------------
 		    WHEN WAIT_LENGTH =>
-		    	if(to_integer(unsigned(wc_count)) > to_integer(unsigned(wc_to_wait_length))) then
+		    	if(stream_mode = '1' or to_integer(unsigned(wc_count)) > to_integer(unsigned(wc_to_wait_length))) then
 					buffer_enable <= '1';
 					address <= std_logic_vector(to_unsigned(to_integer(unsigned(lenght_adress_decode)), ADD_WIDTH)); 
 					data_out <= (others => '0'); 
@@ -604,14 +789,26 @@ begin
 				rw <= '0';
 				interrupt <= '0';
 				error <= '0';
-				if(set_init_core = '1') then
+				--only the last packet of a decryption carries the MAC
+				if(set_init_core = '1' and unsigned(data_in(7 downto 0)) /= 0) then
 					state <= WAIT_AD;
+				elsif(set_init_core = '1') then
+					--no AD to read: only its DER length goes to the tag
+					AD(0) <= (others => '0');
+					wc_to_wait_msg := std_logic_vector(to_unsigned(16, 8));
+					if(encrypt_decrypt = '0' or last_packet = '0') then
+						state <= TAG_STREAM;
+					else
+						state <= WAIT_MAC_DECRYPTION;
+					end if;
+				elsif(encrypt_decrypt = '0' or last_packet = '0') then
+					state <= MSG_PIPE;
 				else
-					state <= WAIT_MSG;
+					state <= WAIT_MAC_DECRYPTION;
 				end if;
 -------------------------READING ASSOCIATED DATA---------------------------------------------------------------
 			WHEN WAIT_AD =>
-                if(to_integer(unsigned(wc_count)) > to_integer(unsigned(wc_to_wait_length)) + to_integer(unsigned(AD_count))/2) then 
+                if(stream_mode = '1' or to_integer(unsigned(wc_count)) > to_integer(unsigned(wc_to_wait_length)) + to_integer(unsigned(AD_count))/2) then 
 					buffer_enable <= '1';
 					address <= std_logic_vector(to_unsigned(to_integer(unsigned(AD_count))/2 + 18, ADD_WIDTH));
 					data_out <= (others => '0'); 
@@ -628,8 +825,17 @@ begin
 
 			WHEN READ_AD =>
 				--AD((15+(16*AD_count)) downto (16*AD_count)) <= swapsb(data_in(15 downto 8)) & swapsb(data_in(7 downto 0));	
-				AD(to_integer(unsigned(AD_count))) <= swapsb(data_in(15 downto 8));
-				AD(to_integer(unsigned(AD_count))+1) <= swapsb(data_in(7 downto 0));
+				--TAG_STREAM takes AD(lenght_AD-1) first: in natural order byte k of the AD goes to AD(lenght_AD-1-k),
+				--the unused lower half of the last word of an odd AD is dropped
+				if(natural_order = '1') then
+					AD(to_integer(unsigned(lenght_AD)) - 1 - to_integer(unsigned(AD_count))) <= swapsb(data_in(15 downto 8));
+					if(to_integer(unsigned(AD_count)) + 1 < to_integer(unsigned(lenght_AD))) then
+						AD(to_integer(unsigned(lenght_AD)) - 2 - to_integer(unsigned(AD_count))) <= swapsb(data_in(7 downto 0));
+					end if;
+				else
+					AD(to_integer(unsigned(AD_count))) <= swapsb(data_in(15 downto 8));
+					AD(to_integer(unsigned(AD_count)) + 1) <= swapsb(data_in(7 downto 0));
+				end if;
 				--report "AD: " & to_hstring((data_in(15 downto 8))) & " & " & to_hstring((data_in(7 downto 0)));
 		    	data_out <= (others => '0');
 		    	buffer_enable <= '0';
@@ -642,75 +848,30 @@ begin
 					state <= WAIT_AD;
 			    else
 			    	ad_count := std_logic_vector(to_unsigned(0, 10));
-			    	state <= WAIT_MSG;
+			    	if(encrypt_decrypt = '0' or last_packet = '0') then
+			    	    state <= TAG_STREAM;
+			    	else
+			    	    state <= WAIT_MAC_DECRYPTION;
+			    	end if;
 			    	-- AD_length || AD
 			    	--AD(7+(8*to_integer(unsigned(lenght_AD))) downto (8*to_integer(unsigned(lenght_AD)))) <= swapsb(lenght_AD);
 			    	AD(to_integer(unsigned(lenght_AD))) <= swapsb(lenght_AD);
 
 			    	if(set_init_core = '1') then
 					   --wc_to_wait_msg := 1+8+6+1+(to_integer(unsigned(lenght_AD))/2) ;
-					   wc_to_wait_msg := std_logic_vector(to_unsigned(16, 8) + unsigned(lenght_AD)/2);
+					   --an odd AD takes a whole word of the packet
+					   wc_to_wait_msg := std_logic_vector(to_unsigned(16, 8) + (unsigned(lenght_AD)+1)/2);
 					else
 					wc_to_wait_msg := std_logic_vector(to_unsigned(2, 8));
 					end if;
 			    end if;
-------------------READING MESSAGE------------------------------------------------------------			 
-			 WHEN WAIT_MSG =>
-                if(to_integer(unsigned(wc_count)) > to_integer(unsigned(wc_to_wait_msg)) + to_integer(unsigned(MSG_count))/2) then
-					buffer_enable <= '1';
-					address <= std_logic_vector(to_unsigned(to_integer(unsigned(MSG_count)/2) + to_integer(unsigned(msg_address_decode)), ADD_WIDTH));
-					data_out <= (others => '0'); 
-					rw <= '0';
-					interrupt <= '0';
-					error <= '0';
-					state <= ADDR_MSG;
-				else
-					state <= WAIT_MSG;
-				end if;
-
-			WHEN ADDR_MSG =>
-				state <= READ_MSG;
-
-			WHEN READ_MSG =>
-				
-					
-		    	data_out <= (others => '0');
-		    	buffer_enable <= '0';
-		    	address <= (others => '0');
-				rw <= '0';
-				interrupt <= '0';
-				error <= '0';
-				if(to_integer(unsigned(MSG_count)) < (to_integer(unsigned(lenght_submsg)))-1) then
-					Address_s <= MSG_count(4 downto 1);
-				Data_s <= swapsb(data_in(15 downto 8)) & swapsb(data_in(7 downto 0));
-				WE_s <= '1';
-				--report "MSG read: " & to_hstring(data_in) & " @ " & to_hstring(std_logic_vector(unsigned(MSG_count(4 downto 1))));	
-					MSG_count := std_logic_vector(to_unsigned(2, 10) + unsigned(MSG_count));
-					state <= WAIT_MSG;
-			    else
-					start_mac_address := MSG_Count;
-					MSG_count := std_logic_vector(to_unsigned(0, 10));
-					mac_count := std_logic_vector(to_unsigned(0, 8));
-			    	if(set_init_core = '1') then
-			    	    if(encrypt_decrypt = '0') then
-			    	        state <= INIT_CORE_IV;
-			    	    else
-			    	        state <= WAIT_MAC_DECRYPTION;
-			    	    end if;
-			    	else
-			    	    if(encrypt_decrypt = '0') then
-			    	        state <= CIPHER_NEXT_Z;
-			    	    else
-			    	        state <= WAIT_MAC_DECRYPTION;
-			    	    end if;
-			    	end if;
-			    end if;
-			    
-----------------READ FROM MSG FOR DECRYPTION----------------------
+----------------READ THE MAC FOR DECRYPTION----------------------
+			--the message itself goes through the pipeline once the core is ready
             WHEN WAIT_MAC_DECRYPTION =>
-                if(to_integer(unsigned(wc_count))> (to_integer(unsigned(wc_to_wait_msg)) + to_integer(unsigned(MSG_count))/2 )) then
+                --the MAC starts on the word after the message, the one of the trailing byte of an odd packet included
+                if(stream_mode = '1' or to_integer(unsigned(wc_count)) > to_integer(unsigned(wc_to_wait_msg)) + (to_integer(unsigned(lenght_submsg))+1)/2 + to_integer(unsigned(mac_count))) then
 					buffer_enable <= '1';
-					address <= std_logic_vector(to_unsigned(to_integer(unsigned(MSG_count))/2 + to_integer(unsigned(msg_address_decode) ), ADD_WIDTH));
+					address <= std_logic_vector(to_unsigned((to_integer(unsigned(lenght_submsg))+1)/2 + to_integer(unsigned(mac_count)) + to_integer(unsigned(msg_address_decode)), ADD_WIDTH));
 					data_out <= (others => '0'); 
 					rw <= '0';
 					interrupt <= '0';
@@ -724,29 +885,22 @@ begin
 				state <= READ_MAC_DECRYPTION;
 
 			WHEN READ_MAC_DECRYPTION =>
-				
-				
+				mac_from_message(15+(16*ordered(natural_order, to_integer(unsigned(mac_count)), 4)) downto 16*ordered(natural_order, to_integer(unsigned(mac_count)), 4)) <= swapsb(data_in(15 downto 8)) & swapsb(data_in(7 downto 0));
 		    	data_out <= (others => '0');
 		    	buffer_enable <= '0';
 		    	address <= (others => '0');
 				rw <= '0';
 				interrupt <= '0';
 				error <= '0';
-				if(to_integer(unsigned(MSG_count)) < to_integer(unsigned(start_mac_address)) + 8) then
-					Address_s <= std_logic_vector(unsigned(MSG_count(4 downto 1)) );	--Modified +4 to +8
-					Data_s <= swapsb(data_in(15 downto 8)) & swapsb(data_in(7 downto 0));
-					WE_s <= '1';
-					--report "MAC read: " & to_hstring(data_in) & " @ " & to_hstring(std_logic_vector(unsigned(MSG_count(4 downto 1)))) & " data_buffer@ " & to_hstring(std_logic_vector(to_unsigned(to_integer(unsigned(MSG_count))/2 + to_integer(unsigned(msg_address_decode)), ADD_WIDTH)));				
-					MSG_count := std_logic_vector(to_unsigned(2, 10) + unsigned(MSG_count));
-					mac_Count := std_logic_vector(to_unsigned(2, 8) + unsigned(mac_Count));
+				if(to_integer(unsigned(mac_count)) < 3) then
+					mac_count := std_logic_vector(to_unsigned(1, 8) + unsigned(mac_count));
 					state <= WAIT_MAC_DECRYPTION;
 			    else
-					MSG_count := std_logic_vector(to_unsigned(0, 10));
-					mac_Count := std_logic_vector(to_unsigned(0, 8));
+					mac_count := std_logic_vector(to_unsigned(0, 8));
 			    	if(set_init_core = '1') then
-			    		state <= INIT_CORE_IV;
+			    		state <= TAG_STREAM;
 			    	else
-			    		state <= CIPHER_NEXT_Z_1_DECRYPT;
+			    		state <= MSG_PIPE;
 			    	end if;
 			    end if;
 			    
@@ -816,7 +970,7 @@ begin
 		    			--core signals setup
 		    			data_16_in_c <= (others => '0');
 		    			data_16_addr_in_c <= (others => '0');
-		    			serial_data_in_c <= '0';
+		    			serial_data_in_c <= (others => '0');
 		    			-------------------------------------
 		    			state <= OP_INIT_CORE_PRE_OUTPUT;
 		    		else
@@ -835,7 +989,7 @@ begin
 				if(busy_c = '1') then
 					state <= WAIT_CORE_PRE_OUTPUT;
 				else
-				    pre_output_count := std_logic_vector(to_unsigned(1, 9) + unsigned(pre_output_count));
+				    pre_output_count := std_logic_vector(to_unsigned(GRAIN_PARALLEL, 9) + unsigned(pre_output_count));
 					state <= INIT_CORE_PRE_OUTPUT;
 				end if;
 ---------------------LOADING ACCUMULATOR-------------------------------------------------------
@@ -845,7 +999,7 @@ begin
 						operation_c <= NEXT_Z;
 						grain_round_c <= ADD_KEY;
 						start_c <= '1';
-						serial_data_in_c <= KEY(to_integer(unsigned(acc_count))/16)(to_integer(unsigned(acc_count)) mod 16);
+						serial_data_in_c <= key_bits(KEY, to_integer(unsigned(acc_count)));
 						state <= OP_INIT_CORE_ACC_NEXT_Z;
 					else
 						acc_count := std_logic_vector(to_unsigned(63, 10));
@@ -868,7 +1022,7 @@ begin
             
             WHEN WAIT_LATCH_CORE_ACC_NEXT_Z =>
                 if(completed_c = '1') then
-                    NEXT_Z_reg <= serial_data_out_c;
+                    z_buffer <= serial_data_out_c;
                     state <= INIT_CORE_ACC_LOAD;
                 else
                     state <= WAIT_LATCH_CORE_ACC_NEXT_Z;
@@ -879,7 +1033,7 @@ begin
 					start_c <= '1';
 					operation_c <= LOAD_AUTH_ACC;
 					grain_round_c <= ADD_KEY;
-					serial_data_in_c <= NEXT_Z_reg;
+					serial_data_in_c <= z_buffer;
 					state <= OP_INIT_CORE_ACC_LOAD;
 				else
 					state <= INIT_CORE_ACC_LOAD;
@@ -893,7 +1047,7 @@ begin
 				if(busy_c = '1') then
 					state <= WAIT_CORE_ACC_LOAD;
 				else
-					acc_count := std_logic_vector(unsigned(acc_count) - to_unsigned(1, 10));
+					acc_count := std_logic_vector(unsigned(acc_count) - to_unsigned(GRAIN_PARALLEL, 10));
 					state <= INIT_CORE_ACC_NEXT_Z;
 				end if;
 ------------------LOADING SHIFT REGISTER-----------------------------------------------------
@@ -904,11 +1058,12 @@ begin
 						grain_round_c <= ADD_KEY;
 						start_c <= '1';
 						--report "acc_count: " & integer'image(to_integer(unsigned(acc_count))) & " key[" & integer'image(to_integer(unsigned(acc_count))/16)& "][" & integer'image(to_integer(unsigned(acc_count)) mod 16) & "]";
-						serial_data_in_c <= KEY(to_integer(unsigned(acc_count))/16)(to_integer(unsigned(acc_count)) mod 16);
+						serial_data_in_c <= key_bits(KEY, to_integer(unsigned(acc_count)));
 						state <= OP_INIT_CORE_SR_NEXT_Z;
 					else
 						acc_count := std_logic_vector(to_unsigned(0, 10));
-						state <= TAG_NEXT_Z;
+						--lengths and AD of the INIT packet
+						state <= WAIT_LENGTH;
 					end if;
 				else
 					state <= INIT_CORE_SR_NEXT_Z;
@@ -927,7 +1082,7 @@ begin
             
             WHEN WAIT_LATCH_CORE_SR_NEXT_Z =>
                 if(completed_c = '1') then
-                    NEXT_Z_reg <= serial_data_out_c;
+                    z_buffer <= serial_data_out_c;
                     state <= INIT_CORE_SR_LOAD;
                 else
                     state <= WAIT_LATCH_CORE_SR_NEXT_Z;
@@ -938,7 +1093,7 @@ begin
 					start_c <= '1';
 					operation_c <= LOAD_AUTH_SR;
 					grain_round_c <= ADD_KEY;
-					serial_data_in_c <= NEXT_Z_reg;
+					serial_data_in_c <= z_buffer;
 					state <= OP_INIT_CORE_SR_LOAD;
 				else
 					state <= INIT_CORE_SR_LOAD;
@@ -952,385 +1107,120 @@ begin
 				if(busy_c = '1') then
 					state <= WAIT_CORE_SR_LOAD;
 				else
-					acc_count := std_logic_vector(unsigned(acc_count) - to_unsigned(1, 10));
+					acc_count := std_logic_vector(unsigned(acc_count) - to_unsigned(GRAIN_PARALLEL, 10));
 					state <= INIT_CORE_SR_NEXT_Z;
 				end if;
 ---------------ACCUMULATE TAG--------------------------------------------------------------------
-			WHEN TAG_NEXT_Z =>
-				if(completed_c = '1') then
-					if(to_integer(unsigned(tag_count)) < (to_integer(unsigned(lenght_AD) + 1)*2*8)) then
-						start_c <= '1';
-						operation_c <= NEXT_Z;
-						grain_round_c <= NORMAL;
-						serial_data_in_c <= '0';
-						state <= OP_TAG_NEXT_Z;
+			--DER length of the AD, then the AD: two bytes per clock through the stream of the core, the last one alone
+			WHEN TAG_STREAM =>
+				if(to_integer(unsigned(tag_count)) < to_integer(unsigned(lenght_AD)) + 1) then
+					stream_en_c <= '1';
+					stream_decrypt_c <= '0';
+					if(to_integer(unsigned(tag_count)) < to_integer(unsigned(lenght_AD))) then
+						stream_half_c <= '0';
+						stream_data_in_c <= AD(to_integer(unsigned(lenght_AD)) - to_integer(unsigned(tag_count))) &
+						                    AD(to_integer(unsigned(lenght_AD)) - to_integer(unsigned(tag_count)) - 1);
+						tag_count := std_logic_vector(unsigned(tag_count) + to_unsigned(2, 10));
 					else
-						tag_count := std_logic_vector(to_unsigned(0, 10));
-						ad_count  := std_logic_vector(to_unsigned(0, 10));
-						if(encrypt_decrypt = '0') then
-						  state <= CIPHER_NEXT_Z;
-						else
-						  state <= CIPHER_NEXT_Z_1_DECRYPT;
-					    end if;
+						stream_half_c <= '1';
+						stream_data_in_c <= AD(to_integer(unsigned(lenght_AD)) - to_integer(unsigned(tag_count))) & x"00";
+						tag_count := std_logic_vector(unsigned(tag_count) + to_unsigned(1, 10));
 					end if;
+					state <= TAG_STREAM;
 				else
-					state <= TAG_NEXT_Z;
-				end if;
-            
-            WHEN OP_TAG_NEXT_Z =>
-                state <= WAIT_TAG_NEXT_Z;
-            
-			WHEN WAIT_TAG_NEXT_Z =>
-				start_c <= '0';
-				if(busy_c = '1') then
-					state <= WAIT_TAG_NEXT_Z;
-				else
-					state <= WAIT_LATCH_TAG_NEXT_Z;
+					stream_en_c <= '0';
+					tag_count := std_logic_vector(to_unsigned(0, 10));
+					state <= MSG_PIPE;
 				end if;
-            
-            WHEN WAIT_LATCH_TAG_NEXT_Z =>
-                if(completed_c = '1') then
-                    NEXT_Z_reg <= serial_data_out_c;
-                    state <= TAG_ACCUMULATE;
-                else
-                    state <= WAIT_LATCH_TAG_NEXT_Z;
-                end if;
-            
-			WHEN TAG_ACCUMULATE =>
-				if(completed_c = '1') then
-					if( ( (to_integer(unsigned(tag_count)))mod 2) = 0 ) then
-					       state <= WAIT_TAG_LOAD_SR;
-				    else
-						if(AD  ( ( to_integer(unsigned(lenght_AD)) - to_Integer(unsigned(AD_count))/8))  ( 7 - to_integer(unsigned(AD_count)) mod 8)  = '1') then
-						
-                            start_c <= '1';
-                            operation_c <= ACCUMULATE;
-                            state <= OP_TAG_ACCUMULATE;
-                        else
-                            start_c <= '0';
-                            state <= TAG_LOAD_SR;
-                        end if;
-                        ad_count := std_logic_vector(unsigned(ad_count) + to_unsigned(1, 10));
+
+--------------ENCRYPTION/DECRYPTION-----------------------------------------------
+			--read, cipher and write back overlap: every clock the data buffer takes either a word of the write-back
+			--FIFO or a read for the prefetch FIFO, the core takes the next prefetched word through its stream and
+			--its output enters the write-back FIFO the clock after. The trailing byte of an odd packet goes through
+			--the stream alone, in the upper half of the last word written back
+			WHEN MSG_PIPE =>
+				msg_words := (to_integer(unsigned(lenght_submsg)) + 1)/2;
+				if(write_count = msg_words and ct_count = msg_words) then
+					buffer_enable <= '0';
+					address <= (others => '0');
+					rw <= '0';
+					fetch_count := 0;
+					fetched_count := 0;
+					cipher_count := 0;
+					ct_count := 0;
+					write_count := 0;
+					--the padding bit and the tag only close the last packet
+					if(last_packet = '1') then
+						state <= PAD_STREAM;
+					else
+						state <= UPDATE_STATE;
 					end if;
 				else
-					state <= TAG_ACCUMULATE;
-				end if;
-            
-            WHEN OP_TAG_ACCUMULATE =>
-                state <= WAIT_TAG_ACCUMULATE;
-            
-			WHEN WAIT_TAG_ACCUMULATE =>
-				start_c <= '0';
-				if(busy_c = '1') then
-					state <= WAIT_TAG_ACCUMULATE;
-				else
-					state <= TAG_LOAD_SR;
-				end if;
-			
-			WHEN TAG_LOAD_SR =>
-			     if(completed_c = '1') then
-			         start_c <= '1';
-			         operation_c <= LOAD_AUTH_SR;
-			         serial_data_in_c <= NEXT_Z_reg;
-			         state <= OP_TAG_LOAD_SR;
-			     else 
-			         state <= TAG_LOAD_SR;
-			     end if;
-			
-			WHEN OP_TAG_LOAD_SR =>
-			     state <= WAIT_TAG_LOAD_SR;
-			    
-			WHEN WAIT_TAG_LOAD_SR =>
-			     start_c <= '0';
-			     if(busy_c = '1')then
-			         state <= WAIT_TAG_LOAD_SR;
-			     else
-			         tag_count := std_logic_vector(unsigned(tag_count) + to_unsigned(1, 10));
-			         state <= TAG_NEXT_Z;
-			     end if;
-			
---------------ENCRYPTION-----------------------------------------------
-			WHEN CIPHER_NEXT_Z =>
-				if(completed_c = '1') then
-					if(to_integer(unsigned(crypt_count)) < to_integer(unsigned(lenght_submsg))*2*8 ) then
-						start_c <= '1';
-						operation_c <= NEXT_Z;
-						grain_round_c <= NORMAL;
-						serial_data_in_c <= '0';
-						state <= OP_CIPHER_NEXT_Z;
+					--data buffer: the write-back FIFO first, so that the core is never held by a full FIFO for long
+					fetch_issue := '0';
+					word_index := ordered(not natural_order, fetch_count, msg_words);
+					if(write_count < ct_count) then
+						data_out <= swapsb(ct_fifo(write_count mod PIPE_DEPTH)(15 downto 8)) & swapsb(ct_fifo(write_count mod PIPE_DEPTH)(7 downto 0));
+						buffer_enable <= '1';
+						address <= std_logic_vector(to_unsigned(ordered(not natural_order, write_count, msg_words) + to_integer(unsigned(msg_address_decode)), ADD_WIDTH));
+						rw <= '1';
+						write_count := write_count + 1;
+					elsif(fetch_count < msg_words and fetch_count - cipher_count < PIPE_DEPTH and
+					      (stream_mode = '1' or to_integer(unsigned(wc_count)) > to_integer(unsigned(wc_to_wait_msg)) + word_index)) then
+						data_out <= (others => '0');
+						buffer_enable <= '1';
+						address <= std_logic_vector(to_unsigned(word_index + to_integer(unsigned(msg_address_decode)), ADD_WIDTH));
+						rw <= '0';
+						fetch_issue := '1';
+						fetch_count := fetch_count + 1;
 					else
-						crypt_count := std_logic_vector(to_unsigned(0, 10));
-						msg_count := std_logic_vector(to_unsigned(0, 10));
-						ac_count := std_logic_vector(to_unsigned(0, 10));
-						state <= GENERATE_USELESS_NEXT_Z;
+						buffer_enable <= '0';
+						rw <= '0';
 					end if;
-				else
-					state <= CIPHER_NEXT_Z;
-				end if;
-            
-            WHEN OP_CIPHER_NEXT_Z =>
-                state <= WAIT_CIPHER_NEXT_Z;
-            
-			WHEN WAIT_CIPHER_NEXT_Z =>
-				start_c <= '0';
-				if(busy_c = '1') then
-					state <= WAIT_CIPHER_NEXT_Z;
-				else
-					state <= WAIT_LATCH_CIPHER_NEXT_Z;
-				end if;
-				
-			WHEN WAIT_LATCH_CIPHER_NEXT_Z =>
-                if(completed_c = '1') then
-                    NEXT_Z_reg <= serial_data_out_c;
-                    state <= WAIT_LATCH_RAM_ENCRYPT;
-					
-					next_z_addressing := std_logic_vector("00"&(unsigned(lenght_submsg)/2) - 1 - unsigned(MSG_count(7 downto 4)));
-					Address_s <= next_z_addressing(3 downto 0);
-					
-					
-                else
-                    state <= WAIT_LATCH_CIPHER_NEXT_Z;
-                end if;
-				
-			WHEN WAIT_LATCH_RAM_ENCRYPT =>
-				state <= CIPHER_ACCUMULATE;
-			
+					error <= '0';
 
-			WHEN CIPHER_ACCUMULATE =>
-				if(completed_c = '1') then
-					if((to_integer(Unsigned(crypt_count)) mod 2) = 0) then
-						serial_data_ct((15 - to_integer(unsigned(ac_count))mod 16)) <= Q_s(15 -to_integer(unsigned(msg_count))mod 16) xor NEXT_Z_reg;
-						msg_count := std_logic_vector(unsigned(msg_count) + to_unsigned(1, 10));
-						state <= WAIT_CIPHER_LOAD_SR;
-					else
-						if(Q_s(15 -to_integer(unsigned(ac_count))mod 16) = '1') then 
-							operation_c <= ACCUMULATE;
-							start_c <= '1';
-							state <= OP_CIPHER_ACCUMULATE;
+					--core: the next prefetched word, if the write-back FIFO has room for its output
+					if(cipher_count < fetched_count and cipher_count - write_count < PIPE_DEPTH) then
+						stream_en_c <= '1';
+						stream_decrypt_c <= encrypt_decrypt;
+						stream_data_in_c <= msg_fifo(cipher_count mod PIPE_DEPTH);
+						if(2*cipher_count + 1 = to_integer(unsigned(lenght_submsg))) then
+							stream_half_c <= '1';
 						else
-						    state <= CIPHER_LOAD_SR; 
-						end if;
-						ac_count := std_logic_vector(unsigned(ac_count) + to_unsigned(1, 10));
-
-						if( (to_integer(unsigned(ac_count)) mod 16) = 0 and (to_integer(unsigned(ac_count)))  > 0) then
-								WE_ct <= '1';
-								ct_ram_addressing := std_logic_vector("00"&(unsigned(lenght_submsg)/2) - unsigned(MSG_count(7 downto 4)));
-								address_ct <= ct_ram_addressing(3 downto 0);
-								data_ct <= serial_data_ct;
+							stream_half_c <= '0';
 						end if;
+						cipher_count := cipher_count + 1;
+					else
+						stream_en_c <= '0';
+					end if;
 
+					--output of the word the core takes in this clock
+					if(stream_en_c = '1') then
+						ct_fifo(ct_count mod PIPE_DEPTH) <= stream_data_out_c;
+						ct_count := ct_count + 1;
 					end if;
-				else
-					state <= CIPHER_ACCUMULATE;
-				end if;
-            
-            WHEN OP_CIPHER_ACCUMULATE =>
-                state <= WAIT_CIPHER_ACCUMULATE;
-                 
-			WHEN WAIT_CIPHER_ACCUMULATE =>
-				start_c <= '0';
-				if(busy_c = '1') then
-					state <= WAIT_CIPHER_ACCUMULATE;
-				else
-					state <= CIPHER_LOAD_SR;
-				end if;
 
-			WHEN CIPHER_LOAD_SR =>
-				if(completed_c = '1') then
-					operation_c <= LOAD_AUTH_SR;
-					serial_data_in_c <= NEXT_Z_reg;
-					start_c <= '1';
-					state  <= OP_CIPHER_LOAD_SR;
-				else
-					state <= CIPHER_LOAD_SR;
-				end if;
-            
-            WHEN OP_CIPHER_LOAD_SR =>
-                state <= WAIT_CIPHER_LOAD_SR;
-            
-			WHEN WAIT_CIPHER_LOAD_SR =>
-				start_c <= '0';
-				if(busy_c = '1') then
-					state <= WAIT_CIPHER_LOAD_SR;
-				else
-					crypt_count := std_logic_vector(unsigned(crypt_count) + to_unsigned(1, 10));
-					state <= CIPHER_NEXT_Z;
-				end if;
-				
---------------DECRYPTION-----------------------------------------------
-			WHEN CIPHER_NEXT_Z_1_DECRYPT=>
-			     if(completed_c = '1') then
-					if(to_integer(unsigned(crypt_count)) < to_integer(unsigned(lenght_submsg))*8 ) then
-						start_c <= '1';
-						operation_c <= NEXT_Z;
-						grain_round_c <= NORMAL;
-						serial_data_in_c <= '0';
-						state <= OP_CIPHER_NEXT_Z_1_DECRYPT;
-					else
-						crypt_count := std_logic_vector(to_unsigned(0, 10));
-						ac_count := std_logic_vector(to_unsigned(0, 10));
-						msg_count := std_logic_vector(to_unsigned(0, 10));
-						state <= GENERATE_USELESS_NEXT_Z;
+					--the data buffer answers a read two clocks later
+					if(fetch_pending(1) = '1') then
+						msg_fifo(fetched_count mod PIPE_DEPTH) <= swapsb(data_in(15 downto 8)) & swapsb(data_in(7 downto 0));
+						fetched_count := fetched_count + 1;
 					end if;
-				else
-					state <= CIPHER_NEXT_Z_1_DECRYPT;
+					fetch_pending <= fetch_pending(0) & fetch_issue;
 				end if;
-				
-			WHEN OP_CIPHER_NEXT_Z_1_DECRYPT =>
-			     state <= WAIT_CIPHER_NEXT_Z_1_DECRYPT;
-			
-			WHEN WAIT_CIPHER_NEXT_Z_1_DECRYPT =>
-                start_c <= '0';
-                if(busy_c = '1') then
-                    state <= WAIT_CIPHER_NEXT_Z_1_DECRYPT;
-                else
-                    state <= WAIT_LATCH_CIPHER_NEXT_Z_1_DECRYPT;
-                end if;
-                
-			WHEN WAIT_LATCH_CIPHER_NEXT_Z_1_DECRYPT =>
-			     if(completed_c = '1') then
-                    NEXT_Z_reg <= serial_data_out_c;
-                    state <= WAIT_LATCH_RAM_DECRYPT;
-                 else
-                    state <= WAIT_LATCH_CIPHER_NEXT_Z_1_DECRYPT;
-					
-					 next_z_addressing := std_logic_vector("00"&(unsigned(lenght_submsg)/2) - 1 - unsigned(ac_count(7 downto 4)));
-					 Address_s <= next_z_addressing(3 downto 0);
-						
-					 --Address_s <= std_logic_vector(unsigned(lenght_submsg) - 1 - unsigned(ac_count(7 downto 4)));
-					 
-                 end if; 
-			
-			WHEN WAIT_LATCH_RAM_DECRYPT =>
-				state <= CIPHER_NEXT_Z_2_DECRYPT;
-			
-			WHEN CIPHER_NEXT_Z_2_DECRYPT =>
-			     if(completed_c = '1') then
-			            --CT(to_integer(unsigned(lenght_submsg))*8 - 1 - ac_count) <= MSG(to_integer(unsigned(lenght_submsg))*8 - 1 - ac_count) xor NEXT_Z_reg;
-						--CT(((to_integer(unsigned(lenght_submsg))) - 1 - to_integer(unsigned(ac_count))/8 ))(7 - to_integer(unsigned(ac_count))mod 8) <= Q_s(15 -to_integer(unsigned(ac_count))mod 16) xor NEXT_Z_reg;
-						serial_data_ct((15 - to_integer(unsigned(ac_count))mod 16)) <= Q_s(15 -to_integer(unsigned(ac_count))mod 16) xor NEXT_Z_reg;
-						start_c <= '1';
-						operation_c <= NEXT_Z;
-						grain_round_c <= NORMAL;
-						serial_data_in_c <= '0';
-						state <= OP_CIPHER_NEXT_Z_2_DECRYPT;
-				 else
-					state <= CIPHER_NEXT_Z_2_DECRYPT;
-				 end if;
-			
-			WHEN OP_CIPHER_NEXT_Z_2_DECRYPT =>
-			     state <= WAIT_CIPHER_NEXT_Z_2_DECRYPT;
-			     
-			WHEN WAIT_CIPHER_NEXT_Z_2_DECRYPT =>
-			      start_c <= '0';
-                  if(busy_c = '1') then
-                    state <= WAIT_CIPHER_NEXT_Z_2_DECRYPT;
-                  else
-                    state <= WAIT_LATCH_CIPHER_NEXT_Z_2_DECRYPT;
-                  end if;
-                  
-			WHEN WAIT_LATCH_CIPHER_NEXT_Z_2_DECRYPT =>
-			      if(completed_c = '1') then
-                    NEXT_Z_reg <= serial_data_out_c;
-                    if(serial_data_ct((15 - to_integer(unsigned(ac_count))mod 16)) = '1') then
-					--if(CT(((to_integer(unsigned(lenght_submsg))) - 1 - to_integer(unsigned(ac_count))/8 ))(7 - to_integer(unsigned(ac_count))mod 8) = '1') then
-                        operation_c <= ACCUMULATE;
-                        start_c <= '1';
-                        state <= OP_CIPHER_ACCUMULATE_DECRYPT;
-                    else
-                        state <= CIPHER_LOAD_SR_DECRYPT;
-                    end if;
-                  else
-                    state <= WAIT_LATCH_CIPHER_NEXT_Z_2_DECRYPT;
-                  end if;
-			
-			
-			--WHEN CIPHER_ACCUMULATE_DECRYPT =>
-			WHEN OP_CIPHER_ACCUMULATE_DECRYPT =>
-			     state <= WAIT_CIPHER_ACCUMULATE_DECRYPT;
-			     
-			WHEN WAIT_CIPHER_ACCUMULATE_DECRYPT =>
-			     start_c <= '0';
-				  if(busy_c = '1') then
-					state <= WAIT_CIPHER_ACCUMULATE_DECRYPT;
-				  else
-					state <= CIPHER_LOAD_SR_DECRYPT;
-				  end if;
-				  
-			WHEN CIPHER_LOAD_SR_DECRYPT =>
-			     if(completed_c = '1') then
-					operation_c <= LOAD_AUTH_SR;
-					serial_data_in_c <= NEXT_Z_reg;
-					start_c <= '1';
-					state  <= OP_CIPHER_LOAD_SR_DECRYPT;
-				  else
-					state <= CIPHER_LOAD_SR_DECRYPT;
-				  end if;
-			
-			WHEN OP_CIPHER_LOAD_SR_DECRYPT =>
-			     state <= WAIT_CIPHER_LOAD_SR_DECRYPT;
-			     
-			WHEN WAIT_CIPHER_LOAD_SR_DECRYPT=>
-			     start_c <= '0';
-				  if(busy_c = '1') then
-					state <= WAIT_CIPHER_LOAD_SR_DECRYPT;
-				  else
-				 	crypt_count := std_logic_vector(unsigned(crypt_count) + to_unsigned(1, 10));
-					ac_count := std_logic_vector(unsigned(ac_count) + to_unsigned(1, 10));
-					if( (to_integer(unsigned(ac_count)) mod 16) = 0 and (to_integer(unsigned(ac_count)))  > 0) then
-								WE_ct <= '1';
-								ct_ram_addressing := std_logic_vector("00"&(unsigned(lenght_submsg)/2) - unsigned(ac_count(7 downto 4)));
-								
-								address_ct <= ct_ram_addressing(3 downto 0);
-								data_ct <= serial_data_ct;
-					end if;
 
-					state <= CIPHER_NEXT_Z_1_DECRYPT;
-				  end if;
-			
 ---------------------PREPARE OUTPUT-----------------------------------------------
-			WHEN GENERATE_USELESS_NEXT_Z =>
-				if(completed_c = '1') then
-					operation_c <= NEXT_Z;
-					grain_round_c <= NORMAL;
-					serial_data_in_c <= '0';
-					start_c <= '1';
-					state <= OP_USELESS_NEXT_Z;
-				else
-					state <= GENERATE_USELESS_NEXT_Z;
-				end if;
-            
-            WHEN OP_USELESS_NEXT_Z =>
-                state <= WAIT_USELESS_NEXT_Z;
-                
-			WHEN WAIT_USELESS_NEXT_Z =>
-				start_c <= '0';
-				if(busy_c = '1') then
-					state <= WAIT_USELESS_NEXT_Z;
-				else
-					state <= USELESS_ACCUMULATE;
-				end if;
+			--padding bit of the message: accumulated, its keystream bits are not used; the zeros after it in the byte
+			--only shift the authentication register, which is not read again
+			WHEN PAD_STREAM =>
+				stream_en_c <= '1';
+				stream_half_c <= '1';
+				stream_decrypt_c <= '0';
+				stream_data_in_c <= x"8000";
+				state <= PAD_STREAM_END;
 
-			WHEN USELESS_ACCUMULATE =>
-				if(completed_c = '1') then
-					start_c <= '1';
-					operation_c <= ACCUMULATE;
-					state <= OP_USELESS_ACCUMULATE;
-				else 
-					state <= USELESS_ACCUMULATE;
-				end if;
-            
-            WHEN OP_USELESS_ACCUMULATE =>
-                state <= WAIT_USELESS_ACCUMULATE;
-                
-			WHEN WAIT_USELESS_ACCUMULATE =>
-				start_c <= '0';
-				if(busy_c = '1') then
-					state <= WAIT_USELESS_ACCUMULATE;
-				else
-					
-					state <= GET_MAC;
-				end if;
+			WHEN PAD_STREAM_END =>
+				stream_en_c <= '0';
+				state <= GET_MAC;
 ----------------------GET THE MAC FROM THE CIPHER--------------------------------------------------------
 			WHEN GET_MAC =>
 				if(completed_c = '1') then
@@ -1339,12 +1229,10 @@ begin
 						data_16_addr_in_c <= std_logic_vector(to_unsigned(to_integer(unsigned(mac_count)), 3));
 						start_c <= '1';
 						state <= OP_GET_MAC;
-						Address_s <= std_logic_vector(to_unsigned(to_integer((unsigned(lenght_submsg))/2) + to_integer(unsigned(mac_count)), 4));
-						
 					else    
 						mac_count := std_logic_vector(to_unsigned(0, 8));
 						if(encrypt_decrypt = '0') then
-						  state <= LOAD_CT_RAM;
+						  state <= WRITE_MAC;
 						else
 						  state <= COMPARE_MAC; 
 						end if;
@@ -1354,8 +1242,6 @@ begin
 				end if;
              
             WHEN OP_GET_MAC =>
-				mac_from_message(15+(16*to_integer(unsigned(mac_count))) downto 16*to_integer(unsigned(mac_count))) <= Q_s;
-				
                 state <= WAIT_GET_MAC;
                 
 			WHEN WAIT_GET_MAC =>
@@ -1382,75 +1268,58 @@ begin
             WHEN COMPARE_MAC =>
                 if(TAG = MAC_from_message)then
 					-- authenticated
+					state <= WRITE_MAC;
 				 else
-					reset_ct <= '1';
+					auth_fail <= '1';
+					TAG <= (others => '0');
+					state <= ZERO_OUTPUT;
 				 end if;
-                state <= LOAD_CT_RAM;      
 
------------------WRITE THE MESSAGE ENCRYPTED/DECRYPTED IN OUTPUT---------------------------------------------------
-			
-			WHEN LOAD_CT_RAM =>
-				Address_ct <= std_logic_vector(to_unsigned(to_integer(unsigned(crypt_count))/2, 4));
-				state <= WAIT_LOAD_CT_RAM;
-			
-			WHEN WAIT_LOAD_CT_RAM =>
-				state <= WRITE_CT;
-			
-			WHEN WRITE_CT =>
-				if(completed_c = '1') then
-					if(to_integer(unsigned(crypt_count)) < to_integer(unsigned(lenght_submsg))) then
-						data_out <= swapsb(Q_ct(15 downto 8)) & swapsb(Q_ct(7 downto 0));
-						
-						
-						
-						buffer_enable <= '1';
-						address <= std_logic_vector(to_unsigned(to_integer(unsigned(crypt_count))/2 + to_integer(unsigned(msg_address_decode)), ADD_WIDTH));
-						rw <= '1';
-						error <= '0';
-						state <= OP_WRITE_CT;
-					else
-						crypt_count := std_logic_vector(to_unsigned(0, 10));
-						state <= WRITE_MAC;
-					end if;
-				else
-					state <= WRITE_CT;
-				end if;
-            
-            WHEN OP_WRITE_CT =>
-                state <= WAIT_WRITE_CT;
-                
-			WHEN WAIT_WRITE_CT =>
-				if(enable = '1') then
-					data_out <= swapsb(Q_ct(15 downto 8)) & swapsb(Q_ct(7 downto 0));
+			--tag mismatch: the plaintext already written back by MSG_PIPE is overwritten with zeros, a word per clock,
+			--and the tag written after it is zero as well: the CPU gets nothing but the FAIL status word
+			WHEN ZERO_OUTPUT =>
+				msg_words := (to_integer(unsigned(lenght_submsg)) + 1)/2;
+				if(write_count < msg_words) then
 					buffer_enable <= '1';
-					address <= std_logic_vector(to_unsigned(to_integer(unsigned(crypt_count))/2 + to_integer(unsigned(msg_address_decode)), ADD_WIDTH));
 					rw <= '1';
+					--the words MSG_PIPE has written back, in its order
+					address <= std_logic_vector(to_unsigned(ordered(not natural_order, write_count, msg_words) + to_integer(unsigned(msg_address_decode)), ADD_WIDTH));
+					data_out <= (others => '0');
 					error <= '0';
-					crypt_count := std_logic_vector(to_unsigned(2, 10) + unsigned(crypt_count));
-					state <= LOAD_CT_RAM;
+					write_count := write_count + 1;
+					state <= ZERO_OUTPUT;
 				else
-					state <= WAIT_WRITE_CT;
+					buffer_enable <= '0';
+					rw <= '0';
+					write_count := 0;
+					state <= WRITE_MAC;
 				end if;
+
 -----------------WRITE MAC--------------------------------------            
 			WHEN WRITE_MAC =>
 				if(completed_c = '1') then
 					if(to_integer(unsigned(mac_count)) = 0) then
 						buffer_enable <= '1';
 						rw <= '1';
-						address <= std_logic_vector(to_unsigned(to_integer(unsigned(mac_count)) + 40, ADD_WIDTH));
+						address <= std_logic_vector(to_unsigned(ordered(natural_order, to_integer(unsigned(mac_count)), 4) + 40, ADD_WIDTH));
 						data_out <= swapsb(TAG((15+(16*to_integer(unsigned(mac_count)))) downto 8+(16*to_integer(unsigned(mac_count))))) & swapsb(TAG((7+(16*to_integer(unsigned(mac_count)))) downto (16*to_integer(unsigned(mac_count)))));
 						error <= '0';
 						state <= OP_WRITE_MAC;
 					elsif(to_integer(unsigned(mac_count)) > 0 and to_integer(unsigned(mac_count)) < 4) then
 						buffer_enable <= '1';
 						rw <= '1';
-						address <= std_logic_vector(to_unsigned(to_integer(unsigned(mac_count)) + 40, ADD_WIDTH));
+						address <= std_logic_vector(to_unsigned(ordered(natural_order, to_integer(unsigned(mac_count)), 4) + 40, ADD_WIDTH));
 						data_out <= swapsb(TAG((15+(16*to_integer(unsigned(mac_count)))) downto 8+(16*to_integer(unsigned(mac_count))))) & swapsb(TAG((7+(16*to_integer(unsigned(mac_count)))) downto (16*to_integer(unsigned(mac_count)))));
 						error <= '0';
 						state <= OP_WRITE_MAC;
 					else
 						mac_count := std_logic_vector(to_unsigned(0, 8));
-						state <= UPDATE_STATE;
+						--the last status word of the transaction comes after the performance counters
+						if(batch_mode = '0' or batch_last = '1') then
+							state <= WRITE_PERF;
+						else
+							state <= UPDATE_STATE;
+						end if;
 					end if;
 				else
 					state <= WRITE_MAC;
@@ -1459,11 +1328,12 @@ begin
             WHEN OP_WRITE_MAC =>
                 state <= WAIT_WRITE_MAC;
                 
+			--in interrupt mode the CPU may have closed the transaction already: the tag is written all the same
 			WHEN WAIT_WRITE_MAC =>
-				if(enable = '1') then
+				if(enable = '1' or irq_mode = '1') then
 					data_out <= swapsb(TAG((15+(16*to_integer(unsigned(mac_count)))) downto 8+(16*to_integer(unsigned(mac_count))))) & swapsb(TAG((7+(16*to_integer(unsigned(mac_count)))) downto (16*to_integer(unsigned(mac_count)))));
 					buffer_enable <= '1';
-					address <= std_logic_vector(to_unsigned(to_integer(unsigned(mac_count)) + 40, ADD_WIDTH));
+					address <= std_logic_vector(to_unsigned(ordered(natural_order, to_integer(unsigned(mac_count)), 4) + 40, ADD_WIDTH));
 					rw <= '1';
 					error <= '0';
 					mac_count := std_logic_vector(to_unsigned(1, 8) + unsigned(mac_count));
@@ -1471,12 +1341,37 @@ begin
 				else
 					state <= WAIT_WRITE_MAC;
 				end if;				
+-----------------WRITE PERFORMANCE COUNTERS---------------------
+			--a word per clock, from PERF_ADDR
+			WHEN WRITE_PERF =>
+				if(to_integer(unsigned(perf_count)) < 2*PERF_PHASES) then
+					buffer_enable <= '1';
+					rw <= '1';
+					address <= std_logic_vector(to_unsigned(PERF_ADDR + to_integer(unsigned(perf_count)), ADD_WIDTH));
+					if(perf_count(0) = '0') then
+						data_out <= std_logic_vector(perf(to_integer(unsigned(perf_count))/2)(15 downto 0));
+					else
+						data_out <= std_logic_vector(perf(to_integer(unsigned(perf_count))/2)(31 downto 16));
+					end if;
+					error <= '0';
+					perf_count := std_logic_vector(unsigned(perf_count) + to_unsigned(1, 8));
+					state <= WRITE_PERF;
+				else
+					buffer_enable <= '0';
+					rw <= '0';
+					perf_count := std_logic_vector(to_unsigned(0, 8));
+					state <= UPDATE_STATE;
+				end if;
 ----------------UPDATE STATE------------------------------------
             when UPDATE_STATE =>
 				buffer_enable <= '1';
 				rw <= '1';
-				address <= std_logic_vector(to_unsigned(63, ADD_WIDTH));
-				data_out <= x"FFFF";
+				address <= std_logic_vector(to_unsigned(BANK_STATUS_ADDR, ADD_WIDTH));
+				if(auth_fail = '1') then
+					data_out <= BANK_FAIL;
+				else
+					data_out <= BANK_DONE;
+				end if;
 				interrupt <= '0';
 				error <= '0';
 				state <= CLEAR_ALL;
@@ -1487,7 +1382,34 @@ begin
 				address <= (others => '0');
 				rw <= '0';
 				error <= '0';
-				state <= DONE;
+				if(batch_mode = '1' and batch_last = '0') then
+					-- go on with the next descriptor of the batch, again an init packet
+					cur_bank <= cur_bank + 1;
+					state <= WAIT_BANK;
+				elsif(stream_mode = '1' and last_packet = '0') then
+					-- go on with the next bank of the ring as a message packet
+					cur_bank <= cur_bank + 1;
+					set_init_core <= '0';
+					msg_address_decode := std_logic_vector(to_unsigned(2, 8));
+					lenght_adress_decode := std_logic_vector(to_unsigned(1, 8));
+					state <= WAIT_BANK;
+				elsif(irq_mode = '1') then
+					interrupt <= '1';
+					state <= WAIT_ACK;
+				else
+					state <= DONE;
+				end if;
+
+			--interrupt mode: the CPU may have closed the transaction once the packet was written, the request
+			--is forwarded by the IP manager and held until the CPU acknowledges it, which enables the core again.
+			--The results and the status word are already in the data buffer
+			WHEN WAIT_ACK =>
+				if(enable = '1' and ack = '1') then
+					interrupt <= '0';
+					state <= DONE;
+				else
+					state <= WAIT_ACK;
+				end if;
 
 			WHEN DONE =>
 				if(enable = '0') then
@@ -1501,4 +1423,7 @@ begin
 			end case;
 	end if;
 end process;
+
+bank <= std_logic_vector(cur_bank);
+
 end Behavioral;
\ No newline at end of file
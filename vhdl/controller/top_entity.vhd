@@ -49,16 +49,17 @@ architecture STRUCTURAL of TOP_ENTITY is
 	--Signals between the buffer and the ip manager
 	signal	row_0			  	: std_logic_vector(DATA_WIDTH-1 downto 0); 
 	signal	ipm_to_buf_data		: std_logic_vector(DATA_WIDTH-1 downto 0);
-	signal	buf_to_ipm_data		: std_logic_vector(DATA_WIDTH-1 downto 0);	
 	signal	ipm_addr     		: std_logic_vector(ADD_WIDTH-1 downto 0);
 	signal	ipm_rw				: std_logic;
 	signal	ipm_buf_enable		: std_logic;
 	signal  cpu_read_completed 	: std_logic;
 	signal  cpu_write_completed : std_logic;
-	--Signals between the IP manager and the various IP cores
-	signal	ip_to_ipm_data      	 : data_array; 
-	signal	ipm_to_ip_data    		 : data_array;     
+	--Signals between the buffer and the various IP cores
+	signal	ip_to_buf_data      	 : data_array; 
+	signal	buf_to_ip_data    		 : data_array;     
 	signal	addr_ip         		 : addr_array;            
+	signal	bank_ip         		 : bank_array;            
+	--Signals between the IP manager and the various IP cores
 	signal	opcode_ip	    		 : opcode_array;  
 	signal	int_pol_ip				 : std_logic_vector(NUM_IPS-1 downto 0);              
 	signal	rw_ip		    		 : std_logic_vector(NUM_IPS-1 downto 0);    
@@ -91,10 +92,15 @@ begin
 			cpu_nwe             => cpu_fpga_bus_nwe,
 			cpu_ne1             => cpu_fpga_bus_ne1,
 			ipm_data_in         => ipm_to_buf_data,
-			ipm_data_out        => buf_to_ipm_data,
 			ipm_addr            => ipm_addr,
 			ipm_rw              => ipm_rw,
 			ipm_enable          => ipm_buf_enable,
+			ip_data_in          => ip_to_buf_data,
+			ip_data_out         => buf_to_ip_data,
+			ip_addr             => addr_ip,
+			ip_bank             => bank_ip,
+			ip_rw               => rw_ip,
+			ip_enable           => buf_enable_ip,
 			cpu_read_completed  => cpu_read_completed,
 			cpu_write_completed => cpu_write_completed
 		);
@@ -106,20 +112,14 @@ begin
 			interrupt              => cpu_fpga_int_n,			
 			ne1 				   => cpu_fpga_bus_ne1,
 			buf_data_out           => ipm_to_buf_data,
-			buf_data_in            => buf_to_ipm_data,
 			buf_addr               => ipm_addr,
 			buf_rw                 => ipm_rw,
 			buf_enable             => ipm_buf_enable,
 			row_0                  => row_0,
 			cpu_read_completed     => cpu_read_completed,
 			cpu_write_completed    => cpu_write_completed,
-			addr_ip                => addr_ip,
-			data_in_ip             => ip_to_ipm_data,
-			data_out_ip            => ipm_to_ip_data,
 			opcode_ip              => opcode_ip,
 			int_pol_ip             => int_pol_ip,
-			rw_ip                  => rw_ip,
-			buf_enable_ip          => buf_enable_ip,
 			enable_ip              => enable_ip,
 			ack_ip                 => ack_ip,
 			interrupt_ip           => interrupt_ip,
@@ -132,25 +132,28 @@ begin
 	
 	-- IMPORTANT: Instantiate here the IP cores. 
 	-- The port map is the same for every IP, only the indexes must be changed. 
+	-- All the NUM_IPS IPs are Grain controller+cipher pairs, with core IDs from 1 to NUM_IPS.
 	
-	
-	controller_with_cipher: entity work.grain_controller
-		port map(
-			clock 			  => cpu_fpga_clk,
-			reset 			  => cpu_fpga_rst,
-			data_in 		  => ipm_to_ip_data(0),
-			opcode 			  => opcode_ip(0),
-			enable 			  => enable_ip(0),
-			ack 			  => ack_ip(0),
-			interrupt_polling => int_pol_ip(0),
-			data_out          => ip_to_ipm_data(0),
-			buffer_enable     => buf_enable_ip(0),
-			address           => addr_ip(0),
-			rw                => rw_ip(0),
-			interrupt         => interrupt_ip(0),
-			error             => error_ip(0),
-			write_completed   => cpu_write_completed_ip(0),
-			read_completed    => cpu_read_completed_ip(0)
-		);	
+	grain_cores: for i in 0 to NUM_IPS-1 generate
+		controller_with_cipher: entity work.grain_controller
+			port map(
+				clock 			  => cpu_fpga_clk,
+				reset 			  => cpu_fpga_rst,
+				data_in 		  => buf_to_ip_data(i),
+				opcode 			  => opcode_ip(i),
+				enable 			  => enable_ip(i),
+				ack 			  => ack_ip(i),
+				interrupt_polling => int_pol_ip(i),
+				data_out          => ip_to_buf_data(i),
+				buffer_enable     => buf_enable_ip(i),
+				address           => addr_ip(i),
+				bank              => bank_ip(i),
+				rw                => rw_ip(i),
+				interrupt         => interrupt_ip(i),
+				error             => error_ip(i),
+				write_completed   => cpu_write_completed_ip(i),
+				read_completed    => cpu_read_completed_ip(i)
+			);	
+	end generate;
 									
 end architecture;
\ No newline at end of file
@@ -0,0 +1,119 @@
+/*
+ * gen_vectors.c
+ *
+ * Random test vectors of the controller for TB_cosim, computed by the C
+ * reference model (c/grain128aead.c).
+ *
+ *   gen_vectors [count] [seed]      count vectors to stdout, one per line
+ *
+ * A line is a single-packet transaction, words in the order of the data buffer
+ * (word i = byte 2i << 8 | byte 2i+1, an odd last byte in the upper half of its word):
+ *
+ *   decrypt status ad_bytes msg_bytes key(8) iv(6) ad((ad_bytes+1)/2) in((msg_bytes+1)/2)
+ *   [mac(4) if decrypt] out((msg_bytes+1)/2) tag(4)
+ *
+ * The lengths stay in what a single packet of the controller takes: AD up to
+ * 20 bytes, a message up to 24 bytes. The first vectors go through every
+ * AD length, odd ones included, both encrypting and decrypting; the lengths of
+ * the others are random. A quarter of the decryptions carry a corrupted MAC,
+ * for which the controller has to answer FFFE and clear both the plaintext and
+ * the tag.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grain128aead.h"
+
+#define VEC_MAX_AD			20					// bytes of AD of a single packet (AD words 18 to 27)
+#define VEC_MAX_MSG			PACKET_MSG_SIZE		// bytes of message of a single packet
+#define VEC_TAG_SIZE		8
+
+#define STATUS_DONE			0xFFFF
+#define STATUS_FAIL			0xFFFE
+
+static unsigned long long rng_state;
+
+/* xorshift64*, the same vectors for the same seed on every host */
+static unsigned int rng(void)
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return (unsigned int)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static void random_bytes(unsigned char *buf, int len)
+{
+	int i;
+
+	for ( i = 0; i < len; i++ )
+		buf[i] = rng() & 0xFF;
+}
+
+static void print_words(const unsigned char *buf, int len)
+{
+	int i;
+
+	for ( i = 0; i < len; i += 2 )
+		printf(" %02X%02X", buf[i], i + 1 < len ? buf[i + 1] : 0);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned char key[KEY_SIZE], iv[IV_SIZE], ad[VEC_MAX_AD];
+	unsigned char in[VEC_MAX_MSG], out[VEC_MAX_MSG], mac[VEC_TAG_SIZE], tag[VEC_TAG_SIZE];
+	int count = argc > 1 ? atoi(argv[1]) : 100;
+	int n, decrypt, adlen, msglen, status;
+
+	rng_state = argc > 2 ? strtoull(argv[2], NULL, 0) : 1;
+	if ( rng_state == 0 )
+		rng_state = 1;
+
+	for ( n = 0; n < count; n++ ) {
+		decrypt = rng() & 1;
+		adlen = rng() % (VEC_MAX_AD + 1);
+		if ( n < 2 * (VEC_MAX_AD + 1) ) {
+			decrypt = n & 1;
+			adlen = n / 2;
+		}
+		msglen = rng() % (VEC_MAX_MSG + 1);
+		random_bytes(key, KEY_SIZE);
+		random_bytes(iv, IV_SIZE);
+		random_bytes(ad, adlen);
+		random_bytes(in, msglen);
+		status = STATUS_DONE;
+
+		grain_start(key, iv, ad, adlen);
+		if ( decrypt ) {
+			/* the random bytes are the plaintext: in is its ciphertext, the controller
+			 * writes the tag it computes whether or not the MAC matches */
+			memcpy(out, in, msglen);
+			grain_encrypt_bytes(out, in, msglen);
+			grain_tag(tag);
+			memcpy(mac, tag, VEC_TAG_SIZE);
+			if ( (rng() & 3) == 0 ) {
+				mac[rng() % VEC_TAG_SIZE] ^= 1 << (rng() & 7);
+				memset(out, 0, msglen);
+				memset(tag, 0, VEC_TAG_SIZE);
+				status = STATUS_FAIL;
+			}
+		}
+		else {
+			grain_encrypt_bytes(in, out, msglen);
+			grain_tag(tag);
+		}
+
+		printf("%d %04X %d %d", decrypt, status, adlen, msglen);
+		print_words(key, KEY_SIZE);
+		print_words(iv, IV_SIZE);
+		print_words(ad, adlen);
+		print_words(in, msglen);
+		if ( decrypt )
+			print_words(mac, VEC_TAG_SIZE);
+		print_words(out, msglen);
+		print_words(tag, VEC_TAG_SIZE);
+		printf("\n");
+	}
+	return 0;
+}